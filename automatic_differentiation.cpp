@@ -1,7 +1,7 @@
 #include <iostream>
 #include "Var.hpp"
 
-// g++ automatic_differentiation.cpp src/Var.cpp -I include -o automatic_differentiation && ./automatic_differentiation
+// g++ automatic_differentiation.cpp src/Var.cpp src/MemoryPool.cpp src/Counters.cpp src/Trace.cpp -I include -pthread -o automatic_differentiation && ./automatic_differentiation
 
 int main () {
     // Reverse-Mode Automatic Differentiation
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include "Parallel.hpp"
+
+// Timing harness shared by the bench/ programs. Each benchmark is sampled `repetitions` times; a sample runs
+// the body enough times to last min_sample_ms and records the mean nanoseconds per iteration. Results print
+// as a table and, with --json, are written as one JSON document per program.
+//
+//   bench_matmul [--json out.json] [--filter substring] [--repetitions N] [--min-sample-ms MS] [--threads N]
+
+#ifndef AUTONEURONET_BUILD_TYPE
+#define AUTONEURONET_BUILD_TYPE "unknown"
+#endif
+
+struct BenchmarkResult {
+    std::string name;
+
+    // Work done by one iteration (ops, flops, samples...) and what it counts
+    double items_per_iteration = 0.0;
+    std::string unit;
+
+    int64_t iterations_per_sample = 0;
+    std::vector<double> samples_ns;
+
+    double median_ns = 0.0;
+    double mean_ns = 0.0;
+    double stddev_ns = 0.0;
+    double min_ns = 0.0;
+    double max_ns = 0.0;
+};
+
+class BenchmarkSuite {
+public:
+    std::string suite_name;
+    std::string json_path;
+    std::string filter;
+    int repetitions = 10;
+    double min_sample_ms = 20.0;
+
+    BenchmarkSuite(const std::string& name, int argc, char** argv) : suite_name(name) {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            std::string value = i + 1 < argc ? argv[i + 1] : "";
+            if (arg == "--json") {
+                json_path = value;
+            } else if (arg == "--filter") {
+                filter = value;
+            } else if (arg == "--repetitions") {
+                repetitions = std::max(1, std::atoi(value.c_str()));
+            } else if (arg == "--min-sample-ms") {
+                min_sample_ms = std::atof(value.c_str());
+            } else if (arg == "--threads") {
+                setNumThreads(std::max(1, std::atoi(value.c_str())));
+            } else {
+                std::fprintf(stderr, "unknown argument %s\n", arg.c_str());
+                std::exit(2);
+            }
+            i++;
+        }
+
+        std::printf("%-44s %14s %12s %10s %18s\n", suite_name.c_str(), "median", "+-stddev", "samples", "throughput");
+    }
+
+    bool selected(const std::string& name) const {
+        return filter.empty() || name.find(filter) != std::string::npos;
+    }
+
+    // Times body() as one iteration
+    void run(const std::string& name, double items, const std::string& unit, const std::function<void()>& body) {
+        if (!selected(name)) {
+            return;
+        }
+
+        // Warm up (pools, caches, lazily sized buffers), then size the samples from the warm-up's speed
+        int64_t iterations = 1;
+        double elapsed_ms = 0.0;
+        while (true) {
+            elapsed_ms = timeIterations(body, iterations) / 1e6;
+            if (elapsed_ms >= min_sample_ms / 4 || iterations >= (int64_t(1) << 30)) {
+                break;
+            }
+            iterations *= 2;
+        }
+        int64_t per_sample = std::max<int64_t>(1, static_cast<int64_t>(iterations * min_sample_ms / std::max(elapsed_ms, 1e-6)));
+
+        BenchmarkResult result;
+        result.name = name;
+        result.items_per_iteration = items;
+        result.unit = unit;
+        result.iterations_per_sample = per_sample;
+        for (int r = 0; r < repetitions; r++) {
+            result.samples_ns.push_back(timeIterations(body, per_sample) / static_cast<double>(per_sample));
+        }
+        finish(result);
+    }
+
+    // Times body() while setup() runs untimed before every iteration, for work that consumes its input
+    // (backward needs a fresh graph each time)
+    void runWithSetup(const std::string& name, double items, const std::string& unit, const std::function<void()>& setup,
+        const std::function<void()>& body) {
+        if (!selected(name)) {
+            return;
+        }
+
+        setup();
+        body();
+
+        BenchmarkResult result;
+        result.name = name;
+        result.items_per_iteration = items;
+        result.unit = unit;
+        result.iterations_per_sample = 0;
+        for (int r = 0; r < repetitions; r++) {
+            double total_ns = 0.0;
+            int64_t count = 0;
+            while (count == 0 || total_ns < min_sample_ms * 1e6) {
+                setup();
+                auto start = Clock::now();
+                body();
+                total_ns += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+                count++;
+            }
+            result.iterations_per_sample = std::max(result.iterations_per_sample, count);
+            result.samples_ns.push_back(total_ns / static_cast<double>(count));
+        }
+        finish(result);
+    }
+
+    // Prints nothing further; writes the JSON document when --json was given. Returns the exit code.
+    int report() const {
+        if (json_path.empty()) {
+            return 0;
+        }
+
+        std::FILE* file = std::fopen(json_path.c_str(), "w");
+        if (file == nullptr) {
+            std::fprintf(stderr, "could not open %s\n", json_path.c_str());
+            return 1;
+        }
+
+        char date[32];
+        std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+        std::fprintf(file, "{\n  \"suite\": \"%s\",\n", suite_name.c_str());
+        std::fprintf(file, "  \"context\": {\"date\": \"%s\", \"build_type\": \"%s\", \"threads\": %d, \"hardware_threads\": %u, "
+            "\"repetitions\": %d, \"min_sample_ms\": %g},\n", date, AUTONEURONET_BUILD_TYPE, getNumThreads(),
+            std::thread::hardware_concurrency(), repetitions, min_sample_ms);
+        std::fprintf(file, "  \"peak_rss_kb\": %ld,\n", peakRssKilobytes());
+        std::fprintf(file, "  \"benchmarks\": [");
+        for (size_t b = 0; b < results.size(); b++) {
+            const BenchmarkResult& r = results[b];
+            std::fprintf(file, "%s\n    {\"name\": \"%s\", \"unit\": \"%s\", \"items_per_iteration\": %.17g, "
+                "\"iterations_per_sample\": %lld, \"median_ns\": %.6g, \"mean_ns\": %.6g, \"stddev_ns\": %.6g, "
+                "\"min_ns\": %.6g, \"max_ns\": %.6g, \"items_per_second\": %.6g, \"samples_ns\": [",
+                b == 0 ? "" : ",", r.name.c_str(), r.unit.c_str(), r.items_per_iteration, static_cast<long long>(r.iterations_per_sample),
+                r.median_ns, r.mean_ns, r.stddev_ns, r.min_ns, r.max_ns, itemsPerSecond(r));
+            for (size_t s = 0; s < r.samples_ns.size(); s++) {
+                std::fprintf(file, "%s%.6g", s == 0 ? "" : ", ", r.samples_ns[s]);
+            }
+            std::fprintf(file, "]}");
+        }
+        std::fprintf(file, "\n  ]\n}\n");
+
+        bool ok = std::ferror(file) == 0;
+        ok = std::fclose(file) == 0 && ok;
+        return ok ? 0 : 1;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<BenchmarkResult> results;
+
+    static double timeIterations(const std::function<void()>& body, int64_t iterations) {
+        auto start = Clock::now();
+        for (int64_t i = 0; i < iterations; i++) {
+            body();
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    static double itemsPerSecond(const BenchmarkResult& r) {
+        return r.median_ns > 0.0 ? r.items_per_iteration * 1e9 / r.median_ns : 0.0;
+    }
+
+    static long peakRssKilobytes() {
+        struct rusage usage;
+        return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+    }
+
+    void finish(BenchmarkResult& r) {
+        std::vector<double> sorted = r.samples_ns;
+        std::sort(sorted.begin(), sorted.end());
+        size_t n = sorted.size();
+        r.median_ns = n % 2 == 1 ? sorted[n / 2] : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+        r.min_ns = sorted.front();
+        r.max_ns = sorted.back();
+
+        double sum = 0.0;
+        for (double s : sorted) {
+            sum += s;
+        }
+        r.mean_ns = sum / static_cast<double>(n);
+
+        double squares = 0.0;
+        for (double s : sorted) {
+            squares += (s - r.mean_ns) * (s - r.mean_ns);
+        }
+        r.stddev_ns = n > 1 ? std::sqrt(squares / static_cast<double>(n - 1)) : 0.0;
+
+        std::printf("%-44s %14s %11.1f%% %10zu %18s\n", r.name.c_str(), formatTime(r.median_ns).c_str(),
+            r.median_ns > 0.0 ? 100.0 * r.stddev_ns / r.median_ns : 0.0, n, formatRate(itemsPerSecond(r), r.unit).c_str());
+        std::fflush(stdout);
+
+        results.push_back(r);
+    }
+
+    static std::string formatTime(double ns) {
+        char text[32];
+        if (ns < 1e3) {
+            std::snprintf(text, sizeof(text), "%.1f ns", ns);
+        } else if (ns < 1e6) {
+            std::snprintf(text, sizeof(text), "%.2f us", ns / 1e3);
+        } else {
+            std::snprintf(text, sizeof(text), "%.2f ms", ns / 1e6);
+        }
+        return text;
+    }
+
+    static std::string formatRate(double rate, const std::string& unit) {
+        char text[48];
+        if (rate >= 1e9) {
+            std::snprintf(text, sizeof(text), "%.2f G%s/s", rate / 1e9, unit.c_str());
+        } else if (rate >= 1e6) {
+            std::snprintf(text, sizeof(text), "%.2f M%s/s", rate / 1e6, unit.c_str());
+        } else if (rate >= 1e3) {
+            std::snprintf(text, sizeof(text), "%.2f k%s/s", rate / 1e3, unit.c_str());
+        } else {
+            std::snprintf(text, sizeof(text), "%.2f %s/s", rate, unit.c_str());
+        }
+        return text;
+    }
+};
+
+// Keeps the optimizer from discarding a computed value
+template <typename T>
+inline void doNotOptimize(const T& value) {
+    __asm__ __volatile__("" : : "r,m"(value) : "memory");
+}
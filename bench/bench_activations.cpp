@@ -0,0 +1,44 @@
+#include <functional>
+#include <utility>
+#include <vector>
+#include <string>
+#include "Benchmark.hpp"
+#include "Matrix.hpp"
+#include "Random.hpp"
+
+// Element-wise activations and softmax over a batch of hidden activations, with and without recording
+
+int main(int argc, char** argv) {
+    BenchmarkSuite suite("activations", argc, argv);
+    setSeed(42);
+
+    const int rows = 256, cols = 256;
+    Matrix X(rows, cols);
+    X.randomInit();
+    X = X.multiply(100.0);
+
+    std::vector<std::pair<std::string, std::function<Matrix(Matrix&)>>> activations = {
+        {"relu", [](Matrix& m) { return m.relu(); }},
+        {"leaky_relu", [](Matrix& m) { return m.leakyRelu(); }},
+        {"sigmoid", [](Matrix& m) { return m.sigmoid(); }},
+        {"tanh", [](Matrix& m) { return m.tanh(); }},
+        {"silu", [](Matrix& m) { return m.silu(); }},
+        {"elu", [](Matrix& m) { return m.elu(); }},
+        {"softmax", [](Matrix& m) { return m.softmax(); }},
+    };
+
+    for (auto& [name, activation] : activations) {
+        suite.run("activation/" + name, static_cast<double>(rows) * cols, "elements", [&]() {
+            Matrix Y = activation(X);
+            doNotOptimize(Y);
+        });
+
+        NoGradGuard guard;
+        suite.run("activation_nograd/" + name, static_cast<double>(rows) * cols, "elements", [&]() {
+            Matrix Y = activation(X);
+            doNotOptimize(Y);
+        });
+    }
+
+    return suite.report();
+}
@@ -0,0 +1,70 @@
+#include <memory>
+#include <string>
+#include "Benchmark.hpp"
+#include "Matrix.hpp"
+#include "Random.hpp"
+
+// Cost of building a graph and of backward over it as the graph grows: a chain of unary ops (depth) and a
+// matmul followed by a sum (fan-in)
+
+static Var buildChain(Var& x, int length) {
+    Var y = x.multiply(1.0001);
+    for (int i = 1; i < length; i++) {
+        y = y.add(0.5);
+    }
+    return y;
+}
+
+static Var buildDense(Matrix& A, Matrix& B) {
+    Matrix C = matmul(A, B);
+    Var total(0.0);
+    total.reserveParents(static_cast<size_t>(C.rows) * C.cols);
+    for (int i = 0; i < C.rows; i++) {
+        for (int j = 0; j < C.cols; j++) {
+            total.addParent(1.0, C.data[i][j]);
+        }
+    }
+    return total;
+}
+
+int main(int argc, char** argv) {
+    BenchmarkSuite suite("backward", argc, argv);
+    setSeed(42);
+
+    for (int length : {1024, 16384, 65536}) {
+        Var x(0.5);
+        std::string size = std::to_string(length);
+
+        suite.run("graph_build/chain/" + size, length, "nodes", [&]() {
+            Var y = buildChain(x, length);
+            doNotOptimize(y);
+        });
+
+        std::unique_ptr<Var> y;
+        suite.runWithSetup("backward/chain/" + size, length, "nodes",
+            [&]() { y = std::make_unique<Var>(buildChain(x, length)); },
+            [&]() { y->backward(); });
+    }
+
+    for (int n : {16, 32, 64}) {
+        Matrix A(n, n), B(n, n);
+        A.randomInit();
+        B.randomInit();
+        std::string size = std::to_string(n) + "x" + std::to_string(n);
+
+        // Edges: 2n per matmul output plus one per output into the sum
+        double edges = 2.0 * n * n * n + static_cast<double>(n) * n;
+
+        suite.run("graph_build/matmul/" + size, edges, "edges", [&]() {
+            Var total = buildDense(A, B);
+            doNotOptimize(total);
+        });
+
+        std::unique_ptr<Var> total;
+        suite.runWithSetup("backward/matmul/" + size, edges, "edges",
+            [&]() { total = std::make_unique<Var>(buildDense(A, B)); },
+            [&]() { total->backward(); });
+    }
+
+    return suite.report();
+}
@@ -0,0 +1,51 @@
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Benchmark.hpp"
+#include "LossFunctions.hpp"
+#include "Matrix.hpp"
+#include "Random.hpp"
+
+// Each loss function's forward pass, and backward from the loss into the predictions
+
+int main(int argc, char** argv) {
+    BenchmarkSuite suite("losses", argc, argv);
+    setSeed(42);
+
+    std::vector<std::pair<std::string, std::function<Var(Matrix&, Matrix&)>>> losses = {
+        {"mse", [](Matrix& y, Matrix& p) { return MSELoss(y, p); }},
+        {"mae", [](Matrix& y, Matrix& p) { return MAELoss(y, p); }},
+        {"bce", [](Matrix& y, Matrix& p) { return BCELoss(y, p); }},
+    };
+
+    for (int rows : {64, 1024}) {
+        const int cols = 10;
+        Matrix labels(rows, cols), preds(rows, cols);
+        for (int i = 0; i < rows; i++) {
+            labels.data[i][i % cols].setVal(1.0);
+        }
+
+        // Probabilities in (0, 1) so BCE sees valid input
+        preds.randomInit();
+        preds = preds.add(0.5);
+
+        std::string size = std::to_string(rows) + "x" + std::to_string(cols);
+        double elements = static_cast<double>(rows) * cols;
+
+        for (auto& [name, loss] : losses) {
+            suite.run("loss/" + name + "/" + size, elements, "elements", [&]() {
+                Var value = loss(labels, preds);
+                doNotOptimize(value);
+            });
+
+            std::unique_ptr<Var> value;
+            suite.runWithSetup("backward/loss_" + name + "/" + size, elements, "elements",
+                [&]() { value = std::make_unique<Var>(loss(labels, preds)); },
+                [&]() { value->backward(); });
+        }
+    }
+
+    return suite.report();
+}
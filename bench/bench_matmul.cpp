@@ -0,0 +1,46 @@
+#include <string>
+#include "Benchmark.hpp"
+#include "Matrix.hpp"
+#include "Random.hpp"
+
+// Matrix::matmul at square and layer-like shapes, recording the graph, without recording, and into an
+// existing output
+
+struct Shape {
+    int m, k, n;
+
+    // Recording 64x784x128 builds a 6M-edge graph per call, which would dominate the suite's time and RSS
+    bool record = true;
+};
+
+int main(int argc, char** argv) {
+    BenchmarkSuite suite("matmul", argc, argv);
+    setSeed(42);
+
+    for (Shape shape : {Shape{32, 32, 32}, Shape{64, 64, 64}, Shape{128, 128, 128}, Shape{64, 784, 128, false}, Shape{256, 128, 10}}) {
+        Matrix A(shape.m, shape.k), B(shape.k, shape.n), C(shape.m, shape.n);
+        A.randomInit();
+        B.randomInit();
+        std::string size = std::to_string(shape.m) + "x" + std::to_string(shape.k) + "x" + std::to_string(shape.n);
+        double flops = 2.0 * shape.m * shape.k * shape.n;
+
+        if (shape.record) {
+            suite.run("matmul/" + size, flops, "flop", [&]() {
+                Matrix result = matmul(A, B);
+                doNotOptimize(result);
+            });
+        }
+
+        NoGradGuard guard;
+        suite.run("matmul_nograd/" + size, flops, "flop", [&]() {
+            Matrix result = matmul(A, B);
+            doNotOptimize(result);
+        });
+        suite.run("matmul_into_nograd/" + size, flops, "flop", [&]() {
+            matmul(A, B, C);
+            doNotOptimize(C);
+        });
+    }
+
+    return suite.report();
+}
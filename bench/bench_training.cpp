@@ -0,0 +1,81 @@
+#include <memory>
+#include <string>
+#include "Benchmark.hpp"
+#include "LossFunctions.hpp"
+#include "Random.hpp"
+#include "Trainer.hpp"
+
+// End-to-end MLP training steps (forward, loss, backward, optimizer) and each stage on its own
+
+static std::vector<std::shared_ptr<Layer>> mlp(int in_dim, int hidden, int out_dim) {
+    return {
+        std::make_shared<Linear>(in_dim, hidden), std::make_shared<ReLU>(),
+        std::make_shared<Linear>(hidden, hidden), std::make_shared<ReLU>(),
+        std::make_shared<Linear>(hidden, out_dim)
+    };
+}
+
+int main(int argc, char** argv) {
+    BenchmarkSuite suite("training", argc, argv);
+
+    const int batch_size = 64;
+    const int in_dim = 32, hidden = 128, out_dim = 10;
+
+    setSeed(42);
+    Matrix X(batch_size, in_dim), Y(batch_size, out_dim);
+    X.randomInit();
+    Y.randomInit();
+
+    {
+        NeuralNetwork model(mlp(in_dim, hidden, out_dim));
+
+        suite.run("forward/mlp", batch_size, "samples", [&]() {
+            Matrix out = model.forward(X);
+            doNotOptimize(out);
+        });
+        suite.run("predict/mlp", batch_size, "samples", [&]() {
+            Matrix out = model.predict(X);
+            doNotOptimize(out);
+        });
+
+        std::unique_ptr<Var> loss;
+        suite.runWithSetup("backward/mlp", batch_size, "samples",
+            [&]() {
+                Matrix out = model.forward(X);
+                loss = std::make_unique<Var>(MSELoss(Y, out));
+            },
+            [&]() { loss->backward(); });
+    }
+
+    for (std::string name : {"sgd", "momentum", "adam"}) {
+        setSeed(42);
+        NeuralNetwork model(mlp(in_dim, hidden, out_dim));
+        std::unique_ptr<Optimizer> optimizer;
+        if (name == "sgd") {
+            optimizer = std::make_unique<GradientDescentOptimizer>(1e-3, &model);
+        } else if (name == "momentum") {
+            optimizer = std::make_unique<MomentumOptimizer>(1e-3, &model);
+        } else {
+            optimizer = std::make_unique<AdamOptimizer>(1e-3, &model);
+        }
+
+        // Parameter update alone, over gradients left by one backward pass
+        Matrix out = model.forward(X);
+        MSELoss(Y, out).backward();
+        double parameters = 0.0;
+        for (auto& layer : model.layers) {
+            for (Matrix* p : layer->parameters()) {
+                parameters += static_cast<double>(p->rows) * p->cols;
+            }
+        }
+        suite.run("optimizer/" + name, parameters, "params", [&]() { optimizer->optimize(); });
+
+        Trainer trainer(&model, getLossFunction("mse"), optimizer.get());
+        suite.run("train_step/mlp_" + name, batch_size, "samples", [&]() {
+            double loss = trainer.step(X, Y);
+            doNotOptimize(loss);
+        });
+    }
+
+    return suite.report();
+}
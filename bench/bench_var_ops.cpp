@@ -0,0 +1,51 @@
+#include <string>
+#include <vector>
+#include "Benchmark.hpp"
+#include "Var.hpp"
+
+// Throughput of single scalar Var ops, each creating one node and its edges, with and without recording
+
+static const int OPS_PER_ITERATION = 1024;
+
+template <typename F>
+static void runOp(BenchmarkSuite& suite, const std::string& name, F op) {
+    Var a(1.25), b(0.75);
+    auto body = [&]() {
+        for (int i = 0; i < OPS_PER_ITERATION; i++) {
+            Var c = op(a, b);
+            doNotOptimize(c);
+        }
+    };
+
+    suite.run("var/" + name, OPS_PER_ITERATION, "ops", body);
+
+    NoGradGuard guard;
+    suite.run("var_nograd/" + name, OPS_PER_ITERATION, "ops", body);
+}
+
+int main(int argc, char** argv) {
+    BenchmarkSuite suite("var_ops", argc, argv);
+
+    runOp(suite, "add", [](Var& a, Var& b) { return a + b; });
+    runOp(suite, "multiply", [](Var& a, Var& b) { return a * b; });
+    runOp(suite, "divide", [](Var& a, Var& b) { return a / b; });
+    runOp(suite, "add_scalar", [](Var& a, Var&) { return a + 2.0; });
+    runOp(suite, "pow", [](Var& a, Var&) { return a.pow(3); });
+    runOp(suite, "exp", [](Var& a, Var&) { return a.exp(); });
+    runOp(suite, "log", [](Var& a, Var&) { return a.log(); });
+    runOp(suite, "sin", [](Var& a, Var&) { return a.sin(); });
+    runOp(suite, "tanh", [](Var& a, Var&) { return a.tanh(); });
+
+    // A fused node over many terms, as the matmul and loss kernels build them
+    Var a(1.25);
+    suite.run("var/add_parent_x64", 64, "edges", [&]() {
+        Var c(0.0);
+        c.reserveParents(64);
+        for (int i = 0; i < 64; i++) {
+            c.addParent(0.5, a);
+        }
+        doNotOptimize(c);
+    });
+
+    return suite.report();
+}
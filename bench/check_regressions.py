@@ -0,0 +1,295 @@
+"""Performance regression check against the checked-in baseline.
+
+Runs the core benchmark programs (Var::backward, Matrix::matmul, NeuralNetwork::forward, optimizer and
+training steps) in several processes and compares each benchmark's median time per iteration with a base.
+Every process contributes one median; the bootstrap runs over those per-process medians, because samples
+within one process are correlated (same heap layout, same frequency state) and pooling them understates
+the noise. A benchmark regresses when its median is more than --threshold slower and the confidence
+interval of the slowdown excludes "no change", both in the main run and when it is re-measured on its
+own. Throughput is items per iteration over the same time, so a latency regression is also a throughput
+regression. Each program's peak RSS regresses when its median over the runs grows by more than
+--rss-threshold. Every process runs with the base's thread count (--threads, 1 when recording).
+
+The base is either another build of the same benchmarks, run interleaved with this one on the same
+machine (--base-build-dir), or the stored bench/baseline.json. Interleaving cancels drift in machine load
+and clock speed, so it is the precise check and uses a 10% threshold. A stored baseline was measured in
+another session, and on a shared runner an unchanged tree lands up to ~25% away from it on single
+benchmarks (predict/mlp, train_step/mlp_sgd and matmul_into_nograd/64x784x128 have all been seen at
++19..26% when re-measured), so that mode defaults to a 35% threshold and only catches large slowdowns.
+
+    cmake -S . -B build -DCMAKE_BUILD_TYPE=Release -DAUTONEURONET_BUILD_BENCHMARKS=ON
+    cmake --build build
+    python3 bench/check_regressions.py --build-dir build --base-build-dir build-main  # base vs head
+    python3 bench/check_regressions.py --build-dir build                    # exit 1 on a regression
+    python3 bench/check_regressions.py --build-dir build --update-baseline  # record a new baseline
+
+Baselines only compare like with like: record one on the machine and build type that runs the check.
+"""
+
+import argparse
+import json
+import os
+import platform
+import random
+import statistics
+import subprocess
+import sys
+import tempfile
+
+CORE_PROGRAMS = ["bench_backward", "bench_matmul", "bench_training"]
+
+DEFAULT_BASELINE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "baseline.json")
+
+
+def cpu_model():
+    try:
+        with open("/proc/cpuinfo") as f:
+            for line in f:
+                if line.startswith("model name"):
+                    return line.split(":", 1)[1].strip()
+    except OSError:
+        pass
+    return platform.processor() or platform.machine()
+
+
+def run_once(path, repetitions, min_sample_ms, threads, filter=None):
+    """Runs one benchmark process and returns its JSON document"""
+    with tempfile.NamedTemporaryFile(suffix=".json", delete=False) as f:
+        json_path = f.name
+    command = [path, "--json", json_path, "--repetitions", str(repetitions), "--min-sample-ms", str(min_sample_ms),
+               "--threads", str(threads)]
+    if filter:
+        command += ["--filter", filter]
+    try:
+        subprocess.run(command, check=True, stdout=subprocess.DEVNULL)
+        with open(json_path) as f:
+            return json.load(f)
+    finally:
+        os.unlink(json_path)
+
+
+def add_run(suite, result):
+    """Adds one process's medians and peak RSS to a suite"""
+    suite["context"] = result["context"]
+    suite["peak_rss_kb"].append(result["peak_rss_kb"])
+    for b in result["benchmarks"]:
+        entry = suite["benchmarks"].setdefault(b["name"], {
+            "unit": b["unit"], "items_per_iteration": b["items_per_iteration"], "run_medians_ns": []})
+        entry["run_medians_ns"].append(b["median_ns"])
+
+
+def finish_suite(suite):
+    for entry in suite["benchmarks"].values():
+        entry["median_ns"] = statistics.median(entry["run_medians_ns"])
+        entry["items_per_second"] = entry["items_per_iteration"] * 1e9 / entry["median_ns"]
+    suite["peak_rss_kb"] = statistics.median(suite["peak_rss_kb"])
+    return suite
+
+
+def run_program(paths, args, filter=None):
+    """Runs one benchmark program from each build `args.runs` times, alternating between the builds so they
+    see the same machine state, and returns one suite per build"""
+    suites = [{"benchmarks": {}, "peak_rss_kb": [], "context": {}} for _ in paths]
+    for run in range(args.runs):
+        for path, suite in zip(paths, suites):
+            add_run(suite, run_once(path, args.repetitions, args.min_sample_ms, args.threads, filter))
+    return [finish_suite(suite) for suite in suites]
+
+
+def program_path(build_dir, program):
+    path = os.path.join(build_dir, "bench", program)
+    if not os.path.exists(path):
+        sys.exit(f"{path} not found; configure with -DAUTONEURONET_BUILD_BENCHMARKS=ON and build first")
+    return path
+
+
+def run_suites(build_dirs, args):
+    """Returns {program: suite} for each build directory"""
+    results = [{} for _ in build_dirs]
+    for program in CORE_PROGRAMS:
+        paths = [program_path(d, program) for d in build_dirs]
+        print(f"running {program} ({args.runs} x {args.repetitions} samples"
+              f"{', interleaved with the base' if len(paths) > 1 else ''})", flush=True)
+        for result, suite in zip(results, run_program(paths, args)):
+            result[program] = suite
+    return results
+
+
+def ratio_interval(baseline, current, confidence, resamples, rng):
+    """Bootstrap interval of median(current) / median(baseline) over per-process medians"""
+    ratios = []
+    for _ in range(resamples):
+        b = statistics.median(rng.choices(baseline, k=len(baseline)))
+        c = statistics.median(rng.choices(current, k=len(current)))
+        ratios.append(c / b)
+    ratios.sort()
+    tail = (1.0 - confidence) / 2.0
+    low = ratios[int(tail * (resamples - 1))]
+    high = ratios[int((1.0 - tail) * (resamples - 1))]
+    return low, high
+
+
+def judge(base, cur, args, rng):
+    """Returns (change, low, high, regressed, improved) for one benchmark's median time"""
+    change = cur["median_ns"] / base["median_ns"]
+    low, high = ratio_interval(base["run_medians_ns"], cur["run_medians_ns"], args.confidence, args.resamples, rng)
+    regressed = change > 1.0 + args.threshold and low > 1.0
+    improved = change < 1.0 / (1.0 + args.threshold) and high < 1.0
+    return change, low, high, regressed, improved
+
+
+def confirm(program, name, base, args, rng):
+    """Re-measures one benchmark in fresh processes (next to the base build when there is one); True when
+    the regression reproduces"""
+    paths = [program_path(args.build_dir, program)]
+    if args.base_build_dir:
+        paths.insert(0, program_path(args.base_build_dir, program))
+    suites = run_program(paths, args, filter=name)
+    cur = suites[-1]["benchmarks"].get(name)
+    if args.base_build_dir:
+        base = suites[0]["benchmarks"].get(name, base)
+    if cur is None:
+        return False
+    change, low, high, regressed, _ = judge(base, cur, args, rng)
+    print(f"{'  re-measured':<40} {format_ns(base['median_ns']):>12} {format_ns(cur['median_ns']):>12} "
+          f"{100.0 * (change - 1.0):>+8.1f}% [{100.0 * (low - 1.0):>+7.1f}%,{100.0 * (high - 1.0):>+7.1f}%]  "
+          f"{'REGRESSION' if regressed else 'not reproduced'}")
+    return regressed
+
+
+def compare(baseline, current, args):
+    rng = random.Random(0)
+    regressions = []
+
+    print(f"\n{'benchmark':<40} {'baseline':>12} {'current':>12} {'change':>9} {'ci':>19}  throughput")
+    for program in CORE_PROGRAMS:
+        if program not in baseline["suites"]:
+            print(f"{program}: not in the baseline, skipped")
+            continue
+        base_suite = baseline["suites"][program]
+        if any("run_medians_ns" not in b for b in base_suite["benchmarks"].values()):
+            sys.exit(f"{program}: the baseline has no per-process medians, re-record it with --update-baseline")
+        cur_suite = current[program]
+
+        for name, base in base_suite["benchmarks"].items():
+            cur = cur_suite["benchmarks"].get(name)
+            if cur is None:
+                print(f"{name:<40} missing from this run")
+                continue
+            if cur["items_per_iteration"] != base["items_per_iteration"]:
+                print(f"{name:<40} workload changed, re-record the baseline")
+                continue
+
+            change, low, high, regressed, improved = judge(base, cur, args, rng)
+            flag = "  REGRESSION" if regressed else "  improved" if improved else ""
+            print(f"{name:<40} {format_ns(base['median_ns']):>12} {format_ns(cur['median_ns']):>12} "
+                  f"{100.0 * (change - 1.0):>+8.1f}% [{100.0 * (low - 1.0):>+7.1f}%,{100.0 * (high - 1.0):>+7.1f}%]  "
+                  f"{format_rate(cur['items_per_second'], cur['unit'])}{flag}", flush=True)
+            if regressed and args.confirm:
+                regressed = confirm(program, name, base, args, rng)
+            if regressed:
+                regressions.append(f"{name}: {100.0 * (change - 1.0):+.1f}% time per iteration")
+
+        for name in cur_suite["benchmarks"]:
+            if name not in base_suite["benchmarks"]:
+                print(f"{name:<40} new, not in the baseline")
+
+        rss_change = cur_suite["peak_rss_kb"] / base_suite["peak_rss_kb"]
+        flag = ""
+        if rss_change > 1.0 + args.rss_threshold:
+            flag = "  REGRESSION"
+            regressions.append(f"{program} peak RSS: {100.0 * (rss_change - 1.0):+.1f}%")
+        print(f"{program + ' peak RSS':<40} {base_suite['peak_rss_kb'] / 1024:>9.1f} MB {cur_suite['peak_rss_kb'] / 1024:>9.1f} MB "
+              f"{100.0 * (rss_change - 1.0):>+8.1f}%{flag}")
+
+    return regressions
+
+
+def format_ns(ns):
+    if ns < 1e3:
+        return f"{ns:.1f} ns"
+    if ns < 1e6:
+        return f"{ns / 1e3:.2f} us"
+    return f"{ns / 1e6:.2f} ms"
+
+
+def format_rate(rate, unit):
+    for scale, prefix in ((1e9, "G"), (1e6, "M"), (1e3, "k")):
+        if rate >= scale:
+            return f"{rate / scale:.2f} {prefix}{unit}/s"
+    return f"{rate:.2f} {unit}/s"
+
+
+def summarize(suites, args):
+    context = dict(next(iter(suites.values()))["context"])
+    context.pop("date", None)
+    context["cpu"] = cpu_model()
+    context["runs"] = args.runs
+    return {"context": context, "suites": suites}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--build-dir", default="build")
+    parser.add_argument("--base-build-dir", help="compare with this build, run interleaved, instead of the stored baseline")
+    parser.add_argument("--baseline", default=DEFAULT_BASELINE)
+    parser.add_argument("--update-baseline", action="store_true", help="record this run as the baseline instead of comparing")
+    parser.add_argument("--output", help="also write this run's results here")
+    parser.add_argument("--runs", type=int, default=5, help="processes per program; each contributes one median per benchmark")
+    parser.add_argument("--repetitions", type=int, default=7, help="samples per benchmark per process")
+    parser.add_argument("--min-sample-ms", type=float, default=20.0)
+    parser.add_argument("--threads", type=int, help="worker threads per process (default: the base's, 1 when recording)")
+    parser.add_argument("--threshold", type=float,
+                        help="slowdown that counts as a regression (default: 0.10 with --base-build-dir, 0.35 against the stored baseline)")
+    parser.add_argument("--rss-threshold", type=float, default=0.15, help="peak RSS growth that counts as a regression")
+    parser.add_argument("--confidence", type=float, default=0.95)
+    parser.add_argument("--resamples", type=int, default=2000)
+    parser.add_argument("--no-confirm", dest="confirm", action="store_false",
+                        help="fail on the first measurement without re-measuring flagged benchmarks")
+    args = parser.parse_args()
+    if args.update_baseline and args.base_build_dir:
+        parser.error("--update-baseline records --build-dir alone; drop --base-build-dir")
+
+    baseline = None
+    if not args.update_baseline and not args.base_build_dir:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+    if args.threads is None:
+        args.threads = baseline["context"].get("threads", 1) if baseline else 1
+    if args.threshold is None:
+        args.threshold = 0.35 if baseline else 0.10
+
+    if args.base_build_dir:
+        base_suites, suites = run_suites([args.base_build_dir, args.build_dir], args)
+        baseline = summarize(base_suites, args)
+    else:
+        suites = run_suites([args.build_dir], args)[0]
+    document = summarize(suites, args)
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(document, f, indent=1)
+
+    if args.update_baseline:
+        with open(args.baseline, "w") as f:
+            json.dump(document, f, indent=1)
+            f.write("\n")
+        print(f"baseline written to {args.baseline}")
+        return 0
+
+    for key in ("cpu", "build_type", "threads"):
+        if baseline["context"].get(key) != document["context"].get(key):
+            print(f"warning: base {key} is {baseline['context'].get(key)!r}, this run's is {document['context'].get(key)!r}")
+
+    regressions = compare(baseline, suites, args)
+    if regressions:
+        print(f"\n{len(regressions)} regression(s):")
+        for r in regressions:
+            print(f"  {r}")
+        return 1
+    print("\nno regressions")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
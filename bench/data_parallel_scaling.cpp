@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include "DataParallel.hpp"
+#include "Parallel.hpp"
+#include "Random.hpp"
+
+// Built by CMake with -DAUTONEURONET_BUILD_BENCHMARKS=ON, or by hand:
+// g++ -O2 bench/data_parallel_scaling.cpp src/*.cpp -I include -pthread -o data_parallel_scaling && ./data_parallel_scaling [max_threads]
+
+// Scaling of DataParallelTrainer::step on a small MLP over 1, 2, 4, ... threads. Efficiency is the speedup
+// over one thread divided by the thread count.
+
+int main(int argc, char** argv) {
+    int max_threads = argc > 1 ? std::atoi(argv[1]) : 32;
+    const int batch_size = 512;
+    const int in_dim = 64, hidden = 128, out_dim = 10;
+    const int warmup_steps = 2, timed_steps = 10;
+
+    setSeed(42);
+    Matrix X(batch_size, in_dim);
+    Matrix Y(batch_size, out_dim);
+    X.randomInit();
+    Y.randomInit();
+
+    std::printf("threads  step_ms  samples_per_s  speedup  efficiency\n");
+
+    double base_ms = 0.0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        setNumThreads(threads);
+        setSeed(42);
+
+        NeuralNetwork model({
+            std::make_shared<Linear>(in_dim, hidden), std::make_shared<ReLU>(),
+            std::make_shared<Linear>(hidden, hidden), std::make_shared<ReLU>(),
+            std::make_shared<Linear>(hidden, out_dim)
+        });
+        GradientDescentOptimizer optimizer(0.01, &model);
+        DataParallelTrainer trainer(&model, getLossFunction("mse"), &optimizer, threads);
+
+        for (int s = 0; s < warmup_steps; s++) {
+            trainer.step(X, Y);
+        }
+
+        // Median of the timed steps, which is robust to the occasional scheduler hiccup
+        std::vector<double> times;
+        for (int s = 0; s < timed_steps; s++) {
+            auto start = std::chrono::steady_clock::now();
+            trainer.step(X, Y);
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::sort(times.begin(), times.end());
+        double step_ms = times[times.size() / 2];
+
+        if (threads == 1) {
+            base_ms = step_ms;
+        }
+        double speedup = base_ms / step_ms;
+
+        std::printf("%7d  %7.2f  %13.0f  %7.2f  %10.2f\n", threads, step_ms, batch_size / (step_ms / 1000.0), speedup, speedup / threads);
+    }
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "Distributed.hpp"
+#include "Parallel.hpp"
+#include "Random.hpp"
+
+// g++ -O2 distributed_training.cpp src/*.cpp -I include -pthread -o distributed_training && ./distributed_training [shm|tcp] [num_processes]
+
+// Forks num_processes ranks on this machine. Each rank starts from a different random init and trains on
+// its own shard of y = 3 x0 - 2 x1 + 1; DistributedTrainer broadcasts rank 0's weights and averages the
+// gradients every step, so all ranks end with identical parameters.
+
+static int runRank(const std::string& backend, int rank, int world_size, const std::string& job) {
+    setNumThreads(std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / world_size));
+
+    std::unique_ptr<Communicator> communicator;
+    if (backend == "tcp") {
+        communicator = std::make_unique<TcpCommunicator>(rank, world_size, 29500);
+    } else {
+        communicator = std::make_unique<SharedMemoryCommunicator>("autoneuronet-" + job, rank, world_size);
+    }
+
+    const int rows = 256;
+    setSeed(1000 + rank);
+    std::vector<double> inputs(rows * 2);
+    fillUniform(inputs.data(), rows * 2, -1.0, 1.0, nextStream());
+
+    Matrix X(rows, 2);
+    Matrix Y(rows, 1);
+    for (int i = 0; i < rows; i++) {
+        X(i, 0) = inputs[2 * i];
+        X(i, 1) = inputs[2 * i + 1];
+        Y(i, 0) = 3.0 * inputs[2 * i] - 2.0 * inputs[2 * i + 1] + 1.0;
+    }
+
+    NeuralNetwork model({ std::make_shared<Linear>(2, 1) });
+    GradientDescentOptimizer optimizer(0.1, &model);
+    DistributedTrainer trainer(&model, getLossFunction("mse"), &optimizer, communicator.get());
+
+    for (int epoch = 0; epoch < 200; epoch++) {
+        double loss = trainer.step(X, Y);
+        if (rank == 0 && epoch % 50 == 0) {
+            std::printf("epoch %3d  loss %.6f\n", epoch, loss);
+        }
+    }
+
+    // Replicas are in sync when the sum over ranks is world_size times each rank's own values
+    ParameterBuffer& params = model.getParameterBuffer();
+    params.gather();
+    std::vector<double> summed = params.values;
+    communicator->allReduce(summed.data(), summed.size());
+
+    bool in_sync = true;
+    for (size_t k = 0; k < summed.size(); k++) {
+        in_sync = in_sync && summed[k] == world_size * params.values[k];
+    }
+
+    if (rank == 0) {
+        std::printf("weights:");
+        for (double v : params.values) {
+            std::printf(" %.4f", v);
+        }
+        std::printf("\n");
+    }
+    std::printf("rank %d: replicas %s\n", rank, in_sync ? "in sync" : "DIVERGED");
+
+    return in_sync ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    std::string backend = argc > 1 ? argv[1] : "shm";
+    int world_size = argc > 2 ? std::atoi(argv[2]) : 4;
+    std::string job = std::to_string(getpid());
+
+    // Fork before any rank touches the thread pool
+    std::vector<pid_t> children;
+    for (int rank = 1; rank < world_size; rank++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            int status = 1;
+            try {
+                status = runRank(backend, rank, world_size, job);
+            } catch (const std::exception& e) {
+                std::fprintf(stderr, "rank %d: %s\n", rank, e.what());
+            }
+            std::fflush(stdout);
+            _exit(status);
+        }
+        children.push_back(pid);
+    }
+
+    int failures = 0;
+    try {
+        failures += runRank(backend, 0, world_size, job);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "rank 0: %s\n", e.what());
+        failures += 1;
+    }
+
+    for (pid_t pid : children) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            failures += 1;
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
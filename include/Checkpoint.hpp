@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+#include "NeuralNetwork.hpp"
+#include "Optimizers.hpp"
+
+// Checkpoint file: a 64-byte header followed by a payload holding the layer configs, the flat dense
+// parameter values, each layer's stateBuffer() and the optimizer's type and state. The header carries a 64-bit
+// checksum of the payload, which is verified before anything is read.
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t payload_size;
+    uint64_t checksum;
+    uint64_t padding[4];
+};
+
+static_assert(sizeof(CheckpointHeader) == 64, "Checkpoint header must stay 64 bytes");
+
+// Read-only checkpoint opened through mmap; parameter arrays are copied straight out of the mapping
+class Checkpoint {
+public:
+    std::vector<LayerConfig> layer_configs;
+
+    explicit Checkpoint(const std::string& path);
+    ~Checkpoint();
+
+    Checkpoint(const Checkpoint&) = delete;
+    Checkpoint& operator=(const Checkpoint&) = delete;
+
+    // Builds a network from the stored configs and loads its parameters
+    NeuralNetwork createModel() const;
+
+    // Loads parameters into an existing network with the same architecture
+    void loadModel(NeuralNetwork& model) const;
+
+    bool hasOptimizerState() const;
+
+    // Throws when the state was saved from a different optimizer type or a model of another size
+    void loadOptimizer(Optimizer& optimizer) const;
+
+private:
+    int fd = -1;
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+
+    const double* parameter_values = nullptr;
+    uint64_t num_parameters = 0;
+    std::vector<std::pair<const double*, uint64_t>> layer_states;
+    std::string optimizer_type;
+    const double* optimizer_state = nullptr;
+    uint64_t optimizer_state_size = 0;
+    bool has_optimizer = false;
+};
+
+// Writes model parameters (and optimizer state, when given) to path, replacing it atomically
+void saveCheckpoint(const std::string& path, NeuralNetwork& model, Optimizer* optimizer = nullptr);
+
+NeuralNetwork loadCheckpoint(const std::string& path);
+
+// Saves checkpoints on a background thread. saveAsync only snapshots the buffers on the calling thread,
+// so training can continue while the file is written; errors surface from the next wait() or saveAsync(). A
+// failed save never replaces the previous file, and one still pending at destruction is reported on stderr.
+class CheckpointWriter {
+public:
+    CheckpointWriter() = default;
+    ~CheckpointWriter();
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    // Waits for any previous save before taking the new snapshot
+    void saveAsync(const std::string& path, NeuralNetwork& model, Optimizer* optimizer = nullptr);
+
+    void wait();
+
+private:
+    std::thread worker;
+    std::exception_ptr error;
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Collective operations across the processes of one training job. Every rank must issue the same sequence
+// of calls with the same sizes. All-reduce results are bitwise identical on every rank, so replicas that
+// apply the same optimizer step stay in sync.
+class Communicator {
+public:
+    virtual ~Communicator() = default;
+
+    virtual int rank() const = 0;
+    virtual int worldSize() const = 0;
+
+    // In-place element-wise sum of data[0..n) across all ranks
+    virtual void allReduce(double* data, size_t n) = 0;
+
+    // Overwrites data[0..n) on every rank with root's copy
+    virtual void broadcast(double* data, size_t n, int root = 0) = 0;
+
+    virtual void barrier() = 0;
+};
+
+// Ranks on one machine exchanging data through a POSIX shared-memory segment. Rank 0 creates the segment
+// and unlinks its name once every rank has attached, so nothing is left behind after the job. `name` must be
+// unique per job (e.g. include the job id); slot_elements bounds how many doubles move per round.
+class SharedMemoryCommunicator : public Communicator {
+public:
+    SharedMemoryCommunicator(const std::string& name, int rank, int world_size, size_t slot_elements = 1 << 18,
+        int timeout_seconds = 60);
+    ~SharedMemoryCommunicator() override;
+
+    SharedMemoryCommunicator(const SharedMemoryCommunicator&) = delete;
+    SharedMemoryCommunicator& operator=(const SharedMemoryCommunicator&) = delete;
+
+    int rank() const override;
+    int worldSize() const override;
+
+    void allReduce(double* data, size_t n) override;
+    void broadcast(double* data, size_t n, int root = 0) override;
+    void barrier() override;
+
+private:
+    struct Header;
+
+    int my_rank;
+    int world_size;
+    size_t slot_elements;
+    int timeout_ms;
+
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+    Header* header = nullptr;
+
+    double* slot(int r) const;
+    double* result() const;
+};
+
+// Ranks connected in a ring over TCP: rank r listens on base_port + r and connects to rank r + 1 on `host`.
+// All-reduce is the bandwidth-optimal ring algorithm (reduce-scatter then all-gather).
+class TcpCommunicator : public Communicator {
+public:
+    TcpCommunicator(int rank, int world_size, int base_port, const std::string& host = "127.0.0.1", int timeout_seconds = 60);
+    ~TcpCommunicator() override;
+
+    TcpCommunicator(const TcpCommunicator&) = delete;
+    TcpCommunicator& operator=(const TcpCommunicator&) = delete;
+
+    int rank() const override;
+    int worldSize() const override;
+
+    void allReduce(double* data, size_t n) override;
+    void broadcast(double* data, size_t n, int root = 0) override;
+    void barrier() override;
+
+private:
+    int my_rank;
+    int world_size;
+    int timeout_ms;
+
+    int next_fd = -1;
+    int prev_fd = -1;
+
+    // Sends to the next rank while receiving from the previous one, so neither side can block the ring
+    void exchange(const void* send_buffer, size_t send_bytes, void* receive_buffer, size_t receive_bytes);
+};
+
+// Runs collectives of a Communicator on a background thread in submission order, so callers can keep
+// working (e.g. gathering the next gradient bucket) while earlier buckets are in flight. The wrapped
+// communicator must not be used directly while requests are pending.
+class AsyncCommunicator {
+public:
+    explicit AsyncCommunicator(Communicator& communicator);
+    ~AsyncCommunicator();
+
+    AsyncCommunicator(const AsyncCommunicator&) = delete;
+    AsyncCommunicator& operator=(const AsyncCommunicator&) = delete;
+
+    std::future<void> allReduce(double* data, size_t n);
+    std::future<void> broadcast(double* data, size_t n, int root = 0);
+
+    Communicator& communicator;
+
+private:
+    std::thread worker;
+    std::deque<std::packaged_task<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+
+    std::future<void> submit(std::function<void()> fn);
+    void run();
+};
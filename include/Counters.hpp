@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Process-wide event counters cheap enough for the hottest paths (every Var node and edge, every pool block). Each thread
+// adds into its own slots without synchronization; a read sums the slots of every live thread plus the totals
+// left by threads that have exited, so it is exact once the counting threads are idle.
+enum class Counter : int {
+    NodesCreated = 0,
+    NodesDestroyed = 1,
+    EdgesCreated = 2,
+    PoolBlocks = 3,
+    PoolBytes = 4,
+    NumCounters = 5
+};
+
+int64_t readCounter(Counter counter);
+
+// Per-thread slots behind addCounter. Trivially constructible, so thread_local access needs no init guard.
+struct ThreadCounters {
+    std::atomic<int64_t> values[static_cast<int>(Counter::NumCounters)];
+};
+
+extern thread_local ThreadCounters thread_counters;
+
+// 0 until the thread's slots are registered, 1 while live, 2 once folded into the totals at thread exit
+extern thread_local int thread_counters_state;
+
+// Registers the thread on first use and takes over once its slots have been retired
+void addCounterSlow(Counter counter, int64_t n);
+
+inline void addCounter(Counter counter, int64_t n) {
+    if (thread_counters_state != 1) {
+        addCounterSlow(counter, n);
+        return;
+    }
+
+    // Only the owning thread writes its slot, so a relaxed load and store is enough
+    std::atomic<int64_t>& slot = thread_counters.values[static_cast<int>(counter)];
+    slot.store(slot.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
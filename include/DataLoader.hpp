@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Dataset.hpp"
+#include "Matrix.hpp"
+
+struct Batch {
+    Matrix features;
+    Matrix labels;
+};
+
+// Serves (optionally shuffled) mini-batches of a Dataset. With prefetch on, the next batch is assembled on
+// a background thread into the second of two reusable slots while the training loop works on the current
+// one, so steady-state epochs create no new Var nodes for the inputs.
+class DataLoader {
+public:
+    std::shared_ptr<Dataset> dataset;
+    int batch_size;
+    bool shuffle;
+    bool drop_last;
+    bool prefetch;
+
+    DataLoader(std::shared_ptr<Dataset> data, int batchSize, bool shuffle = true, bool dropLast = false, bool prefetch = true);
+    ~DataLoader();
+
+    DataLoader(const DataLoader&) = delete;
+    DataLoader& operator=(const DataLoader&) = delete;
+
+    int64_t numBatches() const;
+
+    // Starts a new epoch, reshuffling the row order
+    void reset();
+
+    // Next batch of the current epoch, or nullptr once it is exhausted (the following call starts a new
+    // epoch). The batch is owned by the loader and stays valid until the next call.
+    Batch* next();
+
+private:
+    enum class SlotState { Empty, Ready, InUse };
+
+    Batch slots[2];
+    SlotState slot_states[2] = { SlotState::Empty, SlotState::Empty };
+    int64_t slot_batches[2] = { -1, -1 };
+
+    std::vector<int64_t> order;
+    int64_t next_batch = 0;
+    int in_use_slot = -1;
+    bool epoch_started = false;
+
+    std::thread producer;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+
+    void startEpoch();
+    void stopProducer();
+    void produce();
+    void fillBatch(int64_t batch, Batch& slot) const;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Trainer.hpp"
+
+// Data-parallel training on one machine. Each step splits the batch rows into num_workers shards; shard 0
+// runs on the model itself and the others on replicas with their own Var nodes, all concurrently on the
+// parallelFor pool. Shard gradients are weighted by shard size, summed into the model's ParameterBuffer,
+// and the optimizer steps once; the new values are copied to the replicas before the next step.
+// Layers with state outside parameters() (e.g. Embedding) cannot be replicated.
+class DataParallelTrainer : public Trainer {
+public:
+    int num_workers;
+
+    // num_workers <= 0 uses getNumThreads()
+    DataParallelTrainer(NeuralNetwork* model, LossFunction loss, Optimizer* optimizer, int num_workers = 0);
+
+    double step(Matrix& features, Matrix& labels) override;
+
+    // Copies the model's current parameter values into every replica
+    void broadcast();
+
+private:
+    struct Shard {
+        Matrix features;
+        Matrix labels;
+        double loss = 0.0;
+    };
+
+    std::vector<std::unique_ptr<NeuralNetwork>> replicas;
+    std::vector<Shard> shards;
+
+    NeuralNetwork& workerModel(int worker);
+    void runShard(int worker, Matrix& features, Matrix& labels, int row_begin, int row_end);
+    void allReduce(int active_workers);
+};
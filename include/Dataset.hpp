@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Row-addressable source of (features, labels) pairs consumed by DataLoader
+class Dataset {
+public:
+    virtual ~Dataset() = default;
+
+    virtual int64_t size() const = 0;
+    virtual int featureDim() const = 0;
+    virtual int labelDim() const = 0;
+
+    // Copy row `index` into features[0..featureDim()) and labels[0..labelDim())
+    virtual void getRow(int64_t index, double* features, double* labels) const = 0;
+};
+
+// Dataset held as row-major arrays of plain doubles
+class InMemoryDataset : public Dataset {
+public:
+    std::vector<double> features;
+    std::vector<double> labels;
+    int feature_dim;
+    int label_dim;
+
+    InMemoryDataset(std::vector<double> features, std::vector<double> labels, int featureDim, int labelDim);
+
+    int64_t size() const override;
+    int featureDim() const override;
+    int labelDim() const override;
+    void getRow(int64_t index, double* features, double* labels) const override;
+};
+
+// Split one CSV line into numbers, returning false for blank lines
+bool parseCSVRow(const std::string& line, std::vector<double>& row);
+
+// Numeric CSV whose last `num_label_cols` columns are the labels
+InMemoryDataset loadCSV(const std::string& path, int num_label_cols = 1, bool has_header = true);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <memory>
+#include "Communicator.hpp"
+#include "Trainer.hpp"
+
+// Multi-process data-parallel training. Every rank holds a full model and trains on its own batches. During
+// backward, gradient-ready hooks hand finished parameter slices (last layer first) to a background all-reduce
+// in buckets of about bucket_size parameters, so communication overlaps the rest of backward. All ranks then
+// apply the same optimizer step to bitwise-identical averaged gradients, keeping the replicas in sync without
+// resending values. Layers with state outside parameters() (e.g. Embedding) cannot be synchronized.
+class DistributedTrainer : public Trainer {
+public:
+    Communicator* communicator;
+    size_t bucket_size;
+
+    // Broadcasts rank 0's parameters, so every rank starts from the same model
+    DistributedTrainer(NeuralNetwork* model, LossFunction loss, Optimizer* optimizer, Communicator* communicator,
+        size_t bucket_size = 1 << 16);
+
+    // One synchronized step on this rank's batch, returning the loss averaged over all ranks
+    double step(Matrix& features, Matrix& labels) override;
+
+    // Overwrites every rank's parameters with root's
+    void broadcastParameters(int root = 0);
+
+private:
+    std::unique_ptr<AsyncCommunicator> async;
+};
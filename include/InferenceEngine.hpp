@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "NeuralNetwork.hpp"
+
+// Latency and throughput since the engine started (or since resetStats)
+struct InferenceStats {
+    int64_t requests = 0;
+    int64_t batches = 0;
+    double mean_batch_size = 0.0;
+
+    // Submit-to-result latency over the most recent requests
+    double p50_latency_ms = 0.0;
+    double p99_latency_ms = 0.0;
+
+    double requests_per_second = 0.0;
+};
+
+// Serves single-row requests from any number of threads. A batching thread coalesces queued rows into one
+// matrix, closing a batch once it holds max_batch_size rows or its oldest request has waited max_latency_ms,
+// runs one no-grad forward and fulfils each request's future with its output row.
+class InferenceEngine {
+public:
+    NeuralNetwork* neural_network;
+    int max_batch_size;
+    double max_latency_ms;
+
+    InferenceEngine(NeuralNetwork* model, int max_batch_size = 64, double max_latency_ms = 2.0);
+
+    // Finishes every queued request before returning
+    ~InferenceEngine();
+
+    InferenceEngine(const InferenceEngine&) = delete;
+    InferenceEngine& operator=(const InferenceEngine&) = delete;
+
+    std::future<std::vector<double>> submit(std::vector<double> input);
+
+    // submit(input).get()
+    std::vector<double> infer(std::vector<double> input);
+
+    InferenceStats getStats() const;
+    void resetStats();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Request {
+        std::vector<double> input;
+        std::promise<std::vector<double>> result;
+        Clock::time_point arrival;
+    };
+
+    std::deque<Request> queue;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+    std::thread worker;
+
+    // Latencies of the last LATENCY_WINDOW requests, as a ring buffer
+    static const size_t LATENCY_WINDOW = 1 << 14;
+    mutable std::mutex stats_mutex;
+    std::vector<double> latencies_ms;
+    size_t latency_next = 0;
+    int64_t served_requests = 0;
+    int64_t served_batches = 0;
+    Clock::time_point stats_start;
+
+    void run();
+    void runBatch(std::vector<Request>& batch);
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "Dataset.hpp"
+#include "InferenceRuntime.hpp"
+#include "MappedDataset.hpp"
+#include "NeuralNetwork.hpp"
+
+// Writes the network as an inference plan for InferenceRuntime: one record per layer plus all weights packed
+// contiguously in `dtype`. input_dim is the width of the input rows; 0 takes it from the first layer, which
+// must then be Linear, Conv2D or a pooling layer.
+void exportInferencePlan(const std::string& path, NeuralNetwork& model, DataType dtype = DataType::Float32, int input_dim = 0);
+
+// Post-training int8 quantization: Linear layers are exported as QuantizedLinear, with one weight scale per
+// output column and an input scale calibrated from the largest |input| each layer sees over up to
+// calibration_rows rows of `calibration`. Other layers keep dtype weights. input_dim defaults to the
+// calibration feature width.
+void exportQuantizedPlan(const std::string& path, NeuralNetwork& model, const Dataset& calibration, int64_t calibration_rows = 1024,
+    DataType dtype = DataType::Float32, int input_dim = 0);
+
+// How far a plan's outputs drift from the float64 model over a dataset
+struct PlanAccuracy {
+    int64_t rows = 0;
+    double max_abs_error = 0.0;
+    double mean_abs_error = 0.0;
+
+    // Fraction of rows where plan and model pick the same output; -1 for single-output models
+    double argmax_agreement = -1.0;
+
+    // Against the dataset labels (class index or one-hot); -1 when the labels are not class labels
+    double reference_accuracy = -1.0;
+    double plan_accuracy = -1.0;
+};
+
+// Runs the plan and model.predict over the first max_rows rows (0 = all). Float32 plans run in float.
+PlanAccuracy comparePlanAccuracy(const std::string& path, NeuralNetwork& model, const Dataset& dataset, int64_t max_rows = 0);
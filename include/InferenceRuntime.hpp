@@ -0,0 +1,743 @@
+#pragma once
+
+// Header-only runtime for inference plans written by exportInferencePlan. It has no dependency on the rest
+// of the library (no Var, no graph, no thread pool): a plan is mmapped, its packed weights are used in place
+// when their precision matches the runtime's, and each layer runs as a plain loop over float/double buffers.
+//
+// g++ -O3 -I include my_server.cpp  (nothing else to link; -O3 -march=native lets the dense kernels vectorize fully)
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The int8 kernels are compiled for AVX2 and VNNI through target attributes and picked at run time, so a
+// default (-O3 without -march) build still uses them on CPUs that have them
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define PLAN_X86_DISPATCH 1
+#include <immintrin.h>
+#if (defined(__clang__) && __clang_major__ >= 12) || (!defined(__clang__) && __GNUC__ >= 11)
+#define PLAN_HAS_AVXVNNI 1
+#endif
+#endif
+
+enum class PlanOp : uint32_t {
+    Linear = 0,
+    Conv2D = 1,
+    MaxPool2D = 2,
+    AvgPool2D = 3,
+    Embedding = 4,
+    ReLU = 5,
+    LeakyReLU = 6,
+    Sigmoid = 7,
+    Tanh = 8,
+    SiLU = 9,
+    ELU = 10,
+    Softmax = 11,
+    QuantizedLinear = 12
+};
+
+// Plan file: a 64-byte header, num_layers 64-byte layer records, then every layer's weights packed into one
+// array of float32 (dtype 0) or float64 (dtype 1) starting at weights_offset. Plans with quantized layers
+// add num_quantized int8 weights at quantized_offset, one block per QuantizedLinear layer in layer order.
+struct PlanHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t dtype;
+    uint32_t num_layers;
+    uint32_t input_dim;
+    uint32_t output_dim;
+    uint32_t reserved;
+    uint64_t weights_offset;
+    uint64_t num_weights;
+    uint64_t quantized_offset;
+    uint64_t num_quantized;
+};
+
+// Set in PlanLayer::flags for spatial layers whose images are channel-last ("nhwc")
+static const uint32_t PLAN_CHANNELS_LAST = 1;
+
+// params by op (weights are row-major, bias follows the weight matrix):
+//   Linear    {in, out}                                     W (in, out), b (out)
+//   Conv2D    {in_c, out_c, k, h, w, stride, pad, dilation}  W (in_c * k * k, out_c), b (out_c)
+//   Max/AvgPool2D {c, k, h, w, stride, pad}
+//   Embedding {num, dim}                                    table (num, dim)
+//   QuantizedLinear {in, out}, alpha = input scale          scales (out), b (out); int8 W transposed (out, in)
+struct PlanLayer {
+    uint32_t op;
+    uint32_t flags;
+    int32_t params[8];
+    double alpha;
+    uint64_t weights;
+    uint64_t num_weights;
+};
+
+static_assert(sizeof(PlanHeader) == 64, "Plan header must stay 64 bytes");
+static_assert(sizeof(PlanLayer) == 64, "Plan layer records must stay 64 bytes");
+
+static const char PLAN_MAGIC[8] = { 'A', 'N', 'N', 'P', 'L', 'A', 'N', '\0' };
+static const uint32_t PLAN_VERSION = 2;
+
+// Output extent of a sliding window along one spatial dimension
+inline int planWindowOutput(int in, int kernel, int stride, int padding, int dilation) {
+    int span = in + 2 * padding - dilation * (kernel - 1) - 1;
+    return span < 0 ? 0 : span / stride + 1;
+}
+
+// Width of a layer's output rows given the width of its input rows
+inline int planOutputWidth(const PlanLayer& layer, int in_width) {
+    const int32_t* p = layer.params;
+    switch (static_cast<PlanOp>(layer.op)) {
+        case PlanOp::Linear:
+        case PlanOp::QuantizedLinear:
+            return p[1];
+        case PlanOp::Conv2D:
+            return p[1] * planWindowOutput(p[3], p[2], p[5], p[6], p[7]) * planWindowOutput(p[4], p[2], p[5], p[6], p[7]);
+        case PlanOp::MaxPool2D:
+        case PlanOp::AvgPool2D:
+            return p[0] * planWindowOutput(p[2], p[1], p[4], p[5], 1) * planWindowOutput(p[3], p[1], p[4], p[5], 1);
+        case PlanOp::Embedding:
+            return in_width * p[1];
+        default:
+            return in_width;
+    }
+}
+
+// Input width a layer requires, or -1 if it accepts any width
+inline int planInputWidth(const PlanLayer& layer) {
+    const int32_t* p = layer.params;
+    switch (static_cast<PlanOp>(layer.op)) {
+        case PlanOp::Linear:
+        case PlanOp::QuantizedLinear: return p[0];
+        case PlanOp::Conv2D: return p[0] * p[3] * p[4];
+        case PlanOp::MaxPool2D:
+        case PlanOp::AvgPool2D: return p[0] * p[2] * p[3];
+        default: return -1;
+    }
+}
+
+// Rejects shapes that would make the window arithmetic divide by zero or produce empty outputs
+inline bool planLayerValid(const PlanLayer& layer) {
+    const int32_t* p = layer.params;
+    for (int k = 0; k < 8; k++) {
+        if (p[k] < 0) return false;
+    }
+
+    switch (static_cast<PlanOp>(layer.op)) {
+        case PlanOp::Linear:
+        case PlanOp::Embedding:
+            return p[0] > 0 && p[1] > 0;
+        case PlanOp::QuantizedLinear:
+            return p[0] > 0 && p[1] > 0 && layer.alpha > 0.0;
+        case PlanOp::Conv2D:
+            return p[2] > 0 && p[5] > 0 && p[7] > 0 && planWindowOutput(p[3], p[2], p[5], p[6], p[7]) > 0 &&
+                planWindowOutput(p[4], p[2], p[5], p[6], p[7]) > 0;
+        case PlanOp::MaxPool2D:
+        case PlanOp::AvgPool2D:
+            return p[1] > 0 && p[4] > 0 && planWindowOutput(p[2], p[1], p[4], p[5], 1) > 0 &&
+                planWindowOutput(p[3], p[1], p[4], p[5], 1) > 0;
+        default:
+            return true;
+    }
+}
+
+// Number of packed weights a layer must carry
+inline uint64_t planWeightCount(const PlanLayer& layer) {
+    const int32_t* p = layer.params;
+    switch (static_cast<PlanOp>(layer.op)) {
+        case PlanOp::Linear: return static_cast<uint64_t>(p[0]) * p[1] + p[1];
+        case PlanOp::Conv2D: return static_cast<uint64_t>(p[0]) * p[2] * p[2] * p[1] + p[1];
+        case PlanOp::Embedding: return static_cast<uint64_t>(p[0]) * p[1];
+        case PlanOp::QuantizedLinear: return 2 * static_cast<uint64_t>(p[1]);
+        default: return 0;
+    }
+}
+
+// Number of int8 weights a layer must carry in the quantized block
+inline uint64_t planQuantizedCount(const PlanLayer& layer) {
+    const int32_t* p = layer.params;
+    return static_cast<PlanOp>(layer.op) == PlanOp::QuantizedLinear ? static_cast<uint64_t>(p[0]) * p[1] : 0;
+}
+
+// Symmetric int8 quantization, saturating at +-127 so that -128 never appears. Adding and removing 1.5 * 2^52
+// rounds to nearest even like lrint, but stays a plain add the compiler can vectorize.
+inline int8_t planQuantize(double value, double inverse_scale) {
+    double scaled = value * inverse_scale;
+    scaled = scaled > 127.0 ? 127.0 : (scaled < -127.0 ? -127.0 : scaled);
+    const double round = 6755399441055744.0;
+    return static_cast<int8_t>((scaled + round) - round);
+}
+
+#if defined(PLAN_X86_DISPATCH) && defined(__SSE2__)
+inline __m128d planLoad2(const double* x) {
+    return _mm_loadu_pd(x);
+}
+
+inline __m128d planLoad2(const float* x) {
+    return _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(x))));
+}
+#endif
+
+// planQuantize over n values. SSE2 (baseline on x86-64) converts 16 at a time, still in double precision and
+// with the default round-to-nearest-even, so the result matches the scalar path exactly.
+template <typename T>
+inline void planQuantizeRow(const T* x, size_t n, double inverse_scale, int8_t* q) {
+    size_t k = 0;
+#if defined(PLAN_X86_DISPATCH) && defined(__SSE2__)
+    const __m128d inverse = _mm_set1_pd(inverse_scale), high = _mm_set1_pd(127.0), low = _mm_set1_pd(-127.0);
+    for (; k + 16 <= n; k += 16) {
+        __m128i quads[4];
+        for (int p = 0; p < 4; p++) {
+            __m128d a = _mm_min_pd(_mm_max_pd(_mm_mul_pd(planLoad2(x + k + 4 * p), inverse), low), high);
+            __m128d b = _mm_min_pd(_mm_max_pd(_mm_mul_pd(planLoad2(x + k + 4 * p + 2), inverse), low), high);
+            quads[p] = _mm_unpacklo_epi64(_mm_cvtpd_epi32(a), _mm_cvtpd_epi32(b));
+        }
+        __m128i packed = _mm_packs_epi16(_mm_packs_epi32(quads[0], quads[1]), _mm_packs_epi32(quads[2], quads[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(q + k), packed);
+    }
+#endif
+    for (; k < n; k++) {
+        q[k] = planQuantize(static_cast<double>(x[k]), inverse_scale);
+    }
+}
+
+// For each of `rows` int8 inputs x_i = x + i * n, the sums of x_i[0..n) * w_r[0..n) over four int8 weight
+// rows w_r = w + r * n, written to sums[4 * i + r]
+using PlanDotInt8x4 = void (*)(const int8_t* x, int rows, const int8_t* w, int n, int32_t* sums);
+
+inline void planDotInt8x4Tail(const int8_t* x, const int8_t* w, int k, int n, int32_t* sums) {
+    for (int r = 0; r < 4; r++) {
+        const int8_t* wr = w + static_cast<size_t>(r) * n;
+        int32_t sum = 0;
+        for (int j = k; j < n; j++) {
+            sum += static_cast<int32_t>(x[j]) * wr[j];
+        }
+        sums[r] += sum;
+    }
+}
+
+inline void planDotInt8x4Scalar(const int8_t* x, int rows, const int8_t* w, int n, int32_t* sums) {
+    for (int i = 0; i < rows; i++) {
+        int32_t* si = sums + 4 * static_cast<size_t>(i);
+        si[0] = si[1] = si[2] = si[3] = 0;
+        planDotInt8x4Tail(x + static_cast<size_t>(i) * n, w, 0, n, si);
+    }
+}
+
+#if defined(PLAN_X86_DISPATCH)
+
+// Lane-wise reduction of four accumulators into the four sums
+__attribute__((target("avx2"))) inline void planReduce4(const __m256i acc[4], int32_t* sums) {
+    __m256i s01 = _mm256_hadd_epi32(acc[0], acc[1]);
+    __m256i s23 = _mm256_hadd_epi32(acc[2], acc[3]);
+    __m256i s = _mm256_hadd_epi32(s01, s23);
+    __m128i folded = _mm_add_epi32(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), folded);
+}
+
+// One kernel body per instruction set. |x| is multiplied by w carrying x's sign, which keeps maddubs' 16-bit
+// pair sums below saturation because neither side reaches -128; VNNI fuses the same multiply-add.
+#define PLAN_DOT_INT8X4_BODY(MULTIPLY_ADD)                                                                   \
+    for (int i = 0; i < rows; i++) {                                                                         \
+        const int8_t* xi = x + static_cast<size_t>(i) * n;                                                   \
+        int k = 0;                                                                                           \
+        __m256i acc[4] = { _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256() }; \
+        for (; k + 32 <= n; k += 32) {                                                                       \
+            __m256i xv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xi + k));                       \
+            __m256i ax = _mm256_abs_epi8(xv);                                                                \
+            for (int r = 0; r < 4; r++) {                                                                    \
+                __m256i wv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w + static_cast<size_t>(r) * n + k)); \
+                acc[r] = MULTIPLY_ADD(acc[r], ax, _mm256_sign_epi8(wv, xv));                                 \
+            }                                                                                                \
+        }                                                                                                    \
+        int32_t* si = sums + 4 * static_cast<size_t>(i);                                                     \
+        planReduce4(acc, si);                                                                                \
+        planDotInt8x4Tail(xi, w, k, n, si);                                                                  \
+    }
+
+__attribute__((target("avx2"))) inline __m256i planMaddInt8Avx2(__m256i acc, __m256i a, __m256i b) {
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_maddubs_epi16(a, b), _mm256_set1_epi16(1)));
+}
+
+__attribute__((target("avx2"))) inline void planDotInt8x4Avx2(const int8_t* x, int rows, const int8_t* w, int n, int32_t* sums) {
+    PLAN_DOT_INT8X4_BODY(planMaddInt8Avx2)
+}
+
+__attribute__((target("avx2,avx512vnni,avx512vl"))) inline void planDotInt8x4Avx512Vnni(const int8_t* x, int rows, const int8_t* w, int n, int32_t* sums) {
+    PLAN_DOT_INT8X4_BODY(_mm256_dpbusd_epi32)
+}
+
+#if defined(PLAN_HAS_AVXVNNI)
+__attribute__((target("avx2,avxvnni"))) inline void planDotInt8x4AvxVnni(const int8_t* x, int rows, const int8_t* w, int n, int32_t* sums) {
+    PLAN_DOT_INT8X4_BODY(_mm256_dpbusd_avx_epi32)
+}
+#endif
+
+#undef PLAN_DOT_INT8X4_BODY
+
+#endif
+
+// Best int8 dot kernel for the running CPU, chosen once; `name` (if given) receives its instruction set
+inline PlanDotInt8x4 planDotInt8x4Kernel(const char** name = nullptr) {
+    static const std::pair<PlanDotInt8x4, const char*> kernel = []() -> std::pair<PlanDotInt8x4, const char*> {
+#if defined(PLAN_X86_DISPATCH)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            if (__builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx512vl")) {
+                return { planDotInt8x4Avx512Vnni, "avx512-vnni" };
+            }
+#if defined(PLAN_HAS_AVXVNNI)
+            if (__builtin_cpu_supports("avxvnni")) {
+                return { planDotInt8x4AvxVnni, "avx-vnni" };
+            }
+#endif
+            return { planDotInt8x4Avx2, "avx2" };
+        }
+#endif
+        return { planDotInt8x4Scalar, "scalar" };
+    }();
+
+    if (name != nullptr) {
+        *name = kernel.second;
+    }
+    return kernel.first;
+}
+
+// Runs an exported plan in precision T (float or double). Not thread-safe because of its scratch buffers;
+// use one runtime per thread, which is cheap since the weights are shared through the page cache.
+template <typename T>
+class InferenceRuntime {
+public:
+    explicit InferenceRuntime(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open " + path);
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(PlanHeader)) {
+            ::close(fd);
+            throw std::runtime_error(path + " is too small to be an inference plan");
+        }
+
+        mapping_size = static_cast<size_t>(info.st_size);
+        mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            mapping = nullptr;
+            throw std::runtime_error("Could not mmap " + path);
+        }
+
+        try {
+            load(path);
+        } catch (...) {
+            munmap(mapping, mapping_size);
+            throw;
+        }
+    }
+
+    ~InferenceRuntime() {
+        if (mapping) {
+            munmap(mapping, mapping_size);
+        }
+    }
+
+    InferenceRuntime(const InferenceRuntime&) = delete;
+    InferenceRuntime& operator=(const InferenceRuntime&) = delete;
+
+    int inputDim() const { return input_dim; }
+    int outputDim() const { return output_dim; }
+    size_t numLayers() const { return layers.size(); }
+
+    // input: rows x inputDim(), output: rows x outputDim(), both row-major
+    void run(const T* input, int rows, T* output) {
+        if (rows <= 0) {
+            return;
+        }
+        if (layers.empty()) {
+            std::copy(input, input + static_cast<size_t>(rows) * input_dim, output);
+            return;
+        }
+
+        size_t needed = static_cast<size_t>(rows) * max_width;
+        if (buffers[0].size() < needed) {
+            buffers[0].resize(needed);
+            buffers[1].resize(needed);
+        }
+
+        const T* x = input;
+        int width = input_dim;
+        for (size_t l = 0; l < layers.size(); l++) {
+            // The last layer writes straight into the caller's buffer
+            T* y = l + 1 == layers.size() ? output : buffers[l % 2].data();
+            runLayer(layers[l], weights[l], quantized[l], x, rows, width, y);
+            width = planOutputWidth(layers[l], width);
+            x = y;
+        }
+    }
+
+    std::vector<T> run(const std::vector<T>& input, int rows) {
+        if (input.size() != static_cast<size_t>(rows) * input_dim) {
+            throw std::runtime_error("Input must hold rows * inputDim() values");
+        }
+        std::vector<T> output(static_cast<size_t>(rows) * output_dim);
+        run(input.data(), rows, output.data());
+        return output;
+    }
+
+private:
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+
+    std::vector<PlanLayer> layers;
+    std::vector<const T*> weights;
+    std::vector<const int8_t*> quantized;
+
+    // Weights converted to T when the plan was exported in the other precision
+    std::vector<T> converted;
+
+    int input_dim = 0;
+    int output_dim = 0;
+    int max_width = 0;
+    std::vector<T> buffers[2];
+    std::vector<T> columns;
+    std::vector<int8_t> quantized_input;
+    std::vector<int32_t> quantized_sums;
+
+    void load(const std::string& path) {
+        PlanHeader header;
+        std::memcpy(&header, mapping, sizeof(header));
+
+        if (std::memcmp(header.magic, PLAN_MAGIC, sizeof(PLAN_MAGIC)) != 0) {
+            throw std::runtime_error(path + " is not an inference plan");
+        }
+        // Version 1 plans predate quantized layers; their quantized fields are zero
+        if (header.version < 1 || header.version > PLAN_VERSION) {
+            throw std::runtime_error(path + " has unsupported plan version " + std::to_string(header.version));
+        }
+        if (header.dtype > 1) {
+            throw std::runtime_error(path + " has an unknown weight type");
+        }
+
+        size_t element = header.dtype == 0 ? sizeof(float) : sizeof(double);
+        size_t layers_end = sizeof(PlanHeader) + static_cast<size_t>(header.num_layers) * sizeof(PlanLayer);
+        if (layers_end > mapping_size || header.weights_offset < layers_end || header.weights_offset % element != 0 ||
+            header.weights_offset + header.num_weights * element > mapping_size) {
+            throw std::runtime_error(path + " is truncated");
+        }
+        if (header.num_quantized > 0 && (header.quantized_offset < header.weights_offset + header.num_weights * element ||
+            header.quantized_offset + header.num_quantized > mapping_size)) {
+            throw std::runtime_error(path + " is truncated");
+        }
+        const int8_t* packed_quantized = reinterpret_cast<const int8_t*>(static_cast<const char*>(mapping) + header.quantized_offset);
+        uint64_t quantized_used = 0;
+
+        layers.resize(header.num_layers);
+        std::memcpy(layers.data(), static_cast<const char*>(mapping) + sizeof(PlanHeader), header.num_layers * sizeof(PlanLayer));
+
+        const char* packed = static_cast<const char*>(mapping) + header.weights_offset;
+        bool in_place = element == sizeof(T);
+        if (!in_place) {
+            converted.resize(header.num_weights);
+            for (uint64_t k = 0; k < header.num_weights; k++) {
+                if (header.dtype == 0) {
+                    converted[k] = static_cast<T>(reinterpret_cast<const float*>(packed)[k]);
+                } else {
+                    converted[k] = static_cast<T>(reinterpret_cast<const double*>(packed)[k]);
+                }
+            }
+        }
+        const T* base = in_place ? reinterpret_cast<const T*>(packed) : converted.data();
+
+        // Check every layer against the width flowing into it before anything runs
+        input_dim = static_cast<int>(header.input_dim);
+        int width = input_dim;
+        max_width = width;
+        for (const PlanLayer& layer : layers) {
+            if (layer.op > static_cast<uint32_t>(PlanOp::QuantizedLinear)) {
+                throw std::runtime_error(path + " uses an unknown layer op " + std::to_string(layer.op));
+            }
+            if (!planLayerValid(layer)) {
+                throw std::runtime_error(path + " has an invalid layer shape");
+            }
+            int required = planInputWidth(layer);
+            if (required >= 0 && required != width) {
+                throw std::runtime_error(path + " has inconsistent layer shapes");
+            }
+            if (layer.num_weights != planWeightCount(layer) || layer.weights + layer.num_weights > header.num_weights) {
+                throw std::runtime_error(path + " has inconsistent layer weights");
+            }
+
+            uint64_t quantized_count = planQuantizedCount(layer);
+            if (quantized_used + quantized_count > header.num_quantized) {
+                throw std::runtime_error(path + " has inconsistent quantized weights");
+            }
+
+            weights.push_back(base + layer.weights);
+            quantized.push_back(quantized_count > 0 ? packed_quantized + quantized_used : nullptr);
+            quantized_used += quantized_count;
+            width = planOutputWidth(layer, width);
+            max_width = std::max(max_width, width);
+        }
+
+        output_dim = width;
+        if (output_dim != static_cast<int>(header.output_dim)) {
+            throw std::runtime_error(path + " has inconsistent layer shapes");
+        }
+    }
+
+    // y[rows, out] = x[rows, in] * W[in, out] + b. Four rows by GEMM_COLUMNS outputs accumulate in a local
+    // tile, so each stretch of a W row is loaded once per four rows. Full tiles use a compile-time width,
+    // which lets the inner loop vectorize even at -O2.
+    static constexpr int GEMM_COLUMNS = 128;
+
+    template <int Width>
+    static void accumulateTile(const T* const xs[4], int in, int out, const T* W, T acc[4][GEMM_COLUMNS], int width) {
+        int columns = Width > 0 ? Width : width;
+        for (int i = 0; i < in; i++) {
+            const T* w = W + static_cast<size_t>(i) * out;
+            T a0 = xs[0][i], a1 = xs[1][i], a2 = xs[2][i], a3 = xs[3][i];
+            for (int o = 0; o < columns; o++) {
+                acc[0][o] += a0 * w[o];
+                acc[1][o] += a1 * w[o];
+                acc[2][o] += a2 * w[o];
+                acc[3][o] += a3 * w[o];
+            }
+        }
+    }
+
+    static void gemm(const T* x, int rows, int in, int out, const T* W, const T* b, T* y) {
+        for (int n0 = 0; n0 < rows; n0 += 4) {
+            int block_rows = std::min(4, rows - n0);
+            const T* xs[4];
+            for (int r = 0; r < 4; r++) {
+                // Missing rows of the last block repeat the first one and are never stored
+                xs[r] = x + static_cast<size_t>(n0 + (r < block_rows ? r : 0)) * in;
+            }
+
+            for (int o0 = 0; o0 < out; o0 += GEMM_COLUMNS) {
+                int width = std::min(GEMM_COLUMNS, out - o0);
+                T acc[4][GEMM_COLUMNS];
+                for (int r = 0; r < 4; r++) {
+                    std::copy(b + o0, b + o0 + width, acc[r]);
+                }
+
+                if (width == GEMM_COLUMNS) {
+                    accumulateTile<GEMM_COLUMNS>(xs, in, out, W + o0, acc, width);
+                } else {
+                    accumulateTile<0>(xs, in, out, W + o0, acc, width);
+                }
+
+                for (int r = 0; r < block_rows; r++) {
+                    std::copy(acc[r], acc[r] + width, y + static_cast<size_t>(n0 + r) * out + o0);
+                }
+            }
+        }
+    }
+
+    static int imageIndex(bool channels_last, int c, int y, int x, int channels, int height, int width) {
+        return channels_last ? (y * width + x) * channels + c : (c * height + y) * width + x;
+    }
+
+    void runLayer(const PlanLayer& layer, const T* w, const int8_t* q, const T* x, int rows, int width, T* y) {
+        const int32_t* p = layer.params;
+        size_t total = static_cast<size_t>(rows) * width;
+        T alpha = static_cast<T>(layer.alpha);
+
+        switch (static_cast<PlanOp>(layer.op)) {
+            case PlanOp::Linear:
+                gemm(x, rows, p[0], p[1], w, w + static_cast<size_t>(p[0]) * p[1], y);
+                break;
+            case PlanOp::QuantizedLinear:
+                quantizedLinear(layer, w, q, x, rows, y);
+                break;
+            case PlanOp::Conv2D:
+                conv2d(layer, w, x, rows, y);
+                break;
+            case PlanOp::MaxPool2D:
+            case PlanOp::AvgPool2D:
+                pool(layer, x, rows, y);
+                break;
+            case PlanOp::Embedding:
+                for (size_t k = 0; k < total; k++) {
+                    int id = static_cast<int>(x[k]);
+                    if (id < 0 || id >= p[0]) {
+                        throw std::out_of_range("Embedding index out of range");
+                    }
+                    std::copy(w + static_cast<size_t>(id) * p[1], w + static_cast<size_t>(id + 1) * p[1], y + k * p[1]);
+                }
+                break;
+            case PlanOp::ReLU:
+                for (size_t k = 0; k < total; k++) y[k] = x[k] > 0 ? x[k] : T(0);
+                break;
+            case PlanOp::LeakyReLU:
+                for (size_t k = 0; k < total; k++) y[k] = x[k] > 0 ? x[k] : alpha * x[k];
+                break;
+            case PlanOp::Sigmoid:
+                for (size_t k = 0; k < total; k++) y[k] = T(1) / (T(1) + std::exp(-x[k]));
+                break;
+            case PlanOp::Tanh:
+                for (size_t k = 0; k < total; k++) y[k] = std::tanh(x[k]);
+                break;
+            case PlanOp::SiLU:
+                for (size_t k = 0; k < total; k++) y[k] = x[k] * (T(1) / (T(1) + std::exp(-x[k])));
+                break;
+            case PlanOp::ELU:
+                for (size_t k = 0; k < total; k++) y[k] = x[k] > 0 ? x[k] : alpha * (std::exp(x[k]) - T(1));
+                break;
+            case PlanOp::Softmax:
+                for (int n = 0; n < rows; n++) {
+                    const T* xn = x + static_cast<size_t>(n) * width;
+                    T* yn = y + static_cast<size_t>(n) * width;
+                    T largest = *std::max_element(xn, xn + width);
+                    T sum = 0;
+                    for (int j = 0; j < width; j++) {
+                        yn[j] = std::exp(xn[j] - largest);
+                        sum += yn[j];
+                    }
+                    for (int j = 0; j < width; j++) {
+                        yn[j] /= sum;
+                    }
+                }
+                break;
+        }
+    }
+
+    // Quantizes the input rows with the calibrated scale, accumulates int8 x int8 products in int32 and
+    // rescales each output column by input_scale * weight_scale[o]. Four output columns at a time walk every
+    // row, so their weights stay in L1 while the quantized inputs stream past.
+    void quantizedLinear(const PlanLayer& layer, const T* w, const int8_t* q, const T* x, int rows, T* y) {
+        int in = layer.params[0], out = layer.params[1];
+        const T* scales = w;
+        const T* bias = w + out;
+        double input_scale = layer.alpha;
+        double inverse = 1.0 / input_scale;
+
+        quantized_input.resize(static_cast<size_t>(rows) * in);
+        planQuantizeRow(x, quantized_input.size(), inverse, quantized_input.data());
+
+        PlanDotInt8x4 dot = planDotInt8x4Kernel();
+        quantized_sums.resize(4 * static_cast<size_t>(rows));
+        int32_t* sums = quantized_sums.data();
+        int o = 0;
+        for (; o + 4 <= out; o += 4) {
+            dot(quantized_input.data(), rows, q + static_cast<size_t>(o) * in, in, sums);
+            for (int n = 0; n < rows; n++) {
+                T* yn = y + static_cast<size_t>(n) * out + o;
+                const int32_t* sn = sums + 4 * static_cast<size_t>(n);
+                for (int r = 0; r < 4; r++) {
+                    yn[r] = static_cast<T>(sn[r] * (input_scale * scales[o + r])) + bias[o + r];
+                }
+            }
+        }
+        for (; o < out; o++) {
+            const int8_t* wo = q + static_cast<size_t>(o) * in;
+            for (int n = 0; n < rows; n++) {
+                const int8_t* xn = quantized_input.data() + static_cast<size_t>(n) * in;
+                int32_t sum = 0;
+                for (int k = 0; k < in; k++) {
+                    sum += static_cast<int32_t>(xn[k]) * wo[k];
+                }
+                y[static_cast<size_t>(n) * out + o] = static_cast<T>(sum * (input_scale * scales[o])) + bias[o];
+            }
+        }
+    }
+
+    // im2col per image, then one GEMM against the (patch, out_c) kernel matrix
+    void conv2d(const PlanLayer& layer, const T* w, const T* x, int rows, T* y) {
+        const int32_t* p = layer.params;
+        int in_c = p[0], out_c = p[1], k = p[2], h = p[3], wd = p[4], stride = p[5], pad = p[6], dilation = p[7];
+        int oh = planWindowOutput(h, k, stride, pad, dilation);
+        int ow = planWindowOutput(wd, k, stride, pad, dilation);
+        int positions = oh * ow;
+        int patch = in_c * k * k;
+        bool channels_last = (layer.flags & PLAN_CHANNELS_LAST) != 0;
+
+        columns.resize(static_cast<size_t>(positions) * patch + static_cast<size_t>(positions) * out_c);
+        T* cols = columns.data();
+        T* products = cols + static_cast<size_t>(positions) * patch;
+        const T* bias = w + static_cast<size_t>(patch) * out_c;
+
+        for (int n = 0; n < rows; n++) {
+            const T* image = x + static_cast<size_t>(n) * in_c * h * wd;
+            T* out = y + static_cast<size_t>(n) * out_c * positions;
+
+            for (int oy = 0; oy < oh; oy++) {
+                for (int ox = 0; ox < ow; ox++) {
+                    T* column = cols + static_cast<size_t>(oy * ow + ox) * patch;
+                    for (int c = 0; c < in_c; c++) {
+                        for (int ky = 0; ky < k; ky++) {
+                            int iy = oy * stride - pad + ky * dilation;
+                            for (int kx = 0; kx < k; kx++) {
+                                int ix = ox * stride - pad + kx * dilation;
+                                bool inside = iy >= 0 && iy < h && ix >= 0 && ix < wd;
+                                column[(c * k + ky) * k + kx] = inside ? image[imageIndex(channels_last, c, iy, ix, in_c, h, wd)] : T(0);
+                            }
+                        }
+                    }
+                }
+            }
+
+            // Channel-last output is exactly the (positions, out_c) product; channel-major needs a transpose
+            gemm(cols, positions, patch, out_c, w, bias, channels_last ? out : products);
+            if (!channels_last) {
+                for (int pos = 0; pos < positions; pos++) {
+                    for (int oc = 0; oc < out_c; oc++) {
+                        out[static_cast<size_t>(oc) * positions + pos] = products[static_cast<size_t>(pos) * out_c + oc];
+                    }
+                }
+            }
+        }
+    }
+
+    void pool(const PlanLayer& layer, const T* x, int rows, T* y) {
+        const int32_t* p = layer.params;
+        int c = p[0], k = p[1], h = p[2], wd = p[3], stride = p[4], pad = p[5];
+        int oh = planWindowOutput(h, k, stride, pad, 1);
+        int ow = planWindowOutput(wd, k, stride, pad, 1);
+        bool channels_last = (layer.flags & PLAN_CHANNELS_LAST) != 0;
+        bool is_max = static_cast<PlanOp>(layer.op) == PlanOp::MaxPool2D;
+        T scale = T(1) / static_cast<T>(k * k);
+
+        for (int n = 0; n < rows; n++) {
+            const T* image = x + static_cast<size_t>(n) * c * h * wd;
+            T* out = y + static_cast<size_t>(n) * c * oh * ow;
+
+            for (int ch = 0; ch < c; ch++) {
+                for (int oy = 0; oy < oh; oy++) {
+                    for (int ox = 0; ox < ow; ox++) {
+                        T acc = 0;
+                        bool first = true;
+                        for (int ky = 0; ky < k; ky++) {
+                            int iy = oy * stride - pad + ky;
+                            if (iy < 0 || iy >= h) continue;
+                            for (int kx = 0; kx < k; kx++) {
+                                int ix = ox * stride - pad + kx;
+                                if (ix < 0 || ix >= wd) continue;
+
+                                T v = image[imageIndex(channels_last, ch, iy, ix, c, h, wd)];
+                                if (is_max) {
+                                    acc = first || v > acc ? v : acc;
+                                    first = false;
+                                } else {
+                                    acc += v;
+                                }
+                            }
+                        }
+
+                        // Padded positions count as zeros in the average, as in AvgPool2D
+                        out[imageIndex(channels_last, ch, oy, ox, c, oh, ow)] = is_max ? acc : acc * scale;
+                    }
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "Dataset.hpp"
+
+// On-disk dataset format: a 64-byte header followed by a row-major payload where each row is
+// feature_dim features then label_dim labels, all stored as `dtype`.
+enum class DataType : uint32_t {
+    Float32 = 0,
+    Float64 = 1
+};
+
+struct DatasetFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t dtype;
+    int64_t rows;
+    int32_t feature_dim;
+    int32_t label_dim;
+    uint64_t reserved[4];
+};
+
+static_assert(sizeof(DatasetFileHeader) == 64, "Dataset header must stay 64 bytes");
+
+// Read-only view of a dataset file through mmap. Opening only validates the header; pages are read
+// lazily by the OS as rows are touched, so start-up cost does not depend on the file size.
+class MappedDataset : public Dataset {
+public:
+    DatasetFileHeader header;
+
+    explicit MappedDataset(const std::string& path);
+    ~MappedDataset() override;
+
+    MappedDataset(const MappedDataset&) = delete;
+    MappedDataset& operator=(const MappedDataset&) = delete;
+
+    int64_t size() const override;
+    int featureDim() const override;
+    int labelDim() const override;
+    void getRow(int64_t index, double* features, double* labels) const override;
+
+    DataType dtype() const;
+    size_t rowBytes() const;
+
+    // Raw pointer to row `index` inside the mapping
+    const void* rowData(int64_t index) const;
+
+    // Start of the row-major payload inside the mapping
+    const void* data() const;
+
+private:
+    int fd = -1;
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+    const char* payload = nullptr;
+};
+
+// Streams rows into a dataset file. Rows go to path + ".tmp"; close() fills in the row count and renames it
+// to path. A writer destroyed without close() (e.g. when a row throws) removes the partial file, so a failed
+// conversion never leaves a file that opens as a valid, shorter dataset.
+class DatasetWriter {
+public:
+    DatasetWriter(const std::string& path, int featureDim, int labelDim, DataType dtype = DataType::Float32);
+    ~DatasetWriter();
+
+    DatasetWriter(const DatasetWriter&) = delete;
+    DatasetWriter& operator=(const DatasetWriter&) = delete;
+
+    void writeRow(const double* features, const double* labels);
+
+    // Writes `rows` consecutive rows from row-major feature and label arrays
+    void writeRows(const double* features, const double* labels, int64_t rows);
+
+    void close();
+
+    int64_t rowsWritten() const;
+
+private:
+    std::FILE* file = nullptr;
+    DatasetFileHeader header;
+    std::string path;
+    std::string temp_path;
+    std::vector<char> row_buffer;
+
+    void abandon();
+};
+
+size_t dataTypeSize(DataType dtype);
+
+// Copy any Dataset into the binary format
+void writeDataset(const std::string& path, const Dataset& dataset, DataType dtype = DataType::Float32);
+
+// Streams a numeric CSV (last `num_label_cols` columns are labels) into the binary format without
+// holding it in memory, returning the number of rows written
+int64_t convertCSV(const std::string& csv_path, const std::string& out_path, int num_label_cols = 1,
+    bool has_header = true, DataType dtype = DataType::Float32);
@@ -2,18 +2,24 @@
 
 #include <vector>
 #include <string>
-#include <random>
+#include <stdexcept>
 #include "Var.hpp"
 
 class Matrix {
 public:
+    // Rows come from the same pool as the Var nodes, so buffers released by one step are reused by the next
+    using Row = std::vector<Var, PoolAllocator<Var>>;
+
     int rows, cols;
-    std::vector<std::vector<Var>> data;
+    std::vector<Row, PoolAllocator<Row>> data;
 
     Matrix();
 
     Matrix(int r, int c);
 
+    // Reshape in place, keeping the existing storage (and Var nodes) when the shape is unchanged
+    void resize(int r, int c);
+
     Var& operator()(int row, int col) {
         return data[row][col];
     };
@@ -23,8 +29,16 @@ public:
     std::string getValsMatrix() const;
     std::string getGradsMatrix() const;
 
+    // Overwrites the values in place with U(-0.01, 0.01) draws from the global seeded generator
     void randomInit();
 
+    // Overwrites the values in place from a row-major buffer of rows * cols doubles
+    void setVals(const double* values);
+
+    // Copy values or gradients into a row-major buffer of rows * cols doubles
+    void getVals(double* out) const;
+    void getGrads(double* out) const;
+
     Matrix add(Matrix& other);
     Matrix operator+(Matrix& other) { return add(other); };
 
@@ -47,6 +61,20 @@ public:
 
     Matrix pow(int power);
 
+    // In-place variants rebind each element to the new node, whose parent is the old one, so gradients
+    // still reach everything computed from the previous values while the Matrix storage is reused
+    Matrix& add_(Matrix& other);
+    Matrix& add_(double other);
+    Matrix& mul_(Matrix& other);
+    Matrix& mul_(double other);
+
+    Matrix& relu_();
+    Matrix& leakyRelu_(double alpha = 0.01);
+    Matrix& sigmoid_();
+    Matrix& tanh_();
+    Matrix& silu_();
+    Matrix& elu_(double alpha = 1.0);
+
     Matrix relu();
     Matrix leakyRelu(double alpha = 0.01);
     Matrix sigmoid();
@@ -57,3 +85,7 @@ public:
 };
 
 Matrix matmul(Matrix& X0, Matrix& X1);
+
+// Writes X0 @ X1 into Y, reusing Y's storage when it already has the output shape. Y may be X0 or X1, in
+// which case the product goes through a temporary.
+void matmul(Matrix& X0, Matrix& X1, Matrix& Y);
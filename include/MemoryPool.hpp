@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+
+// Size-class free-list pool backing Var nodes, their parent edges and Matrix storage.
+// Blocks are cached per thread and recycled, so a training step whose graph has the same shape
+// as the previous one is served from the pool. On one thread, a steady-state forward / loss /
+// backward / optimize step over dense layers (e.g. Linear/ReLU) then makes no heap allocations
+// at all; splitting work across the thread pool and Trainer's overlap_optimizer still allocate
+// a few small task objects per step.
+void* poolAllocate(std::size_t bytes);
+void poolDeallocate(void* ptr, std::size_t bytes);
+
+// Bytes a poolAllocate(bytes) request actually occupies (its size-class block, or `bytes` when oversized)
+std::size_t poolBlockSize(std::size_t bytes);
+
+// Number of heap allocations made on behalf of the pool (pool misses and oversized blocks).
+// Take the difference across a step to get the pool misses per step. Allocations outside the
+// pool (std::function captures, std::allocator vectors, the thread pool's tasks) are not counted,
+// so a zero difference does not by itself mean the step never touched the heap.
+long long getAllocationCount();
+void resetAllocationCount();
+
+template <typename T>
+struct PoolAllocator {
+    using value_type = T;
+
+    static_assert(alignof(T) <= alignof(std::max_align_t), "PoolAllocator does not support over-aligned types");
+
+    PoolAllocator() = default;
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(poolAllocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, std::size_t n) {
+        poolDeallocate(ptr, n * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) { return true; }
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) { return false; }
@@ -1,8 +1,20 @@
 #pragma once
 
+#include <atomic>
+#include <mutex>
 #include <vector>
 #include <utility>
+#include <unordered_map>
 #include "Matrix.hpp"
+#include "SparseMatrix.hpp"
+#include "ParameterBuffer.hpp"
+
+// Constructor arguments needed to rebuild a layer with createLayer
+struct LayerConfig {
+    std::string type;
+    std::vector<double> args;
+    std::vector<std::string> options;
+};
 
 class Layer {
 public:
@@ -13,10 +25,38 @@ public:
 
     virtual Matrix forward(Matrix& input) = 0;
 
+    // Forward pass writing into a caller-owned buffer, so its storage can be reused across steps
+    virtual void forwardInto(Matrix& input, Matrix& output);
+
     virtual void optimizeWeights(double learning_rate) = 0;
     virtual void resetGrad() = 0;
+
+    // Dense Var-backed parameter matrices; trainable layers returning none update themselves in optimizeWeights
+    virtual std::vector<Matrix*> parameters();
+
+    virtual LayerConfig getConfig() const;
+
+    // Plain-double state outside parameters() that checkpoints must keep, or nullptr
+    virtual std::vector<double>* stateBuffer();
+
+    // Interned copy of name for trace spans, re-interned only when name changes
+    const char* traceName();
+
+    // Process-wide unique stamp of this layer's parameter storage. A network's ParameterBuffer points into the
+    // rows of parameters(), so call parametersChanged() after replacing or resizing one (e.g. assigning a new W);
+    // the next getParameterBuffer() then sees a new stamp and rebuilds.
+    uint64_t parameterGeneration() const;
+    void parametersChanged();
+
+private:
+    std::atomic<const char*> trace_name{ nullptr };
+    uint64_t parameter_generation = nextParameterGeneration();
+
+    static uint64_t nextParameterGeneration();
 };
 
+std::shared_ptr<Layer> createLayer(const LayerConfig& config);
+
 class Linear : public Layer {
 public:
     Matrix W;
@@ -25,10 +65,111 @@ public:
     // init: "he" (default) or "xavier"
     Linear(int inDim, int outDim, const std::string& init = "he");
 
+    Matrix forward(Matrix& input) override;
+    void forwardInto(Matrix& input, Matrix& output) override;
+
+    // Sparse inputs only connect the rows of W for their non-zero features
+    Matrix forward(SparseMatrix& input);
+
+    std::vector<Matrix*> parameters() override;
+
+    void optimizeWeights(double learning_rate) override;
+    void resetGrad() override;
+    LayerConfig getConfig() const override;
+};
+
+// Spatial layers read each input row as one image flattened in `layout` order, either "nchw" (channel-major)
+// or "nhwc" (channel-last), and write their output rows in the same layout
+
+class Conv2D : public Layer {
+public:
+    int in_channels, out_channels;
+    int kernel_size, stride, padding, dilation;
+    int in_height, in_width;
+    int out_height, out_width;
+    std::string layout;
+
+    Matrix W; // (in_channels * kernel_size * kernel_size, out_channels), rows ordered (channel, ky, kx)
+    Matrix b; // (1, out_channels)
+
+    Conv2D(int inChannels, int outChannels, int kernelSize, int inHeight, int inWidth,
+        int stride = 1, int padding = 0, int dilation = 1, const std::string& layout = "nchw", const std::string& init = "he");
+
     Matrix forward(Matrix& input) override;
 
     void optimizeWeights(double learning_rate) override;
     void resetGrad() override;
+    LayerConfig getConfig() const override;
+
+    std::vector<Matrix*> parameters() override;
+};
+
+class MaxPool2D : public Layer {
+public:
+    int channels;
+    int kernel_size, stride, padding;
+    int in_height, in_width;
+    int out_height, out_width;
+    std::string layout;
+
+    // stride defaults to kernel_size when 0
+    MaxPool2D(int numChannels, int kernelSize, int inHeight, int inWidth, int stride = 0, int padding = 0, const std::string& layout = "nchw");
+
+    Matrix forward(Matrix& input) override;
+    void optimizeWeights(double learning_rate) override;
+    void resetGrad() override;
+    LayerConfig getConfig() const override;
+};
+
+class AvgPool2D : public Layer {
+public:
+    int channels;
+    int kernel_size, stride, padding;
+    int in_height, in_width;
+    int out_height, out_width;
+    std::string layout;
+
+    // stride defaults to kernel_size when 0; padded positions count as zeros in the average
+    AvgPool2D(int numChannels, int kernelSize, int inHeight, int inWidth, int stride = 0, int padding = 0, const std::string& layout = "nchw");
+
+    Matrix forward(Matrix& input) override;
+    void optimizeWeights(double learning_rate) override;
+    void resetGrad() override;
+    LayerConfig getConfig() const override;
+};
+
+class Embedding : public Layer {
+public:
+    int num_embeddings;
+    int embedding_dim;
+
+    // Row-major (num_embeddings, embedding_dim) table kept as plain doubles; Var nodes only exist for
+    // the rows looked up since the last resetGrad, so large tables cost 8 bytes per weight
+    std::vector<double> weight;
+
+    Embedding(int num, int dim);
+
+    // input: (N, k) ids, output: (N, k * dim) with the k embeddings of each row concatenated
+    Matrix forward(Matrix& input) override;
+
+    // Only the rows looked up since the last resetGrad are updated
+    void optimizeWeights(double learning_rate) override;
+    void resetGrad() override;
+    LayerConfig getConfig() const override;
+    std::vector<double>* stateBuffer() override;
+
+    // Row-sparse gradient: the ids looked up since the last resetGrad and their gradients, row-major
+    std::vector<int> getGradRows() const;
+    std::vector<double> getGradValues() const;
+
+    std::vector<double> getEmbedding(int id) const;
+
+private:
+    std::vector<int> active_ids;
+    std::vector<Matrix::Row> active_rows;
+    std::unordered_map<int, size_t> active_slots;
+
+    Matrix::Row& lookup(int id);
 };
 
 class ReLU : public Layer {
@@ -36,8 +177,10 @@ public:
     ReLU();
     
     Matrix forward(Matrix& input) override;
+    void forwardInto(Matrix& input, Matrix& output) override;
     void optimizeWeights(double learning_rate) override;
     void resetGrad() override;
+    LayerConfig getConfig() const override;
 };
 
 class LeakyReLU : public Layer {
@@ -47,8 +190,10 @@ public:
     LeakyReLU(double a);
     
     Matrix forward(Matrix& input) override;
+    void forwardInto(Matrix& input, Matrix& output) override;
     void optimizeWeights(double learning_rate) override;
     void resetGrad() override;
+    LayerConfig getConfig() const override;
 };
 
 class Sigmoid : public Layer {
@@ -56,8 +201,10 @@ public:
     Sigmoid();
     
     Matrix forward(Matrix& input) override;
+    void forwardInto(Matrix& input, Matrix& output) override;
     void optimizeWeights(double learning_rate) override;
     void resetGrad() override;
+    LayerConfig getConfig() const override;
 };
 
 class Tanh : public Layer {
@@ -65,8 +212,10 @@ public:
     Tanh();
     
     Matrix forward(Matrix& input) override;
+    void forwardInto(Matrix& input, Matrix& output) override;
     void optimizeWeights(double learning_rate) override;
     void resetGrad() override;
+    LayerConfig getConfig() const override;
 };
 
 class SiLU : public Layer {
@@ -74,8 +223,10 @@ public:
     SiLU();
     
     Matrix forward(Matrix& input) override;
+    void forwardInto(Matrix& input, Matrix& output) override;
     void optimizeWeights(double learning_rate) override;
     void resetGrad() override;
+    LayerConfig getConfig() const override;
 };
 
 class ELU : public Layer {
@@ -85,8 +236,10 @@ public:
     ELU(double a);
     
     Matrix forward(Matrix& input) override;
+    void forwardInto(Matrix& input, Matrix& output) override;
     void optimizeWeights(double learning_rate) override;
     void resetGrad() override;
+    LayerConfig getConfig() const override;
 };
 
 class Softmax : public Layer {
@@ -96,12 +249,24 @@ public:
     Matrix forward(Matrix& input) override;
     void optimizeWeights(double learning_rate) override;
     void resetGrad() override;
+    LayerConfig getConfig() const override;
 };
 
+class LayerProfiler;
+
 class NeuralNetwork {
 public:
     std::vector<std::shared_ptr<Layer>> layers;
 
+    // Set by a LayerProfiler while one is attached
+    LayerProfiler* profiler = nullptr;
+
+    // Serializes training on this model. The Python bindings drop the GIL around training calls and hold this
+    // instead, so one thread at a time can record gradients into or update the model. Recursive so a callback
+    // running inside a locked call (a Python loss, an L-BFGS closure) can call back into the model; shared by
+    // copies, which share the layers too.
+    std::shared_ptr<std::recursive_mutex> training_lock = std::make_shared<std::recursive_mutex>();
+
     NeuralNetwork(std::vector<std::shared_ptr<Layer>> network);
 
     std::vector<std::shared_ptr<Layer>> getLayers();
@@ -109,7 +274,37 @@ public:
 
     void addLayer(std::shared_ptr<Layer> layer);
 
-    Matrix forward(Matrix input);
+    Matrix forward(Matrix& input);
+
+    // Forward pass without recording gradients; unlike forward, safe to call from several threads at once
+    Matrix predict(Matrix& input);
+
+    // The first layer must be Linear, which consumes the sparse input directly
+    Matrix forward(SparseMatrix& input);
+
+    // Forward pass through per-layer activation buffers that are reused while shapes are stable.
+    // The returned Matrix is owned by the network and overwritten by the next call.
+    Matrix& forwardBuffered(Matrix& input);
 
     std::string getNetworkArchitecture() const;
+
+    std::vector<Matrix*> parameters();
+    size_t numParameters();
+
+    // Flat buffers over the parameters of every layer, rebuilt when the layer list or a layer's
+    // parameterGeneration() changes. Checking costs one comparison per layer and allocates nothing.
+    ParameterBuffer& getParameterBuffer();
+
+    // Trainable layers without dense parameters (e.g. Embedding) that optimizers update via optimizeWeights
+    const std::vector<Layer*>& getSparseLayers();
+
+private:
+    std::vector<Matrix> activation_buffers;
+
+    ParameterBuffer parameter_buffer;
+    std::vector<Layer*> sparse_layers;
+    std::vector<Layer*> buffered_layers;
+    std::vector<uint64_t> buffered_generations;
+
+    void buildParameterBuffer();
 };
@@ -1,17 +1,155 @@
 #pragma once
 
 #include <vector>
+#include <deque>
+#include <functional>
+#include <string>
 #include <utility>
 #include "NeuralNetwork.hpp"
 
-class GradientDescentOptimizer {
+// Optimizers update the network's flat ParameterBuffer in one fused, multithreaded pass per step and keep
+// any per-parameter state in flat arrays aligned with it. Layers without dense parameters (e.g. Embedding)
+// are updated through their own optimizeWeights, which is plain SGD, so only GradientDescentOptimizer accepts
+// models that have them; the others throw rather than train those layers with a different rule.
+class Optimizer {
 public:
     double learning_rate;
     NeuralNetwork* neural_network;
 
-    GradientDescentOptimizer(double lr, NeuralNetwork* model);
+    Optimizer(double lr, NeuralNetwork* model);
+    virtual ~Optimizer() = default;
 
     void optimize();
-    
+
+    // Overlapped stepping, driven by ParameterBuffer::trackGradients: beginStep() before backward, then
+    // optimizeSlice() for each parameter slice as soon as its gradients are final (distinct slices may run
+    // concurrently), then finishStep() once backward is done. Equivalent to one optimize() call.
+    void beginStep();
+    void optimizeSlice(size_t slice);
+    void finishStep();
+
     void resetGrad();
-};
\ No newline at end of file
+
+    // Update rule name ("SGD", "Momentum", "Adam", "AdamW"); checkpoints store it next to the state
+    virtual std::string getType() const = 0;
+
+    // Per-parameter state flattened for checkpoints; setState accepts what getState returned for a model with
+    // the same parameter count
+    virtual std::vector<double> getState() const;
+    virtual void setState(const std::vector<double>& state);
+
+protected:
+    // Per-step setup for a buffer of n parameters (state sizing, step counters), once before any updateRange
+    virtual void prepareUpdate(size_t n);
+
+    // Apply this step to values[begin..end) given grads[begin..end); both point at the start of the buffer
+    virtual void updateRange(double* values, const double* grads, size_t begin, size_t end) = 0;
+
+    // Whether this update rule matches the plain SGD step that sparse layers apply themselves
+    virtual bool updatesSparseLayers() const;
+
+private:
+    void checkSparseLayers();
+};
+
+class GradientDescentOptimizer : public Optimizer {
+public:
+    GradientDescentOptimizer(double lr, NeuralNetwork* model);
+
+    std::string getType() const override;
+
+protected:
+    void updateRange(double* values, const double* grads, size_t begin, size_t end) override;
+    bool updatesSparseLayers() const override;
+};
+
+// Heavy-ball momentum: v = momentum * v + g, p -= lr * v
+class MomentumOptimizer : public Optimizer {
+public:
+    double momentum;
+    std::vector<double> velocity;
+
+    MomentumOptimizer(double lr, NeuralNetwork* model, double momentum = 0.9);
+
+    std::string getType() const override;
+    std::vector<double> getState() const override;
+    void setState(const std::vector<double>& state) override;
+
+protected:
+    void prepareUpdate(size_t n) override;
+    void updateRange(double* values, const double* grads, size_t begin, size_t end) override;
+};
+
+// Adam with bias-corrected moments; weight_decay adds an L2 term to the gradient
+class AdamOptimizer : public Optimizer {
+public:
+    double beta1, beta2, eps, weight_decay;
+    long long step_count = 0;
+
+    std::vector<double> first_moment;
+    std::vector<double> second_moment;
+
+    AdamOptimizer(double lr, NeuralNetwork* model, double beta1 = 0.9, double beta2 = 0.999, double eps = 1e-8, double weight_decay = 0.0);
+
+    std::string getType() const override;
+
+    // [step_count, first_moment..., second_moment...]
+    std::vector<double> getState() const override;
+    void setState(const std::vector<double>& state) override;
+
+protected:
+    bool decoupled_weight_decay = false;
+
+    // Constants of the current step, set by prepareUpdate
+    double step_size = 0.0;
+    double eps_hat = 0.0;
+    double coupled_decay = 0.0;
+    double parameter_decay = 1.0;
+
+    void prepareUpdate(size_t n) override;
+    void updateRange(double* values, const double* grads, size_t begin, size_t end) override;
+};
+
+// AdamW: Adam with weight decay applied directly to the parameters instead of through the gradient
+class AdamWOptimizer : public AdamOptimizer {
+public:
+    AdamWOptimizer(double lr, NeuralNetwork* model, double beta1 = 0.9, double beta2 = 0.999, double eps = 1e-8, double weight_decay = 0.01);
+
+    std::string getType() const override;
+};
+
+// L-BFGS for full-batch problems over the network's dense parameters. step() repeatedly calls `closure`, which
+// must run the forward pass and return the loss; gradients are reset and backpropagated by the optimizer.
+// Each iteration takes a quasi-Newton direction from the last history_size curvature pairs and a
+// backtracking (Armijo) line search starting from learning_rate. Models with sparse layers are rejected.
+class LBFGSOptimizer {
+public:
+    double learning_rate;
+    NeuralNetwork* neural_network;
+
+    int history_size;
+    int max_iterations;
+    int max_line_search;
+    double tolerance_grad;
+    double tolerance_change;
+
+    LBFGSOptimizer(NeuralNetwork* model, double lr = 1.0, int history_size = 10, int max_iterations = 20,
+        double tolerance_grad = 1e-7, double tolerance_change = 1e-9, int max_line_search = 25);
+
+    // Runs up to max_iterations iterations and returns the final loss
+    double step(const std::function<Var()>& closure);
+
+    // Loss evaluations made by the last step
+    int getEvaluationCount() const;
+
+    void resetGrad();
+
+private:
+    std::deque<std::vector<double>> s_history;
+    std::deque<std::vector<double>> y_history;
+    std::deque<double> rho_history;
+    int evaluations = 0;
+
+    double evaluate(const std::function<Var()>& closure, const std::vector<double>& x, std::vector<double>& grad);
+    void direction(const std::vector<double>& grad, std::vector<double>& d) const;
+};
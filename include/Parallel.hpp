@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Number of threads used by parallelFor, including the calling thread (defaults to the hardware concurrency)
+void setNumThreads(int n);
+int getNumThreads();
+
+// Splits [begin, end) into contiguous chunks of at least `grain` iterations and runs fn(chunk_begin, chunk_end)
+// on a shared worker pool, returning once every chunk is done. Calls made from inside a worker run serially.
+void parallelFor(int64_t begin, int64_t end, int64_t grain, const std::function<void(int64_t, int64_t)>& fn);
+
+// Passes lambdas by reference, so captures too large for std::function's inline storage (e.g. [&] over
+// several buffers) don't cost a heap allocation on every call
+template <typename Fn>
+void parallelFor(int64_t begin, int64_t end, int64_t grain, Fn&& fn) {
+    const std::function<void(int64_t, int64_t)> ref = std::ref(fn);
+    parallelFor(begin, end, grain, ref);
+}
+
+// While alive, parallelFor calls made on this thread run inline, as they do inside pool workers. Used when the
+// caller is itself one of several tasks already spread across the pool.
+class SerialGuard {
+public:
+    SerialGuard();
+    ~SerialGuard();
+
+    SerialGuard(const SerialGuard&) = delete;
+    SerialGuard& operator=(const SerialGuard&) = delete;
+
+private:
+    bool previous;
+};
+
+// One background thread running submitted tasks in order, for work that overlaps the caller (e.g. optimizer
+// updates during backward). Tasks may still use parallelFor. wait() blocks until every task submitted so far
+// has run and rethrows the first error any of them raised.
+class BackgroundWorker {
+public:
+    BackgroundWorker();
+    ~BackgroundWorker();
+
+    BackgroundWorker(const BackgroundWorker&) = delete;
+    BackgroundWorker& operator=(const BackgroundWorker&) = delete;
+
+    void submit(std::function<void()> task);
+    void wait();
+
+private:
+    std::thread worker;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable cv;
+    int running = 0;
+    bool stopping = false;
+    std::exception_ptr error;
+
+    void run();
+};
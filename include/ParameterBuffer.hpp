@@ -0,0 +1,64 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <utility>
+#include "Matrix.hpp"
+
+// One contiguous value buffer and one contiguous gradient buffer covering a list of parameter matrices.
+// This is a gather/scatter staging copy, not the weights' backing storage: each parameter still lives in its
+// own Var node, and values/grads only mirror them between a gather*() and the matching scatter*(). Every step
+// pays one copy out and one copy back per parameter, in exchange for optimizers, clipping, reductions and
+// checkpoints working on plain arrays. Writing values without scatterValues() does not change the model.
+class ParameterBuffer {
+public:
+    std::vector<double> values;
+    std::vector<double> grads;
+
+    // (offset, size) of each parameter matrix inside the flat buffers
+    std::vector<std::pair<size_t, size_t>> slices;
+
+    ParameterBuffer() = default;
+    explicit ParameterBuffer(const std::vector<Matrix*>& params);
+    ~ParameterBuffer();
+
+    ParameterBuffer(const ParameterBuffer& other);
+    ParameterBuffer& operator=(const ParameterBuffer& other);
+
+    size_t size() const;
+
+    // Copy values and gradients out of the Var nodes
+    void gather();
+    void gatherGrads();
+
+    // Values and gradients of flat indices [begin, end) only
+    void gather(size_t begin, size_t end);
+
+    // Gradients of flat indices [begin, end) only, e.g. one communication bucket
+    void gatherGrads(size_t begin, size_t end);
+
+    // Write the flat values (or gradients) back into the Var nodes
+    void scatterValues();
+    void scatterGrads();
+    void scatterValues(size_t begin, size_t end);
+
+    double gradNorm() const;
+
+    // Scales the flat gradients so their L2 norm is at most max_norm, returning the norm before clipping
+    double clipGradNorm(double max_norm);
+
+    // Gradient-ready tracking for work that overlaps backward. Until finishGradientTracking(), `ready(slice)`
+    // runs on the backward thread as soon as every gradient in that slice is final. finishGradientTracking()
+    // then reports the slices backward never completed (parameters outside the graph) and stops tracking.
+    void trackGradients(std::function<void(size_t slice)> ready);
+    void finishGradientTracking();
+
+private:
+    std::vector<Var*> vars;
+
+    std::function<void(size_t)> ready_callback;
+    std::vector<size_t> pending_grads;
+    std::vector<int> hook_ids;
+
+    void clearGradientHooks();
+};
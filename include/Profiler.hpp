@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Counters.hpp"
+#include "NeuralNetwork.hpp"
+
+// Per-step averages for one layer over the sampled steps
+struct LayerProfile {
+    std::string name;
+    double forward_ms = 0.0;
+
+    // Estimated: each sampled backward pass is split across layers by their share of the step's graph
+    // (nodes plus edges, which is what backward walks)
+    double backward_ms = 0.0;
+
+    // Var nodes and edges created and bytes taken from the memory pool (nodes, edges and matrix storage)
+    double nodes = 0.0;
+    double edges = 0.0;
+    double bytes = 0.0;
+};
+
+struct ProfileReport {
+    // Training (grad-enabled) forward passes seen and how many of them were profiled
+    int64_t steps = 0;
+    int64_t sampled_steps = 0;
+
+    // One entry per layer in model order, then a "loss" entry for the graph built by the loss function
+    std::vector<LayerProfile> layers;
+    double optimizer_ms = 0.0;
+
+    // Text table with one row per layer, named as in getNetworkArchitecture()
+    std::string table() const;
+};
+
+// Attaches to a network and profiles one step in every sample_every: per-layer forward time from
+// NeuralNetwork::forward/forwardBuffered, plus backward and optimizer time from Trainer::step (custom training
+// loops report theirs with recordBackward/recordOptimizer). Unsampled steps cost one atomic increment.
+// Only forward passes that record gradients count as steps, so concurrent predict calls neither get profiled
+// nor shift which training steps are sampled. Node and byte counts are process-wide, so forward passes running concurrently on other threads inflate them.
+class LayerProfiler {
+public:
+    int sample_every;
+
+    LayerProfiler(NeuralNetwork* model, int sample_every = 1);
+
+    // Detaches from the network
+    ~LayerProfiler();
+
+    LayerProfiler(const LayerProfiler&) = delete;
+    LayerProfiler& operator=(const LayerProfiler&) = delete;
+
+    // Called at the start of every forward pass; true when this pass is sampled (never while grad is disabled)
+    bool beginForward();
+
+    // Runs one layer of a sampled forward pass, recording its time, graph size and bytes
+    template <typename F>
+    void timeLayer(size_t layer, F&& run) {
+        GraphCounts before = GraphCounts::read();
+        Clock::time_point start = Clock::now();
+
+        run();
+
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        recordLayer(layer, ms, GraphCounts::read() - before);
+    }
+
+    // True between a sampled forward pass and the recordBackward of its step
+    bool stepSampled() const;
+
+    // Both are ignored unless the step's forward pass was sampled
+    void recordBackward(double ms);
+    void recordOptimizer(double ms);
+
+    ProfileReport getReport() const;
+    void reset();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct GraphCounts {
+        int64_t nodes = 0;
+        int64_t edges = 0;
+        int64_t bytes = 0;
+
+        static GraphCounts read() {
+            return { readCounter(Counter::NodesCreated), readCounter(Counter::EdgesCreated), readCounter(Counter::PoolBytes) };
+        }
+
+        GraphCounts operator-(const GraphCounts& other) const {
+            return { nodes - other.nodes, edges - other.edges, bytes - other.bytes };
+        }
+
+        int64_t work() const { return nodes + edges; }
+    };
+
+    struct LayerTotals {
+        double forward_ms = 0.0;
+        double backward_ms = 0.0;
+        GraphCounts counts;
+    };
+
+    NeuralNetwork* neural_network;
+    std::atomic<int64_t> forward_calls{ 0 };
+
+    mutable std::mutex mutex;
+    std::vector<LayerTotals> totals;
+    LayerTotals loss_totals;
+    double optimizer_ms = 0.0;
+    int64_t sampled_steps = 0;
+
+    // Graph built by each layer in the current sampled step, and the counters when its forward pass ended
+    std::vector<GraphCounts> step_counts;
+    GraphCounts forward_end;
+    std::atomic<bool> awaiting_backward{ false };
+    bool awaiting_optimizer = false;
+
+    void recordLayer(size_t layer, double ms, GraphCounts counts);
+};
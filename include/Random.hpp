@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Counter-based random numbers (Philox4x32-10). Every value is a pure function of (seed, stream, index),
+// so fills can be split across any number of threads and still produce identical results.
+
+// Seeds the global generator and restarts the stream sequence, making subsequent draws reproducible
+void setSeed(uint64_t seed);
+uint64_t getSeed();
+
+// Reserves a fresh stream from the global generator; each fill, init or shuffle should take its own
+uint64_t nextStream();
+
+void philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]);
+
+// Fill out[0..n) with draws from stream `stream` of the current seed
+void fillUniform(double* out, int64_t n, double low, double high, uint64_t stream);
+void fillNormal(double* out, int64_t n, double mean, double stddev, uint64_t stream);
+
+// Fisher-Yates shuffle of [0, n) driven by stream `stream`
+std::vector<int64_t> randomPermutation(int64_t n, uint64_t stream);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+#include "Matrix.hpp"
+
+// Compressed sparse row (CSR) matrix of constant values, for inputs that are mostly zeros.
+// Row i holds the non-zeros values[indptr[i]..indptr[i + 1]) at columns indices[indptr[i]..indptr[i + 1]).
+class SparseMatrix {
+public:
+    int rows, cols;
+    std::vector<int> indptr;
+    std::vector<int> indices;
+    std::vector<double> values;
+
+    SparseMatrix();
+
+    SparseMatrix(int r, int c, std::vector<int> row_ptr, std::vector<int> col_indices, std::vector<double> vals);
+
+    static SparseMatrix fromDense(const Matrix& dense);
+    Matrix toDense() const;
+
+    int nnz() const;
+};
+
+// Sparse x dense product. Each output element is one node whose parents are only the rows of X1
+// selected by the non-zero columns of X0, so backward never visits the zero entries.
+Matrix matmul(SparseMatrix& X0, Matrix& X1);
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Timeline tracing exported as Chrome trace JSON (chrome://tracing, ui.perfetto.dev). TRACE_SCOPE spans are
+// written to a ring buffer owned by the recording thread, so recording takes no locks; each thread keeps its
+// most recent TRACE_BUFFER_EVENTS spans. While tracing is off a scope costs one relaxed load and a branch.
+// Define AUTONEURONET_DISABLE_TRACING to compile the scopes out entirely.
+
+static const uint64_t TRACE_BUFFER_EVENTS = 1 << 16;
+
+extern std::atomic<bool> tracing_enabled;
+
+inline bool isTracingEnabled() {
+    return tracing_enabled.load(std::memory_order_relaxed);
+}
+
+void setTracingEnabled(bool enabled);
+
+// Drops every recorded span
+void clearTrace();
+
+// Writes the recorded spans of every thread, oldest first. Turn tracing off (or let the traced threads go idle)
+// first: a thread that keeps recording may overwrite spans while they are copied.
+void writeChromeTrace(const std::string& path);
+
+// Stable copy of a runtime string for use as a span name
+const char* internTraceName(const std::string& name);
+
+void recordTraceSpan(const char* name, int64_t start_ns, int64_t end_ns);
+
+int64_t traceClockNanoseconds();
+
+// Records the span from construction to destruction when tracing was on at construction
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) {
+        if (isTracingEnabled()) {
+            this->name = name;
+            start_ns = traceClockNanoseconds();
+        }
+    }
+
+    explicit TraceScope(const std::string& name) {
+        if (isTracingEnabled()) {
+            this->name = internTraceName(name);
+            start_ns = traceClockNanoseconds();
+        }
+    }
+
+    ~TraceScope() {
+        if (name != nullptr) {
+            recordTraceSpan(name, start_ns, traceClockNanoseconds());
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name = nullptr;
+    int64_t start_ns = 0;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+// TRACE_SCOPE("Name") takes a string literal; a std::string name is interned, which only happens while tracing
+#ifdef AUTONEURONET_DISABLE_TRACING
+#define TRACE_SCOPE(name) ((void)0)
+#else
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#endif
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "DataLoader.hpp"
+#include "NeuralNetwork.hpp"
+#include "Optimizers.hpp"
+#include "Parallel.hpp"
+
+using LossFunction = std::function<Var(Matrix& labels, Matrix& preds)>;
+
+// "mse", "mae" or "bce"
+LossFunction getLossFunction(const std::string& name);
+
+// Progress passed to fit callbacks
+struct TrainingStats {
+    int epoch = 0;
+    int64_t step = 0;
+
+    // Mean batch loss since the previous callback
+    double loss = 0.0;
+
+    double samples_per_second = 0.0;
+};
+
+using TrainingCallback = std::function<void(const TrainingStats& stats)>;
+
+// Runs the resetGrad / forward / loss / backward / optimize loop natively, so a whole epoch costs one call
+// from Python instead of several per batch
+class Trainer {
+public:
+    NeuralNetwork* neural_network;
+    LossFunction loss_function;
+    Optimizer* optimizer;
+
+    // When set, step() updates each parameter slice on a background thread as soon as backward has finalized
+    // its gradients, overlapping the optimizer with the rest of backward. The result is the same as optimize().
+    bool overlap_optimizer = false;
+
+    Trainer(NeuralNetwork* model, LossFunction loss, Optimizer* optimizer);
+    virtual ~Trainer() = default;
+
+    // One optimizer step on a single batch, returning its loss
+    virtual double step(Matrix& features, Matrix& labels);
+
+    // Trains for `epochs` passes over the loader and returns the mean batch loss of each epoch.
+    // `callback` (if set) runs every `callback_every` steps and at the end of each epoch.
+    std::vector<double> fit(DataLoader& data, int epochs, TrainingCallback callback = nullptr, int callback_every = 100);
+    std::vector<double> fit(std::shared_ptr<Dataset> data, int epochs, int batch_size, bool shuffle = true,
+        TrainingCallback callback = nullptr, int callback_every = 100);
+
+    // Mean batch loss over the loader without recording gradients
+    double evaluate(DataLoader& data);
+
+private:
+    std::unique_ptr<BackgroundWorker> optimizer_worker;
+};
@@ -1,9 +1,29 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <vector>
 #include <utility>
 #include <cmath>
 #include <memory>
+#include "MemoryPool.hpp"
+
+// Shape and size of the graph reachable from a Var, as seen through its parent edges
+struct GraphStats {
+    int64_t nodes = 0;
+    int64_t edges = 0;
+
+    // Longest chain of edges from the root down to a leaf
+    int64_t max_depth = 0;
+
+    // Bucket 0 counts nodes with no edges, bucket k >= 1 those with [2^(k-1), 2^k). Fan-in counts a node's
+    // parents (its inputs), fan-out the nodes within this graph that use it as a parent.
+    std::vector<int64_t> fan_in_histogram;
+    std::vector<int64_t> fan_out_histogram;
+
+    // Estimated from the pool blocks holding each node and its edge array
+    int64_t bytes = 0;
+};
 
 class Var {
 public:
@@ -12,13 +32,29 @@ public:
         double grad = 0.0;
         int pending_children = 0;
 
+        // Gradient-ready hook id (see registerGradientHook), -1 for none, CONSTANT_NODE for Var::constant; fits in
+        // the padding after pending_children
+        int hook = -1;
+
         // Have to use shared_ptr because it keeps each Node alive until no Var refers to it, allowing for intermediate/temporary Var objects
-        std::vector<std::pair<double, std::shared_ptr<Node>>> parents;
+        // Edges are allocated from the pool like the nodes themselves, so rebuilding a same-shaped graph reuses the memory
+        std::vector<std::pair<double, std::shared_ptr<Node>>, PoolAllocator<std::pair<double, std::shared_ptr<Node>>>> parents;
+
+        Node() = default;
+
+        // Counts the node out of getLiveNodeCount()
+        ~Node();
     };
 
+    static const int CONSTANT_NODE = -2;
+
     Var();
     Var(double initial);
 
+    // A value ops read but never record as a parent, so it gets no gradient and backward never reaches it
+    // (e.g. the zeros Conv2D pads with)
+    static Var constant(double value);
+
     ~Var() = default;
 
     double getVal() const;
@@ -29,6 +65,15 @@ public:
 
     void resetGradAndParents();
 
+    // Records `parent` as an input with local gradient ∂this/∂parent (a no-op while gradients are disabled).
+    // Every op goes through here; fused kernels use it to build a single node over many terms instead of
+    // a chain of binary ops.
+    void addParent(double local_grad, Var& parent);
+    void reserveParents(size_t n);
+
+    // Tags this node so backward runs the hook registered under `id` once its gradient is final (-1 clears)
+    void setGradientHook(int id);
+
     Var add(Var& other);
     Var operator+(Var& other) { return add(other); };
 
@@ -78,6 +123,42 @@ public:
 
     void backward();
 
+    // Walks the whole graph below this Var; O(nodes + edges) time and memory
+    GraphStats getGraphStats() const;
+
 private:
     std::shared_ptr<Node> node;
 };
+
+// Var nodes currently alive in the process, and created since it started
+int64_t getLiveNodeCount();
+int64_t getCreatedNodeCount();
+
+// Gradient recording is per thread. While it is off, ops only compute values and never touch their inputs'
+// nodes, so any number of threads can run forward passes over the same parameters at once.
+bool isGradEnabled();
+void setGradEnabled(bool enabled);
+
+// Gradient-ready hooks. backward runs a hook on its own thread the moment a tagged node's pending_children
+// reaches zero, i.e. once every contribution to its gradient has arrived, while earlier parts of the graph are
+// still being differentiated. Hooks must not touch nodes backward has yet to reach.
+using GradientHook = std::function<void()>;
+
+int registerGradientHook(GradientHook hook);
+
+// Nodes still tagged with the id become inert until the id is handed out again, so clear the tags first. Safe
+// while another thread's backward is running the hook: that call finishes on its own copy.
+void unregisterGradientHook(int id);
+
+// Turns gradient recording off for the current thread until the guard goes out of scope
+class NoGradGuard {
+public:
+    NoGradGuard();
+    ~NoGradGuard();
+
+    NoGradGuard(const NoGradGuard&) = delete;
+    NoGradGuard& operator=(const NoGradGuard&) = delete;
+
+private:
+    bool previous;
+};
@@ -1,16 +1,144 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/functional.h>
+#include <pybind11/numpy.h>
+#include <algorithm>
+#include <mutex>
 #include "include/Var.hpp"
 #include "include/Matrix.hpp"
+#include "include/SparseMatrix.hpp"
+#include "include/ParameterBuffer.hpp"
 #include "include/NeuralNetwork.hpp"
 #include "include/Optimizers.hpp"
 #include "include/LossFunctions.hpp"
+#include "include/MemoryPool.hpp"
+#include "include/Parallel.hpp"
+#include "include/Random.hpp"
+#include "include/Dataset.hpp"
+#include "include/DataLoader.hpp"
+#include "include/MappedDataset.hpp"
+#include "include/Checkpoint.hpp"
+#include "include/Trainer.hpp"
+#include "include/DataParallel.hpp"
+#include "include/Communicator.hpp"
+#include "include/Distributed.hpp"
+#include "include/InferenceEngine.hpp"
+#include "include/InferenceExport.hpp"
+#include "include/Profiler.hpp"
+#include "include/Trace.hpp"
 
 namespace py = pybind11;
 
+using DoubleArray = py::array_t<double, py::array::c_style | py::array::forcecast>;
+
+// Native calls drop the GIL so other Python threads keep running. Recording gradients and updating weights
+// write shared state without fine-grained locks (pending_children on parameter nodes, Embedding's active rows,
+// activation buffers, optimizer state), so calls made through a model or optimizer also hold the model's
+// training_lock, and at most one thread trains each model at a time. Calls that belong to no one model
+// (Var.backward, losses, matmul, a single layer's forward/optimizeWeights/resetGrad) take no lock: a graph, its
+// input matrices and the layers it runs through must be used by one recording thread at a time, and not while
+// another thread trains a model holding those layers.
+
+// Drops the GIL, then holds `model`'s training lock if `lock` is set. The GIL goes first, so a thread waiting
+// for the lock never blocks the holder when it needs the GIL back for a Python callback.
+class ModelGuard {
+public:
+    ModelGuard(NeuralNetwork& model, bool lock) {
+        if (lock) {
+            training = std::unique_lock<std::recursive_mutex>(*model.training_lock);
+        }
+    }
+
+private:
+    py::gil_scoped_release release;
+    std::unique_lock<std::recursive_mutex> training;
+};
+
+// (rows, cols) of a 1-D or 2-D array; 1-D arrays are treated as a single column
+static std::pair<int, int> arrayShape(const DoubleArray& array) {
+    if (array.ndim() == 1) {
+        return { static_cast<int>(array.shape(0)), 1 };
+    }
+    if (array.ndim() == 2) {
+        return { static_cast<int>(array.shape(0)), static_cast<int>(array.shape(1)) };
+    }
+    throw std::runtime_error("Expected a 1-D or 2-D array");
+}
+
+// Bulk copy of a Matrix's values (or gradients) into a new (rows, cols) array
+static DoubleArray toNumpy(const Matrix& M, bool grads) {
+    DoubleArray out({ M.rows, M.cols });
+    double* ptr = out.mutable_data();
+    if (grads) {
+        M.getGrads(ptr);
+    } else {
+        M.getVals(ptr);
+    }
+    return out;
+}
+
+// The runtime's scratch buffers make run() unsafe to call concurrently, and run drops the GIL, so each
+// Python-side runtime carries a lock
+struct LockedInferenceRuntime : public InferenceRuntime<double> {
+    using InferenceRuntime<double>::InferenceRuntime;
+
+    std::mutex mutex;
+};
+
+// Flat-buffer transfers for ParameterBuffer
+static DoubleArray copyToNumpy(const std::vector<double>& values) {
+    DoubleArray out(static_cast<py::ssize_t>(values.size()));
+    std::copy(values.begin(), values.end(), out.mutable_data());
+    return out;
+}
+
+static void copyFromNumpy(const DoubleArray& array, std::vector<double>& values) {
+    if (static_cast<size_t>(array.size()) != values.size()) {
+        throw std::runtime_error("Array has " + std::to_string(array.size()) + " values, expected " + std::to_string(values.size()));
+    }
+    std::copy(array.data(), array.data() + array.size(), values.begin());
+}
+
+static std::vector<int> toIntVector(py::handle array) {
+    auto values = array.cast<py::array_t<int, py::array::c_style | py::array::forcecast>>();
+    return std::vector<int>(values.data(), values.data() + values.size());
+}
+
+// Read-only NumPy view of columns [first_col, first_col + cols) of a mapped dataset's payload
+static py::array mappedView(py::object owner, int first_col, int cols) {
+    const MappedDataset& dataset = owner.cast<const MappedDataset&>();
+    size_t item_size = dataTypeSize(dataset.dtype());
+    py::dtype dtype = dataset.dtype() == DataType::Float64 ? py::dtype::of<double>() : py::dtype::of<float>();
+
+    const char* start = static_cast<const char*>(dataset.data()) + first_col * item_size;
+    py::array view(dtype,
+        { static_cast<py::ssize_t>(dataset.size()), static_cast<py::ssize_t>(cols) },
+        { static_cast<py::ssize_t>(dataset.rowBytes()), static_cast<py::ssize_t>(item_size) },
+        start, owner);
+
+    // The mapping is PROT_READ, so writes must be refused rather than fault
+    view.attr("setflags")(py::arg("write") = false);
+    return view;
+}
+
 PYBIND11_MODULE(autoneuronet, m) {
     m.doc() = "AutoNeuroNet is a library for automatic differentiation and neural networks.";
 
+    py::class_<GraphStats>(m, "GraphStats", R"doc(
+Size and shape of the graph below a Var. Histogram bucket 0 counts nodes with no edges and bucket k >= 1
+those with 2^(k-1) to 2^k - 1; bytes is estimated from the pool blocks of the nodes and their edge arrays.
+)doc")
+        .def_readonly("nodes", &GraphStats::nodes)
+        .def_readonly("edges", &GraphStats::edges)
+        .def_readonly("max_depth", &GraphStats::max_depth)
+        .def_readonly("fan_in_histogram", &GraphStats::fan_in_histogram)
+        .def_readonly("fan_out_histogram", &GraphStats::fan_out_histogram)
+        .def_readonly("bytes", &GraphStats::bytes)
+        .def("__repr__", [](const GraphStats &stats) {
+            return "GraphStats(nodes=" + std::to_string(stats.nodes) + ", edges=" + std::to_string(stats.edges) +
+                ", max_depth=" + std::to_string(stats.max_depth) + ", bytes=" + std::to_string(stats.bytes) + ")";
+        });
+
     py::class_<Var>(m, "Var", 
         R"doc(
 A scalar value used for reverse-mode automatic differentiation.
@@ -77,7 +205,8 @@ after setting its gradient to 1.0 to accumulate gradients.
         .def("abs", &Var::abs)
 
         .def("resetGradAndParents", &Var::resetGradAndParents)
-        .def("backward", &Var::backward)
+        .def("backward", &Var::backward, py::call_guard<py::gil_scoped_release>())
+        .def("getGraphStats", &Var::getGraphStats, "Statistics of the graph reachable from this Var")
 
         .def("__repr__", [](const Var& v) {
             return "Var(val=" + std::to_string(v.getVal()) + ", grad=" + std::to_string(v.getGrad()) + ")";
@@ -135,6 +264,34 @@ A matrix of Var objects.
         .def("getValsMatrix", &Matrix::getValsMatrix)
         .def("getGradsMatrix", &Matrix::getGradsMatrix)
 
+        // Var nodes cannot be viewed as a strided buffer, so NumPy transfers are single bulk copies
+        .def_static("fromNumpy", [](DoubleArray array) {
+                std::pair<int, int> shape = arrayShape(array);
+                py::gil_scoped_release release;
+                Matrix M(shape.first, shape.second);
+                M.setVals(array.data());
+                return M;
+            },
+            py::arg("array"))
+        .def("setValues", [](Matrix &M, DoubleArray array) {
+                std::pair<int, int> shape = arrayShape(array);
+                if (shape.first != M.rows || shape.second != M.cols)
+                    throw std::runtime_error("Array shape does not match the Matrix");
+
+                // Overwrites the existing nodes, so graphs built on this Matrix see the new values
+                M.setVals(array.data());
+            },
+            py::arg("array"))
+        .def("values", [](const Matrix &M) {
+            return toNumpy(M, false);
+        })
+        .def("grads", [](const Matrix &M) {
+            return toNumpy(M, true);
+        })
+        .def("__array__", [](const Matrix &M, py::args, py::kwargs) {
+            return toNumpy(M, false);
+        })
+
         .def("add", static_cast<Matrix (Matrix::*)(Matrix&)>(&Matrix::add), py::arg("other"))
         .def("__add__", [](Matrix &A, Matrix &B) { return A.add(B); }, py::is_operator(), py::arg("other"))
 
@@ -152,8 +309,8 @@ A matrix of Var objects.
         .def("__mul__", [](Matrix &A, double s) { return A.multiply(s); }, py::is_operator(), py::arg("other"))
         .def("__rmul__", [](Matrix &A, double s) { return A.multiply(s); }, py::is_operator(), py::arg("other"))
 
-        .def("matmul", &Matrix::matmul, py::arg("other"))
-        .def("__matmul__", [](Matrix &A, Matrix &B) { return A.matmul(B); }, py::is_operator(), py::arg("other"))
+        .def("matmul", &Matrix::matmul, py::arg("other"), py::call_guard<py::gil_scoped_release>())
+        .def("__matmul__", [](Matrix &A, Matrix &B) { return A.matmul(B); }, py::is_operator(), py::arg("other"), py::call_guard<py::gil_scoped_release>())
 
         .def("divide", &Matrix::divide, py::arg("other"))
         .def("__truediv__", [](Matrix &A, double s) { return A.divide(s); }, py::is_operator(), py::arg("other"))
@@ -167,55 +324,176 @@ A matrix of Var objects.
         .def("sigmoid", &Matrix::sigmoid)
         .def("silu", &Matrix::silu)
         .def("elu", &Matrix::elu, py::arg("alpha") = 1.0)
-        .def("softmax", &Matrix::softmax)
+        .def("softmax", &Matrix::softmax, py::call_guard<py::gil_scoped_release>())
+
+        .def("add_", static_cast<Matrix& (Matrix::*)(Matrix&)>(&Matrix::add_), py::arg("other"), py::return_value_policy::reference_internal)
+        .def("add_", static_cast<Matrix& (Matrix::*)(double)>(&Matrix::add_), py::arg("other"), py::return_value_policy::reference_internal)
+        .def("mul_", static_cast<Matrix& (Matrix::*)(Matrix&)>(&Matrix::mul_), py::arg("other"), py::return_value_policy::reference_internal)
+        .def("mul_", static_cast<Matrix& (Matrix::*)(double)>(&Matrix::mul_), py::arg("other"), py::return_value_policy::reference_internal)
+        .def("relu_", &Matrix::relu_, py::return_value_policy::reference_internal)
+        .def("leakyRelu_", &Matrix::leakyRelu_, py::arg("alpha") = 0.01, py::return_value_policy::reference_internal)
+        .def("tanh_", &Matrix::tanh_, py::return_value_policy::reference_internal)
+        .def("sigmoid_", &Matrix::sigmoid_, py::return_value_policy::reference_internal)
+        .def("silu_", &Matrix::silu_, py::return_value_policy::reference_internal)
+        .def("elu_", &Matrix::elu_, py::arg("alpha") = 1.0, py::return_value_policy::reference_internal)
 
         .def("__repr__", [](const Matrix &M) {
             return "Matrix(" + std::to_string(M.rows) + " x " + std::to_string(M.cols) + ") = \n" + M.getValsMatrix();
         });
 
+    py::class_<SparseMatrix>(m, "SparseMatrix", R"doc(
+A CSR sparse matrix of constant values, for inputs that are mostly zeros.
+)doc")
+        .def(py::init<int, int, std::vector<int>, std::vector<int>, std::vector<double>>(),
+            py::arg("rows"), py::arg("cols"), py::arg("indptr"), py::arg("indices"), py::arg("values"))
+
+        .def_static("fromScipy", [](py::object sparse) {
+                // Accepts any scipy.sparse matrix or array; other formats are converted to CSR first
+                py::object csr = sparse.attr("tocsr")();
+                py::tuple shape = csr.attr("shape");
+
+                DoubleArray data = csr.attr("data").cast<DoubleArray>();
+
+                return SparseMatrix(
+                    shape[0].cast<int>(),
+                    shape[1].cast<int>(),
+                    toIntVector(csr.attr("indptr")),
+                    toIntVector(csr.attr("indices")),
+                    std::vector<double>(data.data(), data.data() + data.size()));
+            },
+            py::arg("sparse"))
+        .def_static("fromDense", &SparseMatrix::fromDense, py::arg("dense"))
+        .def("toDense", &SparseMatrix::toDense)
+
+        .def_readonly("rows", &SparseMatrix::rows)
+        .def_readonly("cols", &SparseMatrix::cols)
+        .def_readonly("indptr", &SparseMatrix::indptr)
+        .def_readonly("indices", &SparseMatrix::indices)
+        .def_readonly("values", &SparseMatrix::values)
+        .def("nnz", &SparseMatrix::nnz)
+
+        .def("__matmul__", [](SparseMatrix &A, Matrix &B) { return matmul(A, B); }, py::is_operator(), py::arg("other"), py::call_guard<py::gil_scoped_release>())
+
+        .def("__repr__", [](const SparseMatrix &S) {
+            return "SparseMatrix(" + std::to_string(S.rows) + " x " + std::to_string(S.cols) + ", nnz=" + std::to_string(S.nnz()) + ")";
+        });
+
+    py::class_<LayerConfig>(m, "LayerConfig")
+        .def(py::init<>())
+        .def_readwrite("type", &LayerConfig::type)
+        .def_readwrite("args", &LayerConfig::args)
+        .def_readwrite("options", &LayerConfig::options);
+
+    m.def("createLayer", &createLayer, py::arg("config"));
+
     py::class_<Layer, std::shared_ptr<Layer>>(m, "Layer", R"doc(
 Base class for all layers.
 )doc")
         .def_property_readonly("name", [](const Layer& layer) { return layer.name; })
-        .def_property_readonly("trainable", [](const Layer& layer) { return layer.trainable; });
+        .def_property_readonly("trainable", [](const Layer& layer) { return layer.trainable; })
+        .def("parameters", &Layer::parameters, py::return_value_policy::reference_internal)
+        .def("getConfig", &Layer::getConfig);
 
     py::class_<Linear, Layer, std::shared_ptr<Linear>>(m, "Linear", R"doc(
 Linear layer
 )doc")
         .def(py::init<int, int, std::string>(), py::arg("in_dim"), py::arg("out_dim"), py::arg("init") = "he")
-        .def("forward", &Linear::forward, py::arg("input"))
-        .def("optimizeWeights", &Linear::optimizeWeights, py::arg("learning_rate"))
-        .def("resetGrad", &Linear::resetGrad)
+        .def("forward", py::overload_cast<Matrix&>(&Linear::forward), py::arg("input"), py::call_guard<py::gil_scoped_release>())
+        .def("forward", py::overload_cast<SparseMatrix&>(&Linear::forward), py::arg("input"), py::call_guard<py::gil_scoped_release>())
+        .def("optimizeWeights", &Linear::optimizeWeights, py::arg("learning_rate"), py::call_guard<py::gil_scoped_release>())
+        .def("resetGrad", &Linear::resetGrad, py::call_guard<py::gil_scoped_release>())
         .def_readonly("W", &Linear::W)
         .def_readonly("b", &Linear::b);
 
+    py::class_<Conv2D, Layer, std::shared_ptr<Conv2D>>(m, "Conv2D", R"doc(
+2D convolution over images flattened per row in "nchw" or "nhwc" order, computed via im2col and matmul
+)doc")
+        .def(py::init<int, int, int, int, int, int, int, int, std::string, std::string>(),
+            py::arg("in_channels"), py::arg("out_channels"), py::arg("kernel_size"), py::arg("in_height"), py::arg("in_width"),
+            py::arg("stride") = 1, py::arg("padding") = 0, py::arg("dilation") = 1, py::arg("layout") = "nchw", py::arg("init") = "he")
+        .def("forward", &Conv2D::forward, py::arg("input"), py::call_guard<py::gil_scoped_release>())
+        .def("optimizeWeights", &Conv2D::optimizeWeights, py::arg("learning_rate"), py::call_guard<py::gil_scoped_release>())
+        .def("resetGrad", &Conv2D::resetGrad, py::call_guard<py::gil_scoped_release>())
+        .def_readonly("W", &Conv2D::W)
+        .def_readonly("b", &Conv2D::b)
+        .def_readonly("out_height", &Conv2D::out_height)
+        .def_readonly("out_width", &Conv2D::out_width);
+
+    py::class_<MaxPool2D, Layer, std::shared_ptr<MaxPool2D>>(m, "MaxPool2D")
+        .def(py::init<int, int, int, int, int, int, std::string>(),
+            py::arg("channels"), py::arg("kernel_size"), py::arg("in_height"), py::arg("in_width"),
+            py::arg("stride") = 0, py::arg("padding") = 0, py::arg("layout") = "nchw")
+        .def("forward", &MaxPool2D::forward, py::arg("input"), py::call_guard<py::gil_scoped_release>())
+        .def_readonly("out_height", &MaxPool2D::out_height)
+        .def_readonly("out_width", &MaxPool2D::out_width);
+
+    py::class_<AvgPool2D, Layer, std::shared_ptr<AvgPool2D>>(m, "AvgPool2D")
+        .def(py::init<int, int, int, int, int, int, std::string>(),
+            py::arg("channels"), py::arg("kernel_size"), py::arg("in_height"), py::arg("in_width"),
+            py::arg("stride") = 0, py::arg("padding") = 0, py::arg("layout") = "nchw")
+        .def("forward", &AvgPool2D::forward, py::arg("input"), py::call_guard<py::gil_scoped_release>())
+        .def_readonly("out_height", &AvgPool2D::out_height)
+        .def_readonly("out_width", &AvgPool2D::out_width);
+
+    py::class_<Embedding, Layer, std::shared_ptr<Embedding>>(m, "Embedding", R"doc(
+Lookup table mapping integer ids to trainable vectors, updated row-sparsely with plain SGD; models that contain
+one train with GradientDescentOptimizer (the other optimizers raise)
+)doc")
+        .def(py::init<int, int>(), py::arg("num"), py::arg("dim"))
+        .def("forward", &Embedding::forward, py::arg("input"), py::call_guard<py::gil_scoped_release>())
+        .def("optimizeWeights", &Embedding::optimizeWeights, py::arg("learning_rate"), py::call_guard<py::gil_scoped_release>())
+        .def("resetGrad", &Embedding::resetGrad, py::call_guard<py::gil_scoped_release>())
+        .def("getGradRows", &Embedding::getGradRows)
+        .def("getGradValues", &Embedding::getGradValues)
+        .def("getEmbedding", &Embedding::getEmbedding, py::arg("id"))
+        .def_readonly("num_embeddings", &Embedding::num_embeddings)
+        .def_readonly("embedding_dim", &Embedding::embedding_dim);
+
     py::class_<ReLU, Layer, std::shared_ptr<ReLU>>(m, "ReLU")
         .def(py::init<>())
-        .def("forward", &ReLU::forward, py::arg("input"));
+        .def("forward", &ReLU::forward, py::arg("input"), py::call_guard<py::gil_scoped_release>());
 
     py::class_<LeakyReLU, Layer, std::shared_ptr<LeakyReLU>>(m, "LeakyReLU")
         .def(py::init<double>(), py::arg("alpha"))
-        .def("forward", &LeakyReLU::forward, py::arg("input"));
+        .def("forward", &LeakyReLU::forward, py::arg("input"), py::call_guard<py::gil_scoped_release>());
 
     py::class_<Sigmoid, Layer, std::shared_ptr<Sigmoid>>(m, "Sigmoid")
         .def(py::init<>())
-        .def("forward", &Sigmoid::forward, py::arg("input"));
+        .def("forward", &Sigmoid::forward, py::arg("input"), py::call_guard<py::gil_scoped_release>());
 
     py::class_<Tanh, Layer, std::shared_ptr<Tanh>>(m, "Tanh")
         .def(py::init<>())
-        .def("forward", &Tanh::forward, py::arg("input"));
+        .def("forward", &Tanh::forward, py::arg("input"), py::call_guard<py::gil_scoped_release>());
 
     py::class_<SiLU, Layer, std::shared_ptr<SiLU>>(m, "SiLU")
         .def(py::init<>())
-        .def("forward", &SiLU::forward, py::arg("input"));
+        .def("forward", &SiLU::forward, py::arg("input"), py::call_guard<py::gil_scoped_release>());
 
     py::class_<ELU, Layer, std::shared_ptr<ELU>>(m, "ELU")
         .def(py::init<double>(), py::arg("alpha"))
-        .def("forward", &ELU::forward, py::arg("input"));
+        .def("forward", &ELU::forward, py::arg("input"), py::call_guard<py::gil_scoped_release>());
 
     py::class_<Softmax, Layer, std::shared_ptr<Softmax>>(m, "Softmax")
         .def(py::init<>())
-        .def("forward", &Softmax::forward, py::arg("input"));
+        .def("forward", &Softmax::forward, py::arg("input"), py::call_guard<py::gil_scoped_release>());
+
+    py::class_<ParameterBuffer>(m, "ParameterBuffer", R"doc(
+Flat value and gradient buffers over every dense parameter of a NeuralNetwork.
+)doc")
+        .def("size", &ParameterBuffer::size)
+        .def("gather", &ParameterBuffer::gather)
+        .def("gatherGrads", &ParameterBuffer::gatherGrads)
+        .def("scatterValues", &ParameterBuffer::scatterValues)
+        .def("gradNorm", &ParameterBuffer::gradNorm)
+        .def("clipGradNorm", &ParameterBuffer::clipGradNorm, py::arg("max_norm"))
+        // Copies, since the network replaces its buffer (and frees the storage) when its parameters change;
+        // assign a whole array to write the flat buffer back
+        .def_property("values",
+            [](const ParameterBuffer& buffer) { return copyToNumpy(buffer.values); },
+            [](ParameterBuffer& buffer, DoubleArray array) { copyFromNumpy(array, buffer.values); })
+        .def_property("grads",
+            [](const ParameterBuffer& buffer) { return copyToNumpy(buffer.grads); },
+            [](ParameterBuffer& buffer, DoubleArray array) { copyFromNumpy(array, buffer.grads); });
 
     py::class_<NeuralNetwork>(m, "NeuralNetwork", R"doc(
 A simple feed-forward neural network built from Matrix layers.
@@ -225,25 +503,506 @@ A simple feed-forward neural network built from Matrix layers.
         .def("getLayers", py::overload_cast<>(&NeuralNetwork::getLayers, py::const_))
         .def_property_readonly("layers", py::overload_cast<>(&NeuralNetwork::getLayers, py::const_))
 
-        .def("addLayer", &NeuralNetwork::addLayer, py::arg("layer"))
-        .def("forward", &NeuralNetwork::forward, py::arg("input"))
+        .def("addLayer", [](NeuralNetwork& model, std::shared_ptr<Layer> layer) {
+            ModelGuard guard(model, true);
+            model.addLayer(std::move(layer));
+        }, py::arg("layer"))
+        // Without gradient recording, forward only reads the model and skips the training lock
+        .def("forward", [](NeuralNetwork& model, Matrix& input) {
+            ModelGuard guard(model, isGradEnabled());
+            return model.forward(input);
+        }, py::arg("input"))
+        .def("forward", [](NeuralNetwork& model, SparseMatrix& input) {
+            ModelGuard guard(model, isGradEnabled());
+            return model.forward(input);
+        }, py::arg("input"))
+        .def("predict", &NeuralNetwork::predict, py::arg("input"), py::call_guard<py::gil_scoped_release>(), R"doc(
+Forward pass without gradient recording. Several Python threads may call predict on the same model at once.
+)doc")
+        .def("forwardBuffered", [](NeuralNetwork& model, Matrix& input) -> Matrix& {
+            ModelGuard guard(model, true);
+            return model.forwardBuffered(input);
+        }, py::arg("input"), py::return_value_policy::reference_internal)
         .def("getNetworkArchitecture", &NeuralNetwork::getNetworkArchitecture)
+        .def("parameters", &NeuralNetwork::parameters, py::return_value_policy::reference_internal)
+        .def("numParameters", &NeuralNetwork::numParameters)
+        .def("getParameterBuffer", &NeuralNetwork::getParameterBuffer, py::return_value_policy::reference_internal)
         
         .def("__repr__", [](const NeuralNetwork &model) {
             return "NeuralNetwork =\n" + model.getNetworkArchitecture();
         });
 
-    py::class_<GradientDescentOptimizer>(m, "GradientDescentOptimizer", R"doc(
+    py::class_<Optimizer>(m, "Optimizer", R"doc(
+Base class for optimizers that update a NeuralNetwork's flat parameter buffer.
+)doc")
+        .def("optimize", [](Optimizer& optimizer) {
+            ModelGuard guard(*optimizer.neural_network, true);
+            optimizer.optimize();
+        })
+        .def("beginStep", [](Optimizer& optimizer) {
+            ModelGuard guard(*optimizer.neural_network, true);
+            optimizer.beginStep();
+        })
+        .def("optimizeSlice", [](Optimizer& optimizer, size_t slice) {
+            ModelGuard guard(*optimizer.neural_network, true);
+            optimizer.optimizeSlice(slice);
+        }, py::arg("slice"))
+        .def("finishStep", [](Optimizer& optimizer) {
+            ModelGuard guard(*optimizer.neural_network, true);
+            optimizer.finishStep();
+        })
+        .def("resetGrad", [](Optimizer& optimizer) {
+            ModelGuard guard(*optimizer.neural_network, true);
+            optimizer.resetGrad();
+        })
+        .def("getType", &Optimizer::getType)
+        .def_readwrite("learning_rate", &Optimizer::learning_rate);
+
+    py::class_<GradientDescentOptimizer, Optimizer>(m, "GradientDescentOptimizer", R"doc(
 Simple gradient descent optimizer for a NeuralNetwork.
 )doc")
-        .def(py::init<double, NeuralNetwork*>(), py::arg("learning_rate"), py::arg("model"), py::keep_alive<1, 2>())
-        .def("optimize", &GradientDescentOptimizer::optimize)
-        .def("resetGrad", &GradientDescentOptimizer::resetGrad);
+        .def(py::init<double, NeuralNetwork*>(), py::arg("learning_rate"), py::arg("model"), py::keep_alive<1, 2>());
+
+    py::class_<MomentumOptimizer, Optimizer>(m, "MomentumOptimizer", R"doc(
+Gradient descent with heavy-ball momentum.
+)doc")
+        .def(py::init<double, NeuralNetwork*, double>(), py::arg("learning_rate"), py::arg("model"), py::arg("momentum") = 0.9, py::keep_alive<1, 2>())
+        .def_readwrite("momentum", &MomentumOptimizer::momentum);
+
+    py::class_<AdamOptimizer, Optimizer>(m, "AdamOptimizer", R"doc(
+Adam optimizer; weight_decay is applied as an L2 term on the gradient.
+)doc")
+        .def(py::init<double, NeuralNetwork*, double, double, double, double>(),
+            py::arg("learning_rate"), py::arg("model"), py::arg("beta1") = 0.9, py::arg("beta2") = 0.999, py::arg("eps") = 1e-8, py::arg("weight_decay") = 0.0,
+            py::keep_alive<1, 2>())
+        .def_readonly("step_count", &AdamOptimizer::step_count);
+
+    py::class_<AdamWOptimizer, AdamOptimizer>(m, "AdamWOptimizer", R"doc(
+Adam with decoupled weight decay.
+)doc")
+        .def(py::init<double, NeuralNetwork*, double, double, double, double>(),
+            py::arg("learning_rate"), py::arg("model"), py::arg("beta1") = 0.9, py::arg("beta2") = 0.999, py::arg("eps") = 1e-8, py::arg("weight_decay") = 0.01,
+            py::keep_alive<1, 2>());
+
+    py::class_<LBFGSOptimizer>(m, "LBFGSOptimizer", R"doc(
+L-BFGS for full-batch problems. `step(closure)` calls `closure()` to run the forward pass and return the loss.
+)doc")
+        .def(py::init<NeuralNetwork*, double, int, int, double, double, int>(),
+            py::arg("model"), py::arg("learning_rate") = 1.0, py::arg("history_size") = 10, py::arg("max_iterations") = 20,
+            py::arg("tolerance_grad") = 1e-7, py::arg("tolerance_change") = 1e-9, py::arg("max_line_search") = 25,
+            py::keep_alive<1, 2>())
+        // The closure runs with the GIL reacquired and the lock still held, so it may call back into the model
+        .def("step", [](LBFGSOptimizer& optimizer, const std::function<Var()>& closure) {
+            ModelGuard guard(*optimizer.neural_network, true);
+            return optimizer.step(closure);
+        }, py::arg("closure"))
+        .def("resetGrad", [](LBFGSOptimizer& optimizer) {
+            ModelGuard guard(*optimizer.neural_network, true);
+            optimizer.resetGrad();
+        })
+        .def("getEvaluationCount", &LBFGSOptimizer::getEvaluationCount)
+        .def_readwrite("learning_rate", &LBFGSOptimizer::learning_rate);
+
+    py::class_<Checkpoint>(m, "Checkpoint", R"doc(
+Checkpoint opened through mmap and validated against its checksum.
+)doc")
+        .def(py::init<const std::string&>(), py::arg("path"), py::call_guard<py::gil_scoped_release>())
+        .def_readonly("layer_configs", &Checkpoint::layer_configs)
+        .def("createModel", &Checkpoint::createModel, py::call_guard<py::gil_scoped_release>())
+        .def("loadModel", [](const Checkpoint& checkpoint, NeuralNetwork& model) {
+            ModelGuard guard(model, true);
+            checkpoint.loadModel(model);
+        }, py::arg("model"))
+        .def("hasOptimizerState", &Checkpoint::hasOptimizerState)
+        .def("loadOptimizer", [](const Checkpoint& checkpoint, Optimizer& optimizer) {
+            ModelGuard guard(*optimizer.neural_network, true);
+            checkpoint.loadOptimizer(optimizer);
+        }, py::arg("optimizer"));
+
+    // Saving gathers the parameters into the model's flat buffer, so it waits for any step in progress
+    m.def("saveCheckpoint", [](const std::string& path, NeuralNetwork& model, Optimizer* optimizer) {
+        ModelGuard guard(model, true);
+        saveCheckpoint(path, model, optimizer);
+    }, py::arg("path"), py::arg("model"), py::arg("optimizer") = nullptr);
+    m.def("loadCheckpoint", &loadCheckpoint, py::arg("path"), py::call_guard<py::gil_scoped_release>());
+
+    py::class_<CheckpointWriter>(m, "CheckpointWriter", R"doc(
+Writes checkpoints on a background thread; saveAsync only blocks while the buffers are copied.
+)doc")
+        .def(py::init<>())
+        .def("saveAsync", [](CheckpointWriter& writer, const std::string& path, NeuralNetwork& model, Optimizer* optimizer) {
+            ModelGuard guard(model, true);
+            writer.saveAsync(path, model, optimizer);
+        }, py::arg("path"), py::arg("model"), py::arg("optimizer") = nullptr)
+        .def("wait", &CheckpointWriter::wait, py::call_guard<py::gil_scoped_release>());
+
+    py::class_<Dataset, std::shared_ptr<Dataset>>(m, "Dataset")
+        .def("size", &Dataset::size)
+        .def("featureDim", &Dataset::featureDim)
+        .def("labelDim", &Dataset::labelDim)
+        .def("__len__", &Dataset::size);
+
+    py::class_<InMemoryDataset, Dataset, std::shared_ptr<InMemoryDataset>>(m, "InMemoryDataset", R"doc(
+Dataset held in memory, built from (N, F) features and (N,) or (N, L) labels (arrays or nested lists).
+)doc")
+        .def(py::init([](DoubleArray features, DoubleArray labels) {
+            std::pair<int, int> feature_shape = arrayShape(features);
+            std::pair<int, int> label_shape = arrayShape(labels);
+            if (feature_shape.first != label_shape.first) {
+                throw std::runtime_error("Features and labels need the same number of rows");
+            }
+
+            return std::make_shared<InMemoryDataset>(
+                std::vector<double>(features.data(), features.data() + features.size()),
+                std::vector<double>(labels.data(), labels.data() + labels.size()),
+                feature_shape.second, label_shape.second);
+        }), py::arg("features"), py::arg("labels"));
+
+    m.def("loadCSV", [](const std::string& path, int num_label_cols, bool has_header) {
+        return std::make_shared<InMemoryDataset>(loadCSV(path, num_label_cols, has_header));
+    }, py::arg("path"), py::arg("num_label_cols") = 1, py::arg("has_header") = true);
+
+    py::enum_<DataType>(m, "DataType")
+        .value("float32", DataType::Float32)
+        .value("float64", DataType::Float64);
+
+    py::class_<MappedDataset, Dataset, std::shared_ptr<MappedDataset>>(m, "MappedDataset", R"doc(
+Dataset file opened through mmap; rows are paged in on demand, so opening is instant regardless of size.
+)doc")
+        .def(py::init<const std::string&>(), py::arg("path"))
+        .def_property_readonly("dtype", &MappedDataset::dtype)
+        .def("features", [](py::object self) {
+            const MappedDataset& dataset = self.cast<const MappedDataset&>();
+            return mappedView(self, 0, dataset.featureDim());
+        })
+        .def("labels", [](py::object self) {
+            const MappedDataset& dataset = self.cast<const MappedDataset&>();
+            return mappedView(self, dataset.featureDim(), dataset.labelDim());
+        });
+
+    m.def("convertCSV", &convertCSV, py::arg("csv_path"), py::arg("out_path"), py::arg("num_label_cols") = 1,
+        py::arg("has_header") = true, py::arg("dtype") = DataType::Float32, py::call_guard<py::gil_scoped_release>());
+
+    m.def("writeDataset", [](const std::string& path, const Dataset& dataset, DataType dtype) {
+        writeDataset(path, dataset, dtype);
+    }, py::arg("path"), py::arg("dataset"), py::arg("dtype") = DataType::Float32, py::call_guard<py::gil_scoped_release>());
+
+    m.def("writeDataset", [](const std::string& path, DoubleArray features, DoubleArray labels, DataType dtype) {
+        if (features.ndim() != 2 || labels.ndim() > 2 || labels.shape(0) != features.shape(0)) {
+            throw std::runtime_error("Expected features of shape (N, F) and labels of shape (N,) or (N, L)");
+        }
+
+        int64_t rows = features.shape(0);
+        int feature_dim = static_cast<int>(features.shape(1));
+        int label_dim = labels.ndim() == 2 ? static_cast<int>(labels.shape(1)) : 1;
+
+        const double* feature_data = features.data();
+        const double* label_data = labels.data();
+
+        py::gil_scoped_release release;
+        DatasetWriter writer(path, feature_dim, label_dim, dtype);
+        writer.writeRows(feature_data, label_data, rows);
+        writer.close();
+    }, py::arg("path"), py::arg("features"), py::arg("labels"), py::arg("dtype") = DataType::Float32);
+
+    py::class_<DataLoader>(m, "DataLoader", R"doc(
+Iterates over mini-batches of a Dataset as (features, labels) Matrix pairs, assembling the next batch
+on a background thread. The yielded matrices are reused and only valid until the next batch is requested.
+)doc")
+        .def(py::init<std::shared_ptr<Dataset>, int, bool, bool, bool>(),
+            py::arg("dataset"), py::arg("batch_size"), py::arg("shuffle") = true, py::arg("drop_last") = false, py::arg("prefetch") = true)
+        .def("numBatches", &DataLoader::numBatches)
+        .def("__len__", &DataLoader::numBatches)
+        .def("reset", &DataLoader::reset)
+        .def("__iter__", [](DataLoader& loader) -> DataLoader& {
+            loader.reset();
+            return loader;
+        }, py::return_value_policy::reference_internal)
+        .def("__next__", [](py::object self) {
+            DataLoader& loader = self.cast<DataLoader&>();
+            Batch* batch;
+            {
+                py::gil_scoped_release release;
+                batch = loader.next();
+            }
+            if (batch == nullptr) {
+                throw py::stop_iteration();
+            }
+
+            // Borrow the slot matrices; the loader object keeps them alive
+            return py::make_tuple(
+                py::cast(&batch->features, py::return_value_policy::reference_internal, self),
+                py::cast(&batch->labels, py::return_value_policy::reference_internal, self));
+        })
+        .def_readonly("batch_size", &DataLoader::batch_size)
+        .def_readonly("shuffle", &DataLoader::shuffle)
+        .def_readonly("drop_last", &DataLoader::drop_last);
+
+    py::class_<TrainingStats>(m, "TrainingStats")
+        .def_readonly("epoch", &TrainingStats::epoch)
+        .def_readonly("step", &TrainingStats::step)
+        .def_readonly("loss", &TrainingStats::loss)
+        .def_readonly("samples_per_second", &TrainingStats::samples_per_second)
+        .def("__repr__", [](const TrainingStats &stats) {
+            return "TrainingStats(epoch=" + std::to_string(stats.epoch) + ", step=" + std::to_string(stats.step) +
+                ", loss=" + std::to_string(stats.loss) + ")";
+        });
+
+    py::class_<LayerProfile>(m, "LayerProfile")
+        .def_readonly("name", &LayerProfile::name)
+        .def_readonly("forward_ms", &LayerProfile::forward_ms)
+        .def_readonly("backward_ms", &LayerProfile::backward_ms)
+        .def_readonly("nodes", &LayerProfile::nodes)
+        .def_readonly("edges", &LayerProfile::edges)
+        .def_readonly("bytes", &LayerProfile::bytes);
+
+    py::class_<ProfileReport>(m, "ProfileReport")
+        .def_readonly("steps", &ProfileReport::steps)
+        .def_readonly("sampled_steps", &ProfileReport::sampled_steps)
+        .def_readonly("layers", &ProfileReport::layers)
+        .def_readonly("optimizer_ms", &ProfileReport::optimizer_ms)
+        .def("table", &ProfileReport::table)
+        .def("__str__", &ProfileReport::table);
+
+    py::class_<LayerProfiler>(m, "LayerProfiler", R"doc(
+Profiles one training step in every sample_every: forward time, graph size and pool bytes per layer, backward
+time split across layers by graph size, and optimizer time. Trainer.step reports backward and optimizer time
+itself; custom loops call recordBackward/recordOptimizer. Detaches from the model when garbage collected.
+)doc")
+        .def(py::init<NeuralNetwork*, int>(), py::arg("model"), py::arg("sample_every") = 1, py::keep_alive<1, 2>())
+        .def_readwrite("sample_every", &LayerProfiler::sample_every)
+        .def("recordBackward", &LayerProfiler::recordBackward, py::arg("ms"))
+        .def("recordOptimizer", &LayerProfiler::recordOptimizer, py::arg("ms"))
+        .def("getReport", &LayerProfiler::getReport)
+        .def("reset", &LayerProfiler::reset);
+
+    py::class_<Trainer>(m, "Trainer", R"doc(
+Runs the training loop in C++. `loss` is "mse", "mae", "bce" or a callable (labels, preds) -> Var;
+built-in names avoid calling back into Python every step.
+)doc")
+        .def(py::init([](NeuralNetwork* model, const std::string& loss, Optimizer* optimizer) {
+            return new Trainer(model, getLossFunction(loss), optimizer);
+        }), py::arg("model"), py::arg("loss"), py::arg("optimizer"), py::keep_alive<1, 2>(), py::keep_alive<1, 4>())
+        .def(py::init<NeuralNetwork*, LossFunction, Optimizer*>(),
+            py::arg("model"), py::arg("loss"), py::arg("optimizer"), py::keep_alive<1, 2>(), py::keep_alive<1, 4>())
+        // The whole loop runs without the GIL and under the model's training lock. A Python loss or callback is
+        // wrapped by pybind11 to reacquire the GIL for just that call, and may call back into the model.
+        .def("step", [](Trainer& trainer, Matrix& features, Matrix& labels) {
+            ModelGuard guard(*trainer.neural_network, true);
+            return trainer.step(features, labels);
+        }, py::arg("features"), py::arg("labels"))
+        .def("fit", [](Trainer& trainer, DataLoader& data, int epochs, TrainingCallback callback, int callback_every) {
+            ModelGuard guard(*trainer.neural_network, true);
+            return trainer.fit(data, epochs, std::move(callback), callback_every);
+        }, py::arg("data"), py::arg("epochs"), py::arg("callback") = nullptr, py::arg("callback_every") = 100)
+        .def("fit", [](Trainer& trainer, std::shared_ptr<Dataset> data, int epochs, int batch_size, bool shuffle,
+                TrainingCallback callback, int callback_every) {
+            ModelGuard guard(*trainer.neural_network, true);
+            return trainer.fit(std::move(data), epochs, batch_size, shuffle, std::move(callback), callback_every);
+        }, py::arg("data"), py::arg("epochs"), py::arg("batch_size"), py::arg("shuffle") = true,
+            py::arg("callback") = nullptr, py::arg("callback_every") = 100)
+        .def("evaluate", &Trainer::evaluate, py::arg("data"), py::call_guard<py::gil_scoped_release>())
+        .def_readwrite("overlap_optimizer", &Trainer::overlap_optimizer,
+            "Update each layer's parameters on a background thread as soon as backward finishes their gradients");
+
+    py::class_<DataParallelTrainer, Trainer>(m, "DataParallelTrainer", R"doc(
+Trainer that splits each batch across num_workers model replicas on the thread pool and all-reduces
+their gradients before a single optimizer step. num_workers <= 0 uses getNumThreads(). `loss` must be
+one of the built-in names, since the workers cannot call back into Python.
+)doc")
+        .def(py::init([](NeuralNetwork* model, const std::string& loss, Optimizer* optimizer, int num_workers) {
+            return new DataParallelTrainer(model, getLossFunction(loss), optimizer, num_workers);
+        }), py::arg("model"), py::arg("loss"), py::arg("optimizer"), py::arg("num_workers") = 0, py::keep_alive<1, 2>(), py::keep_alive<1, 4>())
+        // A Python loss would run on the pool's workers, each reacquiring the GIL per call and serializing the
+        // split it exists to parallelize; built-in losses never call back into Python
+        .def(py::init([](NeuralNetwork*, py::function, Optimizer*, int) -> DataParallelTrainer* {
+            throw std::runtime_error("DataParallelTrainer needs a built-in loss name (\"mse\", \"mae\" or \"bce\")");
+        }), py::arg("model"), py::arg("loss"), py::arg("optimizer"), py::arg("num_workers") = 0)
+        .def("broadcast", &DataParallelTrainer::broadcast)
+        .def_readonly("num_workers", &DataParallelTrainer::num_workers);
+
+    // Collectives work in place, so the array must already be a contiguous float64 buffer
+    using InPlaceArray = py::array_t<double, py::array::c_style>;
+
+    py::class_<Communicator>(m, "Communicator", R"doc(
+Collective operations across the ranks of one job. Every rank must make the same calls with the same sizes.
+)doc")
+        .def("rank", &Communicator::rank)
+        .def("worldSize", &Communicator::worldSize)
+        .def("allReduce", [](Communicator& self, InPlaceArray data) {
+            double* ptr = data.mutable_data();
+            size_t n = static_cast<size_t>(data.size());
+            py::gil_scoped_release release;
+            self.allReduce(ptr, n);
+        }, py::arg("data").noconvert(), "Sum a float64 array across all ranks in place")
+        .def("broadcast", [](Communicator& self, InPlaceArray data, int root) {
+            double* ptr = data.mutable_data();
+            size_t n = static_cast<size_t>(data.size());
+            py::gil_scoped_release release;
+            self.broadcast(ptr, n, root);
+        }, py::arg("data").noconvert(), py::arg("root") = 0, "Overwrite a float64 array on every rank with root's copy")
+        .def("barrier", &Communicator::barrier, py::call_guard<py::gil_scoped_release>());
+
+    py::class_<SharedMemoryCommunicator, Communicator>(m, "SharedMemoryCommunicator", R"doc(
+Ranks on one machine communicating through a POSIX shared-memory segment. `name` must be unique per job.
+)doc")
+        .def(py::init<const std::string&, int, int, size_t, int>(),
+            py::arg("name"), py::arg("rank"), py::arg("world_size"), py::arg("slot_elements") = 1 << 18,
+            py::arg("timeout_seconds") = 60, py::call_guard<py::gil_scoped_release>());
+
+    py::class_<TcpCommunicator, Communicator>(m, "TcpCommunicator", R"doc(
+Ranks connected in a TCP ring: rank r listens on base_port + r and connects to rank r + 1 on host.
+)doc")
+        .def(py::init<int, int, int, const std::string&, int>(),
+            py::arg("rank"), py::arg("world_size"), py::arg("base_port"), py::arg("host") = "127.0.0.1",
+            py::arg("timeout_seconds") = 60, py::call_guard<py::gil_scoped_release>());
+
+    py::class_<DistributedTrainer, Trainer>(m, "DistributedTrainer", R"doc(
+Trainer for one rank of a multi-process job. Gradients are averaged across ranks in buckets of bucket_size
+parameters after backward; construction broadcasts rank 0's parameters.
+)doc")
+        .def(py::init([](NeuralNetwork* model, const std::string& loss, Optimizer* optimizer, Communicator* communicator, size_t bucket_size) {
+            py::gil_scoped_release release;
+            return new DistributedTrainer(model, getLossFunction(loss), optimizer, communicator, bucket_size);
+        }), py::arg("model"), py::arg("loss"), py::arg("optimizer"), py::arg("communicator"), py::arg("bucket_size") = 1 << 16,
+            py::keep_alive<1, 2>(), py::keep_alive<1, 4>(), py::keep_alive<1, 5>())
+        .def(py::init<NeuralNetwork*, LossFunction, Optimizer*, Communicator*, size_t>(),
+            py::arg("model"), py::arg("loss"), py::arg("optimizer"), py::arg("communicator"), py::arg("bucket_size") = 1 << 16,
+            py::keep_alive<1, 2>(), py::keep_alive<1, 4>(), py::keep_alive<1, 5>(), py::call_guard<py::gil_scoped_release>())
+        .def("broadcastParameters", &DistributedTrainer::broadcastParameters, py::arg("root") = 0)
+        .def_readonly("bucket_size", &DistributedTrainer::bucket_size);
+
+    py::class_<InferenceStats>(m, "InferenceStats")
+        .def_readonly("requests", &InferenceStats::requests)
+        .def_readonly("batches", &InferenceStats::batches)
+        .def_readonly("mean_batch_size", &InferenceStats::mean_batch_size)
+        .def_readonly("p50_latency_ms", &InferenceStats::p50_latency_ms)
+        .def_readonly("p99_latency_ms", &InferenceStats::p99_latency_ms)
+        .def_readonly("requests_per_second", &InferenceStats::requests_per_second)
+        .def("__repr__", [](const InferenceStats &stats) {
+            return "InferenceStats(requests=" + std::to_string(stats.requests) + ", p50_latency_ms=" +
+                std::to_string(stats.p50_latency_ms) + ", p99_latency_ms=" + std::to_string(stats.p99_latency_ms) + ")";
+        });
+
+    py::class_<InferenceEngine>(m, "InferenceEngine", R"doc(
+Batches single-row requests from many threads into one no-grad forward. A batch closes once it holds
+max_batch_size rows or its oldest request has waited max_latency_ms. infer() releases the GIL while it
+waits, so concurrent Python threads are batched together.
+)doc")
+        .def(py::init<NeuralNetwork*, int, double>(), py::arg("model"), py::arg("max_batch_size") = 64,
+            py::arg("max_latency_ms") = 2.0, py::keep_alive<1, 2>())
+        .def("infer", [](InferenceEngine& self, DoubleArray input) {
+            std::vector<double> row(input.data(), input.data() + input.size());
+            std::vector<double> output;
+            {
+                py::gil_scoped_release release;
+                output = self.infer(std::move(row));
+            }
+            DoubleArray result(static_cast<py::ssize_t>(output.size()));
+            double* out = result.mutable_data();
+            for (size_t k = 0; k < output.size(); k++) {
+                out[k] = output[k];
+            }
+            return result;
+        }, py::arg("input"), "Output row for one input row")
+        .def("getStats", &InferenceEngine::getStats)
+        .def("resetStats", &InferenceEngine::resetStats)
+        .def_readonly("max_batch_size", &InferenceEngine::max_batch_size)
+        .def_readonly("max_latency_ms", &InferenceEngine::max_latency_ms);
+
+    m.def("exportInferencePlan", &exportInferencePlan, py::arg("path"), py::arg("model"), py::arg("dtype") = DataType::Float32,
+        py::arg("input_dim") = 0, py::call_guard<py::gil_scoped_release>(), R"doc(
+Write a graph-free inference plan: layer records followed by the weights as one aligned block. input_dim is
+only needed when the first layer does not fix the input width (activations, pooling, convolutions).
+)doc");
+
+    m.def("exportQuantizedPlan", &exportQuantizedPlan, py::arg("path"), py::arg("model"), py::arg("calibration"),
+        py::arg("calibration_rows") = 1024, py::arg("dtype") = DataType::Float32, py::arg("input_dim") = 0,
+        py::call_guard<py::gil_scoped_release>(), R"doc(
+Export with Linear layers quantized to int8: one weight scale per output column and an input scale calibrated
+from the largest |input| each layer sees over calibration_rows rows of the calibration dataset.
+)doc");
+
+    py::class_<PlanAccuracy>(m, "PlanAccuracy")
+        .def_readonly("rows", &PlanAccuracy::rows)
+        .def_readonly("max_abs_error", &PlanAccuracy::max_abs_error)
+        .def_readonly("mean_abs_error", &PlanAccuracy::mean_abs_error)
+        .def_readonly("argmax_agreement", &PlanAccuracy::argmax_agreement)
+        .def_readonly("reference_accuracy", &PlanAccuracy::reference_accuracy)
+        .def_readonly("plan_accuracy", &PlanAccuracy::plan_accuracy)
+        .def("__repr__", [](const PlanAccuracy &accuracy) {
+            return "PlanAccuracy(rows=" + std::to_string(accuracy.rows) + ", max_abs_error=" + std::to_string(accuracy.max_abs_error) +
+                ", argmax_agreement=" + std::to_string(accuracy.argmax_agreement) + ")";
+        });
+
+    m.def("comparePlanAccuracy", &comparePlanAccuracy, py::arg("path"), py::arg("model"), py::arg("dataset"), py::arg("max_rows") = 0,
+        py::call_guard<py::gil_scoped_release>(), "Output drift of a plan from the float64 model over a dataset");
+
+    py::class_<LockedInferenceRuntime>(m, "InferenceRuntime", R"doc(
+Memory-maps an inference plan and runs it without building a graph. Float64 plans are used in place;
+Float32 plans are widened once at load. Calls to run on one runtime are serialized; use one runtime per
+thread to run in parallel.
+)doc")
+        .def(py::init<const std::string&>(), py::arg("path"))
+        .def("run", [](LockedInferenceRuntime& self, DoubleArray input) {
+            std::pair<int, int> shape = arrayShape(input);
+            if (input.ndim() == 1) {
+                shape = { 1, static_cast<int>(input.size()) };
+            }
+            if (shape.second != self.inputDim()) {
+                throw std::runtime_error("Expected " + std::to_string(self.inputDim()) + " input columns, got " + std::to_string(shape.second));
+            }
+            DoubleArray result({ shape.first, self.outputDim() });
+            {
+                py::gil_scoped_release release;
+                std::lock_guard<std::mutex> lock(self.mutex);
+                self.run(input.data(), shape.first, result.mutable_data());
+            }
+            return result;
+        }, py::arg("input"), "rows x outputDim outputs for rows x inputDim inputs")
+        .def("inputDim", &InferenceRuntime<double>::inputDim)
+        .def("outputDim", &InferenceRuntime<double>::outputDim)
+        .def("numLayers", &InferenceRuntime<double>::numLayers);
+
+    m.def("matmul", static_cast<Matrix (*)(Matrix&, Matrix&)>(&matmul), py::arg("A"), py::arg("B"), py::call_guard<py::gil_scoped_release>());
+    m.def("matmul", static_cast<Matrix (*)(SparseMatrix&, Matrix&)>(&matmul), py::arg("A"), py::arg("B"), py::call_guard<py::gil_scoped_release>());
+
+    m.def("getLiveNodeCount", &getLiveNodeCount, "Var nodes currently alive across all threads");
+    m.def("getCreatedNodeCount", &getCreatedNodeCount, "Var nodes created since the process started");
+    m.def("getAllocationCount", &getAllocationCount, "Heap allocations made by the autodiff memory pool so far (pool misses only, not every allocation)");
+    m.def("resetAllocationCount", &resetAllocationCount);
+
+    m.def("setSeed", &setSeed, py::arg("seed"), "Seed the global counter-based generator used by weight init and randomInit");
+    m.def("getSeed", &getSeed);
+    m.def("setNumThreads", &setNumThreads, py::arg("n"));
+    m.def("getNumThreads", &getNumThreads);
+    m.def("setTracingEnabled", &setTracingEnabled, py::arg("enabled"), "Record forward, loss, backward and optimizer spans for writeChromeTrace");
+    m.def("isTracingEnabled", &isTracingEnabled);
+    m.def("clearTrace", &clearTrace);
+    m.def("writeChromeTrace", &writeChromeTrace, py::arg("path"), py::call_guard<py::gil_scoped_release>(),
+        "Write the recorded spans as Chrome trace JSON (chrome://tracing or ui.perfetto.dev)");
+    m.def("isGradEnabled", &isGradEnabled);
+    m.def("setGradEnabled", &setGradEnabled, py::arg("enabled"), "Turn gradient recording on or off for the calling thread");
+
+    // Context manager form of NoGradGuard: `with autoneuronet.NoGrad(): ...`
+    struct NoGrad {
+        bool previous = true;
+    };
+    py::class_<NoGrad>(m, "NoGrad", R"doc(
+Disables gradient recording for the current thread inside a `with` block.
+)doc")
+        .def(py::init<>())
+        .def("__enter__", [](NoGrad &guard) {
+            guard.previous = isGradEnabled();
+            setGradEnabled(false);
+        })
+        .def("__exit__", [](NoGrad &guard, py::args) {
+            setGradEnabled(guard.previous);
+        });
 
-    m.def("matmul", &matmul, py::arg("A"), py::arg("B"));
-    m.def("MSELoss", &MSELoss, py::arg("labels"), py::arg("preds"));
-    m.def("MAELoss", &MAELoss, py::arg("labels"), py::arg("preds"));
-    m.def("BCELoss", &BCELoss, py::arg("labels"), py::arg("preds"), py::arg("eps") = 1e-7);
+    m.def("MSELoss", &MSELoss, py::arg("labels"), py::arg("preds"), py::call_guard<py::gil_scoped_release>());
+    m.def("MAELoss", &MAELoss, py::arg("labels"), py::arg("preds"), py::call_guard<py::gil_scoped_release>());
+    m.def("BCELoss", &BCELoss, py::arg("labels"), py::arg("preds"), py::arg("eps") = 1e-7, py::call_guard<py::gil_scoped_release>());
 
     py::module_ ops = m.def_submodule("ops");
     ops.def("sin", [](Var& v) { return v.sin(); }, py::arg("var"));
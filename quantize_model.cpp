@@ -0,0 +1,110 @@
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include "Checkpoint.hpp"
+#include "InferenceExport.hpp"
+#include "Random.hpp"
+#include "Trainer.hpp"
+
+// g++ -O3 quantize_model.cpp src/*.cpp -I include -pthread -o quantize_model
+// ./quantize_model [model.ckpt data.dataset [plan_prefix]]
+
+// Exports a model as a float32 plan and as an int8 plan calibrated on the dataset, then reports each plan's
+// drift from the float64 model, its size and its runtime. Without arguments it trains a small classifier on
+// synthetic clusters and reports on that. The int8 kernel is picked at run time, so a default build measures
+// what users of a default build get.
+
+static std::shared_ptr<InMemoryDataset> syntheticClusters(int rows, int features, int classes) {
+    std::vector<double> centers(static_cast<size_t>(classes) * features);
+    fillUniform(centers.data(), static_cast<int64_t>(centers.size()), -1.0, 1.0, nextStream());
+    std::vector<double> noise(static_cast<size_t>(rows) * features);
+    fillNormal(noise.data(), static_cast<int64_t>(noise.size()), 0.0, 1.0, nextStream());
+
+    std::vector<double> x(static_cast<size_t>(rows) * features);
+    std::vector<double> y(static_cast<size_t>(rows) * classes, 0.0);
+    for (int i = 0; i < rows; i++) {
+        int label = i % classes;
+        for (int j = 0; j < features; j++) {
+            x[static_cast<size_t>(i) * features + j] = centers[static_cast<size_t>(label) * features + j] + noise[static_cast<size_t>(i) * features + j];
+        }
+        y[static_cast<size_t>(i) * classes + label] = 1.0;
+    }
+    return std::make_shared<InMemoryDataset>(x, y, features, classes);
+}
+
+static double fileMegabytes(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 ? static_cast<double>(info.st_size) / (1 << 20) : 0.0;
+}
+
+// Best of five passes over `rows` rows of the dataset
+static double runMilliseconds(const std::string& path, const Dataset& data, int rows) {
+    InferenceRuntime<float> runtime(path);
+    std::vector<double> features(data.featureDim()), labels(data.labelDim());
+    std::vector<float> input(static_cast<size_t>(rows) * data.featureDim());
+    for (int i = 0; i < rows; i++) {
+        data.getRow(i % data.size(), features.data(), labels.data());
+        std::copy(features.begin(), features.end(), input.begin() + static_cast<size_t>(i) * data.featureDim());
+    }
+
+    std::vector<float> output(static_cast<size_t>(rows) * runtime.outputDim());
+    double best = 1e30;
+    for (int pass = 0; pass < 5; pass++) {
+        auto start = std::chrono::steady_clock::now();
+        runtime.run(input.data(), rows, output.data());
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+static void report(const char* label, const std::string& path, NeuralNetwork& model, const Dataset& data) {
+    PlanAccuracy accuracy = comparePlanAccuracy(path, model, data);
+    std::printf("%-8s %8.2f MB %9.3f ms  max |err| %.2e  mean |err| %.2e", label, fileMegabytes(path),
+        runMilliseconds(path, data, 256), accuracy.max_abs_error, accuracy.mean_abs_error);
+    if (accuracy.argmax_agreement >= 0.0) {
+        std::printf("  argmax agreement %.2f%%", 100.0 * accuracy.argmax_agreement);
+    }
+    if (accuracy.plan_accuracy >= 0.0) {
+        std::printf("  accuracy %.2f%% (float64 %.2f%%)", 100.0 * accuracy.plan_accuracy, 100.0 * accuracy.reference_accuracy);
+    }
+    std::printf("\n");
+}
+
+int main(int argc, char** argv) {
+    try {
+        std::shared_ptr<Dataset> data;
+        std::unique_ptr<NeuralNetwork> model;
+        std::string prefix = argc > 3 ? argv[3] : "model";
+
+        if (argc > 2) {
+            model = std::make_unique<NeuralNetwork>(loadCheckpoint(argv[1]));
+            data = std::make_shared<MappedDataset>(argv[2]);
+        } else {
+            setSeed(7);
+            data = syntheticClusters(2048, 32, 10);
+            model = std::make_unique<NeuralNetwork>(std::vector<std::shared_ptr<Layer>>{
+                std::make_shared<Linear>(32, 128), std::make_shared<ReLU>(), std::make_shared<Linear>(128, 128),
+                std::make_shared<ReLU>(), std::make_shared<Linear>(128, 10), std::make_shared<Softmax>() });
+
+            AdamOptimizer optimizer(1e-3, model.get());
+            Trainer trainer(model.get(), getLossFunction("mse"), &optimizer);
+            trainer.fit(data, 3, 64);
+        }
+
+        exportInferencePlan(prefix + ".f32.plan", *model, DataType::Float32);
+        exportQuantizedPlan(prefix + ".int8.plan", *model, *data);
+
+        const char* kernel = nullptr;
+        planDotInt8x4Kernel(&kernel);
+        std::printf("int8 kernel: %s\n", kernel);
+        std::printf("plan        size      256 rows\n");
+        report("float32", prefix + ".f32.plan", *model, *data);
+        report("int8", prefix + ".int8.plan", *model, *data);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,478 @@
+#include "Checkpoint.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char CHECKPOINT_MAGIC[8] = { 'A', 'N', 'N', 'C', 'K', 'P', 'T', '\0' };
+// Version 2 stores the optimizer type ahead of its state; version 1 files still load, unchecked
+static const uint32_t CHECKPOINT_VERSION = 2;
+
+namespace {
+
+// FNV-1a over 8-byte words (the tail is zero-padded), which keeps verification at memory speed
+class PayloadHasher {
+public:
+    void update(const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+        if (pending_size > 0) {
+            size_t take = std::min<size_t>(8 - pending_size, size);
+            std::memcpy(pending + pending_size, bytes, take);
+            pending_size += take;
+            bytes += take;
+            size -= take;
+            if (pending_size < 8) {
+                return;
+            }
+            mix(pending);
+            pending_size = 0;
+        }
+
+        for (; size >= 8; bytes += 8, size -= 8) {
+            mix(bytes);
+        }
+
+        // Fewer than 8 bytes are left and nothing is pending
+        std::memcpy(pending, bytes, size);
+        pending_size = size;
+    }
+
+    uint64_t finish() {
+        if (pending_size > 0) {
+            std::memset(pending + pending_size, 0, 8 - pending_size);
+            mix(pending);
+            pending_size = 0;
+        }
+        return hash;
+    }
+
+private:
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    unsigned char pending[8];
+    size_t pending_size = 0;
+
+    void mix(const unsigned char* word_bytes) {
+        uint64_t word;
+        std::memcpy(&word, word_bytes, 8);
+        hash = (hash ^ word) * 0x100000001b3ULL;
+    }
+};
+
+// Everything a checkpoint stores, pointing either into live buffers or into an owned snapshot
+struct CheckpointContents {
+    std::vector<LayerConfig> configs;
+    const double* parameter_values = nullptr;
+    uint64_t num_parameters = 0;
+    std::vector<std::pair<const double*, uint64_t>> layer_states;
+    bool has_optimizer = false;
+    std::string optimizer_type;
+    std::vector<double> optimizer_state;
+
+    // Only filled for snapshots
+    std::vector<double> owned_parameters;
+    std::vector<std::vector<double>> owned_states;
+};
+
+void collectContents(NeuralNetwork& model, Optimizer* optimizer, bool copy, CheckpointContents& contents) {
+    ParameterBuffer& params = model.getParameterBuffer();
+    params.gather();
+
+    if (copy) {
+        contents.owned_parameters = params.values;
+        contents.parameter_values = contents.owned_parameters.data();
+    } else {
+        contents.parameter_values = params.values.data();
+    }
+    contents.num_parameters = params.values.size();
+
+    if (copy) {
+        contents.owned_states.reserve(model.layers.size());
+    }
+
+    for (auto& layer : model.layers) {
+        contents.configs.push_back(layer->getConfig());
+
+        std::vector<double>* state = layer->stateBuffer();
+        if (state == nullptr) {
+            contents.layer_states.emplace_back(nullptr, 0);
+        } else if (copy) {
+            contents.owned_states.push_back(*state);
+            contents.layer_states.emplace_back(contents.owned_states.back().data(), state->size());
+        } else {
+            contents.layer_states.emplace_back(state->data(), state->size());
+        }
+    }
+
+    if (optimizer != nullptr) {
+        contents.has_optimizer = true;
+        contents.optimizer_type = optimizer->getType();
+        contents.optimizer_state = optimizer->getState();
+    }
+}
+
+class PayloadWriter {
+public:
+    PayloadWriter(std::FILE* out, const std::string& path) : file(out), path(path) {}
+
+    void write(const void* data, size_t size) {
+        if (size > 0 && std::fwrite(data, 1, size, file) != size) {
+            throw std::runtime_error("Could not write to " + path);
+        }
+        hasher.update(data, size);
+        written += size;
+    }
+
+    void writeU64(uint64_t value) {
+        write(&value, sizeof(value));
+    }
+
+    void writeString(const std::string& value) {
+        writeU64(value.size());
+        write(value.data(), value.size());
+    }
+
+    // Arrays start 8-byte aligned so readers can point straight into the mapping
+    void writeDoubles(const double* values, uint64_t n) {
+        writeU64(n);
+        static const char zeros[8] = {};
+        write(zeros, (8 - written % 8) % 8);
+        write(values, n * sizeof(double));
+    }
+
+    uint64_t size() const {
+        return written;
+    }
+
+    uint64_t checksum() {
+        return hasher.finish();
+    }
+
+private:
+    std::FILE* file;
+    std::string path;
+    PayloadHasher hasher;
+    uint64_t written = 0;
+};
+
+// Header and payload of a checkpoint, synced to disk; throws on any write error
+void writeCheckpointFile(std::FILE* file, const std::string& temp_path, const CheckpointContents& contents) {
+    CheckpointHeader header;
+    std::memset(&header, 0, sizeof(CheckpointHeader));
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    header.version = CHECKPOINT_VERSION;
+
+    if (std::fwrite(&header, sizeof(CheckpointHeader), 1, file) != 1) {
+        throw std::runtime_error("Could not write to " + temp_path);
+    }
+
+    PayloadWriter payload(file, temp_path);
+
+    payload.writeU64(contents.configs.size());
+    for (const LayerConfig& config : contents.configs) {
+        payload.writeString(config.type);
+        payload.writeDoubles(config.args.data(), config.args.size());
+        payload.writeU64(config.options.size());
+        for (const std::string& option : config.options) {
+            payload.writeString(option);
+        }
+    }
+
+    payload.writeDoubles(contents.parameter_values, contents.num_parameters);
+
+    for (const auto& state : contents.layer_states) {
+        payload.writeDoubles(state.first, state.second);
+    }
+
+    payload.writeU64(contents.has_optimizer ? 1 : 0);
+    payload.writeString(contents.optimizer_type);
+    payload.writeDoubles(contents.optimizer_state.data(), contents.optimizer_state.size());
+
+    header.payload_size = payload.size();
+    header.checksum = payload.checksum();
+
+    bool ok = std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(CheckpointHeader), 1, file) == 1;
+    ok = ok && std::fflush(file) == 0 && ::fsync(::fileno(file)) == 0;
+    if (!ok) {
+        throw std::runtime_error("Could not write to " + temp_path);
+    }
+}
+
+void writeCheckpoint(const std::string& path, const CheckpointContents& contents) {
+    // Write next to the target and rename, so a crash mid-save never leaves a torn checkpoint. A failed save
+    // removes the temporary file and leaves any previous checkpoint at path untouched.
+    std::string temp_path = path + ".tmp";
+    std::FILE* file = std::fopen(temp_path.c_str(), "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("Could not open " + temp_path + " for writing");
+    }
+
+    try {
+        writeCheckpointFile(file, temp_path, contents);
+    } catch (...) {
+        std::fclose(file);
+        std::remove(temp_path.c_str());
+        throw;
+    }
+
+    if (std::fclose(file) != 0 || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        throw std::runtime_error("Could not finish writing " + path);
+    }
+}
+
+class PayloadReader {
+public:
+    PayloadReader(const char* begin, const char* end) : start(begin), cursor(begin), end(end) {}
+
+    uint64_t readU64() {
+        uint64_t value;
+        std::memcpy(&value, take(sizeof(value)), sizeof(value));
+        return value;
+    }
+
+    std::string readString() {
+        uint64_t size = readU64();
+        const char* data = take(size);
+        return std::string(data, size);
+    }
+
+    const double* readDoubles(uint64_t& n) {
+        n = readU64();
+        take((8 - (cursor - start) % 8) % 8);
+        if (n > static_cast<uint64_t>(end - cursor) / sizeof(double)) {
+            throw std::runtime_error("Checkpoint payload is truncated");
+        }
+        return reinterpret_cast<const double*>(take(n * sizeof(double)));
+    }
+
+private:
+    const char* start;
+    const char* cursor;
+    const char* end;
+
+    const char* take(uint64_t size) {
+        if (size > static_cast<uint64_t>(end - cursor)) {
+            throw std::runtime_error("Checkpoint payload is truncated");
+        }
+        const char* data = cursor;
+        cursor += size;
+        return data;
+    }
+};
+
+bool sameConfig(const LayerConfig& a, const LayerConfig& b) {
+    return a.type == b.type && a.args == b.args && a.options == b.options;
+}
+
+} // namespace
+
+Checkpoint::Checkpoint(const std::string& path) {
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open " + path + ": " + std::strerror(errno));
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(CheckpointHeader)) {
+        ::close(fd);
+        throw std::runtime_error(path + " is too small to be a checkpoint");
+    }
+    mapping_size = static_cast<size_t>(info.st_size);
+
+    mapping = ::mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        ::close(fd);
+        throw std::runtime_error("Could not mmap " + path + ": " + std::strerror(errno));
+    }
+
+    try {
+        CheckpointHeader header;
+        std::memcpy(&header, mapping, sizeof(CheckpointHeader));
+        const char* payload = static_cast<const char*>(mapping) + sizeof(CheckpointHeader);
+
+        if (std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) {
+            throw std::runtime_error(path + " is not a checkpoint");
+        }
+        if (header.version != CHECKPOINT_VERSION && header.version != 1) {
+            throw std::runtime_error(path + " has unsupported checkpoint version " + std::to_string(header.version));
+        }
+        if (header.payload_size != mapping_size - sizeof(CheckpointHeader)) {
+            throw std::runtime_error(path + " is truncated");
+        }
+
+        PayloadHasher hasher;
+        hasher.update(payload, header.payload_size);
+        if (hasher.finish() != header.checksum) {
+            throw std::runtime_error(path + " failed checksum validation");
+        }
+
+        PayloadReader reader(payload, payload + header.payload_size);
+
+        uint64_t num_layers = reader.readU64();
+        for (uint64_t l = 0; l < num_layers; l++) {
+            LayerConfig config;
+            config.type = reader.readString();
+
+            uint64_t num_args = 0;
+            const double* args = reader.readDoubles(num_args);
+            config.args.assign(args, args + num_args);
+
+            uint64_t num_options = reader.readU64();
+            for (uint64_t k = 0; k < num_options; k++) {
+                config.options.push_back(reader.readString());
+            }
+
+            layer_configs.push_back(std::move(config));
+        }
+
+        parameter_values = reader.readDoubles(num_parameters);
+
+        for (uint64_t l = 0; l < num_layers; l++) {
+            uint64_t n = 0;
+            const double* state = reader.readDoubles(n);
+            layer_states.emplace_back(state, n);
+        }
+
+        has_optimizer = reader.readU64() != 0;
+        if (header.version >= 2) {
+            optimizer_type = reader.readString();
+        }
+        optimizer_state = reader.readDoubles(optimizer_state_size);
+    } catch (...) {
+        ::munmap(mapping, mapping_size);
+        ::close(fd);
+        throw;
+    }
+};
+
+Checkpoint::~Checkpoint() {
+    if (mapping != nullptr) {
+        ::munmap(mapping, mapping_size);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+};
+
+NeuralNetwork Checkpoint::createModel() const {
+    NeuralNetwork model({});
+    for (const LayerConfig& config : layer_configs) {
+        model.addLayer(createLayer(config));
+    }
+
+    loadModel(model);
+    return model;
+};
+
+void Checkpoint::loadModel(NeuralNetwork& model) const {
+    if (model.layers.size() != layer_configs.size()) {
+        throw std::runtime_error("Checkpoint has " + std::to_string(layer_configs.size()) + " layers, the model has " +
+            std::to_string(model.layers.size()));
+    }
+    for (size_t l = 0; l < layer_configs.size(); l++) {
+        if (!sameConfig(model.layers[l]->getConfig(), layer_configs[l])) {
+            throw std::runtime_error("Layer " + std::to_string(l) + " (" + model.layers[l]->name + ") does not match the checkpoint");
+        }
+    }
+
+    ParameterBuffer& params = model.getParameterBuffer();
+    if (params.size() != num_parameters) {
+        throw std::runtime_error("Checkpoint parameter count does not match the model");
+    }
+    params.values.assign(parameter_values, parameter_values + num_parameters);
+    params.scatterValues();
+
+    for (size_t l = 0; l < layer_configs.size(); l++) {
+        Layer& layer = *model.layers[l];
+        std::vector<double>* state = layer.stateBuffer();
+        uint64_t n = layer_states[l].second;
+
+        if ((state == nullptr && n != 0) || (state != nullptr && state->size() != n)) {
+            throw std::runtime_error("Checkpoint state of layer " + std::to_string(l) + " does not match the model");
+        }
+        if (state != nullptr) {
+            state->assign(layer_states[l].first, layer_states[l].first + n);
+
+            // Drop nodes built from the old state
+            layer.resetGrad();
+        }
+    }
+};
+
+bool Checkpoint::hasOptimizerState() const {
+    return has_optimizer;
+};
+
+void Checkpoint::loadOptimizer(Optimizer& optimizer) const {
+    if (!has_optimizer) {
+        throw std::runtime_error("Checkpoint has no optimizer state");
+    }
+    if (!optimizer_type.empty() && optimizer_type != optimizer.getType()) {
+        throw std::runtime_error("Checkpoint holds " + optimizer_type + " optimizer state, not " + optimizer.getType());
+    }
+    optimizer.setState(std::vector<double>(optimizer_state, optimizer_state + optimizer_state_size));
+};
+
+void saveCheckpoint(const std::string& path, NeuralNetwork& model, Optimizer* optimizer) {
+    CheckpointContents contents;
+    collectContents(model, optimizer, false, contents);
+    writeCheckpoint(path, contents);
+};
+
+NeuralNetwork loadCheckpoint(const std::string& path) {
+    Checkpoint checkpoint(path);
+    return checkpoint.createModel();
+};
+
+CheckpointWriter::~CheckpointWriter() {
+    if (worker.joinable()) {
+        worker.join();
+    }
+
+    // A destructor cannot throw, so a save nobody waited for reports its failure here instead of vanishing
+    if (error) {
+        try {
+            std::rethrow_exception(error);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "CheckpointWriter: background save failed: %s\n", e.what());
+        } catch (...) {
+            std::fprintf(stderr, "CheckpointWriter: background save failed\n");
+        }
+    }
+};
+
+void CheckpointWriter::saveAsync(const std::string& path, NeuralNetwork& model, Optimizer* optimizer) {
+    wait();
+
+    auto contents = std::make_shared<CheckpointContents>();
+    collectContents(model, optimizer, true, *contents);
+
+    worker = std::thread([this, path, contents]() {
+        try {
+            writeCheckpoint(path, *contents);
+        } catch (...) {
+            error = std::current_exception();
+        }
+    });
+};
+
+void CheckpointWriter::wait() {
+    if (worker.joinable()) {
+        worker.join();
+    }
+
+    if (error) {
+        std::exception_ptr pending = error;
+        error = nullptr;
+        std::rethrow_exception(pending);
+    }
+};
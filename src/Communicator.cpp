@@ -0,0 +1,521 @@
+#include "Communicator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Shared-memory barrier needs lock-free atomics");
+
+// Written by rank 0 once the segment is initialized
+static const uint32_t SEGMENT_READY = 0x414E4E43;
+
+// The header occupies its own cache line ahead of the slots
+static const size_t HEADER_BYTES = 64;
+
+struct SharedMemoryCommunicator::Header {
+    std::atomic<uint32_t> ready;
+    std::atomic<uint32_t> arrived;
+    std::atomic<uint32_t> generation;
+    uint32_t world_size;
+    uint64_t slot_elements;
+};
+
+static void checkRank(int rank, int world_size) {
+    if (world_size < 1 || rank < 0 || rank >= world_size) {
+        throw std::runtime_error("Invalid rank " + std::to_string(rank) + " for world size " + std::to_string(world_size));
+    }
+}
+
+// Spins briefly, then yields; throws once the deadline passes so a dead peer cannot hang the job
+template <typename Condition>
+static void waitUntil(Condition done, Clock::time_point deadline, const char* what) {
+    for (uint64_t spins = 0; !done(); spins++) {
+        if (spins < 1024) {
+            continue;
+        }
+        std::this_thread::yield();
+        if ((spins & 1023) == 0 && Clock::now() > deadline) {
+            throw std::runtime_error(std::string("Timed out waiting for ") + what);
+        }
+    }
+}
+
+SharedMemoryCommunicator::SharedMemoryCommunicator(const std::string& name, int rank, int world_size, size_t slot_elements,
+    int timeout_seconds) {
+    static_assert(sizeof(Header) <= HEADER_BYTES, "Header must fit in its cache line");
+
+    checkRank(rank, world_size);
+    if (slot_elements == 0) {
+        throw std::runtime_error("slot_elements must be positive");
+    }
+
+    this->my_rank = rank;
+    this->world_size = world_size;
+    this->slot_elements = slot_elements;
+    this->timeout_ms = timeout_seconds * 1000;
+
+    std::string shm_name = name.empty() || name[0] != '/' ? "/" + name : name;
+
+    // One slot per rank plus the reduced result
+    mapping_size = HEADER_BYTES + (static_cast<size_t>(world_size) + 1) * slot_elements * sizeof(double);
+    Clock::time_point deadline = Clock::now() + std::chrono::seconds(timeout_seconds);
+
+    int fd = -1;
+    if (rank == 0) {
+        // Drop a segment left behind by a crashed run with the same name
+        shm_unlink(shm_name.c_str());
+        fd = shm_open(shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0) {
+            throw std::runtime_error("Could not create shared memory " + shm_name + ": " + std::strerror(errno));
+        }
+        if (ftruncate(fd, static_cast<off_t>(mapping_size)) != 0) {
+            int error = errno;
+            close(fd);
+            shm_unlink(shm_name.c_str());
+            throw std::runtime_error("Could not size shared memory " + shm_name + ": " + std::strerror(error));
+        }
+    } else {
+        // Rank 0 may not have created (or sized) the segment yet
+        while (true) {
+            fd = shm_open(shm_name.c_str(), O_RDWR, 0600);
+            if (fd >= 0) {
+                struct stat info;
+                if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) == mapping_size) {
+                    break;
+                }
+                close(fd);
+                fd = -1;
+            }
+            if (Clock::now() > deadline) {
+                throw std::runtime_error("Timed out waiting for shared memory " + shm_name);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+
+    mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        if (rank == 0) shm_unlink(shm_name.c_str());
+        throw std::runtime_error("Could not mmap shared memory " + shm_name + ": " + std::strerror(errno));
+    }
+
+    header = static_cast<Header*>(mapping);
+    if (rank == 0) {
+        // ftruncate zero-fills, which is a valid state for the atomics
+        header->world_size = static_cast<uint32_t>(world_size);
+        header->slot_elements = slot_elements;
+        header->ready.store(SEGMENT_READY, std::memory_order_release);
+    } else {
+        waitUntil([this]() { return header->ready.load(std::memory_order_acquire) == SEGMENT_READY; }, deadline,
+            "shared memory initialization");
+        if (header->world_size != static_cast<uint32_t>(world_size) || header->slot_elements != slot_elements) {
+            munmap(mapping, mapping_size);
+            mapping = nullptr;
+            throw std::runtime_error("Shared memory " + shm_name + " was created with a different configuration");
+        }
+    }
+
+    // Once every rank is attached the name is no longer needed
+    barrier();
+    if (rank == 0) {
+        shm_unlink(shm_name.c_str());
+    }
+};
+
+SharedMemoryCommunicator::~SharedMemoryCommunicator() {
+    if (mapping) {
+        munmap(mapping, mapping_size);
+    }
+};
+
+int SharedMemoryCommunicator::rank() const {
+    return my_rank;
+};
+
+int SharedMemoryCommunicator::worldSize() const {
+    return world_size;
+};
+
+double* SharedMemoryCommunicator::slot(int r) const {
+    return reinterpret_cast<double*>(static_cast<char*>(mapping) + HEADER_BYTES) + static_cast<size_t>(r) * slot_elements;
+};
+
+double* SharedMemoryCommunicator::result() const {
+    return slot(world_size);
+};
+
+void SharedMemoryCommunicator::barrier() {
+    if (world_size == 1) {
+        return;
+    }
+
+    // The last rank to arrive opens the next generation
+    uint32_t generation = header->generation.load(std::memory_order_acquire);
+    if (header->arrived.fetch_add(1, std::memory_order_acq_rel) == static_cast<uint32_t>(world_size) - 1) {
+        header->arrived.store(0, std::memory_order_relaxed);
+        header->generation.fetch_add(1, std::memory_order_release);
+        return;
+    }
+
+    waitUntil([this, generation]() { return header->generation.load(std::memory_order_acquire) != generation; },
+        Clock::now() + std::chrono::milliseconds(timeout_ms), "a barrier");
+};
+
+void SharedMemoryCommunicator::allReduce(double* data, size_t n) {
+    if (world_size == 1) {
+        return;
+    }
+
+    for (size_t offset = 0; offset < n; offset += slot_elements) {
+        size_t m = std::min(slot_elements, n - offset);
+        std::memcpy(slot(my_rank), data + offset, m * sizeof(double));
+        barrier();
+
+        // Reduce-scatter: each rank sums its share of the round across all slots in rank order, so every
+        // element is reduced exactly once and all ranks read the same bits
+        size_t begin = m * my_rank / world_size;
+        size_t end = m * (my_rank + 1) / world_size;
+        double* reduced = result();
+        for (size_t k = begin; k < end; k++) {
+            double sum = 0.0;
+            for (int r = 0; r < world_size; r++) {
+                sum += slot(r)[k];
+            }
+            reduced[k] = sum;
+        }
+        barrier();
+
+        std::memcpy(data + offset, reduced, m * sizeof(double));
+
+        // Slots and result are reused by the next round
+        barrier();
+    }
+};
+
+void SharedMemoryCommunicator::broadcast(double* data, size_t n, int root) {
+    checkRank(root, world_size);
+    if (world_size == 1) {
+        return;
+    }
+
+    for (size_t offset = 0; offset < n; offset += slot_elements) {
+        size_t m = std::min(slot_elements, n - offset);
+        if (my_rank == root) {
+            std::memcpy(result(), data + offset, m * sizeof(double));
+        }
+        barrier();
+
+        if (my_rank != root) {
+            std::memcpy(data + offset, result(), m * sizeof(double));
+        }
+        barrier();
+    }
+};
+
+static void setNoDelay(int fd) {
+    int flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+static void setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+static void writeFully(int fd, const void* buffer, size_t bytes) {
+    const char* p = static_cast<const char*>(buffer);
+    while (bytes > 0) {
+        ssize_t k = send(fd, p, bytes, MSG_NOSIGNAL);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) throw std::runtime_error(std::string("Socket send failed: ") + std::strerror(errno));
+        p += k;
+        bytes -= static_cast<size_t>(k);
+    }
+}
+
+static void readFully(int fd, void* buffer, size_t bytes) {
+    char* p = static_cast<char*>(buffer);
+    while (bytes > 0) {
+        ssize_t k = recv(fd, p, bytes, 0);
+        if (k < 0 && errno == EINTR) continue;
+        if (k == 0) throw std::runtime_error("Peer closed the connection");
+        if (k < 0) throw std::runtime_error(std::string("Socket receive failed: ") + std::strerror(errno));
+        p += k;
+        bytes -= static_cast<size_t>(k);
+    }
+}
+
+TcpCommunicator::TcpCommunicator(int rank, int world_size, int base_port, const std::string& host, int timeout_seconds) {
+    checkRank(rank, world_size);
+
+    this->my_rank = rank;
+    this->world_size = world_size;
+    this->timeout_ms = timeout_seconds * 1000;
+
+    if (world_size == 1) {
+        return;
+    }
+
+    Clock::time_point deadline = Clock::now() + std::chrono::seconds(timeout_seconds);
+
+    // Listen before connecting, so the ring cannot deadlock during setup
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        throw std::runtime_error(std::string("Could not create socket: ") + std::strerror(errno));
+    }
+    int reuse = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(static_cast<uint16_t>(base_port + rank));
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listen_fd, 1) != 0) {
+        int error = errno;
+        close(listen_fd);
+        throw std::runtime_error("Could not listen on port " + std::to_string(base_port + rank) + ": " + std::strerror(error));
+    }
+
+    try {
+        int next = (rank + 1) % world_size;
+        std::string port = std::to_string(base_port + next);
+
+        addrinfo hints{};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* resolved = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &resolved) != 0 || !resolved) {
+            throw std::runtime_error("Could not resolve " + host);
+        }
+
+        // The next rank may still be starting up
+        while (next_fd < 0) {
+            int fd = socket(AF_INET, SOCK_STREAM, 0);
+            if (fd >= 0 && connect(fd, resolved->ai_addr, resolved->ai_addrlen) == 0) {
+                next_fd = fd;
+                break;
+            }
+            if (fd >= 0) close(fd);
+            if (Clock::now() > deadline) {
+                freeaddrinfo(resolved);
+                throw std::runtime_error("Timed out connecting to rank " + std::to_string(next) + " at " + host + ":" + port);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        freeaddrinfo(resolved);
+
+        int32_t my_id = rank;
+        writeFully(next_fd, &my_id, sizeof(my_id));
+
+        pollfd waiting{ listen_fd, POLLIN, 0 };
+        int remaining_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count());
+        if (poll(&waiting, 1, std::max(remaining_ms, 0)) <= 0) {
+            throw std::runtime_error("Timed out waiting for rank " + std::to_string((rank + world_size - 1) % world_size));
+        }
+        prev_fd = accept(listen_fd, nullptr, nullptr);
+        if (prev_fd < 0) {
+            throw std::runtime_error(std::string("Could not accept connection: ") + std::strerror(errno));
+        }
+
+        int32_t peer_id = -1;
+        readFully(prev_fd, &peer_id, sizeof(peer_id));
+        if (peer_id != (rank + world_size - 1) % world_size) {
+            throw std::runtime_error("Unexpected peer rank " + std::to_string(peer_id) + " on port " + std::to_string(base_port + rank));
+        }
+    } catch (...) {
+        close(listen_fd);
+        if (next_fd >= 0) close(next_fd);
+        if (prev_fd >= 0) close(prev_fd);
+        throw;
+    }
+    close(listen_fd);
+
+    setNoDelay(next_fd);
+    setNoDelay(prev_fd);
+    setNonBlocking(next_fd);
+    setNonBlocking(prev_fd);
+};
+
+TcpCommunicator::~TcpCommunicator() {
+    if (next_fd >= 0) close(next_fd);
+    if (prev_fd >= 0) close(prev_fd);
+};
+
+int TcpCommunicator::rank() const {
+    return my_rank;
+};
+
+int TcpCommunicator::worldSize() const {
+    return world_size;
+};
+
+void TcpCommunicator::exchange(const void* send_buffer, size_t send_bytes, void* receive_buffer, size_t receive_bytes) {
+    const char* out = static_cast<const char*>(send_buffer);
+    char* in = static_cast<char*>(receive_buffer);
+    size_t sent = 0;
+    size_t received = 0;
+
+    while (sent < send_bytes || received < receive_bytes) {
+        pollfd fds[2];
+        int count = 0;
+        int send_index = -1;
+        int receive_index = -1;
+        if (sent < send_bytes) {
+            fds[count] = { next_fd, POLLOUT, 0 };
+            send_index = count++;
+        }
+        if (received < receive_bytes) {
+            fds[count] = { prev_fd, POLLIN, 0 };
+            receive_index = count++;
+        }
+
+        int ready = poll(fds, count, timeout_ms);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready < 0) throw std::runtime_error(std::string("poll failed: ") + std::strerror(errno));
+        if (ready == 0) throw std::runtime_error("Timed out exchanging data with neighbouring ranks");
+
+        if (send_index >= 0 && fds[send_index].revents != 0) {
+            ssize_t k = send(next_fd, out + sent, send_bytes - sent, MSG_NOSIGNAL);
+            if (k > 0) {
+                sent += static_cast<size_t>(k);
+            } else if (k < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                throw std::runtime_error(std::string("Socket send failed: ") + std::strerror(errno));
+            }
+        }
+
+        if (receive_index >= 0 && fds[receive_index].revents != 0) {
+            ssize_t k = recv(prev_fd, in + received, receive_bytes - received, 0);
+            if (k > 0) {
+                received += static_cast<size_t>(k);
+            } else if (k == 0) {
+                throw std::runtime_error("Peer closed the connection");
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                throw std::runtime_error(std::string("Socket receive failed: ") + std::strerror(errno));
+            }
+        }
+    }
+};
+
+void TcpCommunicator::allReduce(double* data, size_t n) {
+    if (world_size == 1 || n == 0) {
+        return;
+    }
+
+    // Segment i covers [n * i / W, n * (i + 1) / W)
+    auto segmentBegin = [&](int i) { return n * static_cast<size_t>(i) / static_cast<size_t>(world_size); };
+    auto segmentSize = [&](int i) { return segmentBegin(i + 1) - segmentBegin(i); };
+    auto wrap = [&](int i) { return ((i % world_size) + world_size) % world_size; };
+
+    std::vector<double> incoming(segmentSize(world_size - 1) + 1);
+
+    // Reduce-scatter: after W - 1 steps this rank holds the full sum of segment rank + 1
+    for (int s = 0; s < world_size - 1; s++) {
+        int send_segment = wrap(my_rank - s);
+        int receive_segment = wrap(my_rank - s - 1);
+        exchange(data + segmentBegin(send_segment), segmentSize(send_segment) * sizeof(double), incoming.data(),
+            segmentSize(receive_segment) * sizeof(double));
+
+        double* target = data + segmentBegin(receive_segment);
+        for (size_t k = 0; k < segmentSize(receive_segment); k++) {
+            target[k] += incoming[k];
+        }
+    }
+
+    // All-gather: the reduced segments travel once around the ring and are copied, not re-added
+    for (int s = 0; s < world_size - 1; s++) {
+        int send_segment = wrap(my_rank - s + 1);
+        int receive_segment = wrap(my_rank - s);
+        exchange(data + segmentBegin(send_segment), segmentSize(send_segment) * sizeof(double),
+            data + segmentBegin(receive_segment), segmentSize(receive_segment) * sizeof(double));
+    }
+};
+
+void TcpCommunicator::broadcast(double* data, size_t n, int root) {
+    checkRank(root, world_size);
+    if (world_size == 1) {
+        return;
+    }
+
+    // Pipelined along the ring, so later ranks start forwarding before the whole buffer has arrived
+    const size_t chunk = 1 << 16;
+    int next = (my_rank + 1) % world_size;
+    for (size_t offset = 0; offset < n; offset += chunk) {
+        size_t bytes = std::min(chunk, n - offset) * sizeof(double);
+        if (my_rank != root) {
+            exchange(nullptr, 0, data + offset, bytes);
+        }
+        if (next != root) {
+            exchange(data + offset, bytes, nullptr, 0);
+        }
+    }
+};
+
+void TcpCommunicator::barrier() {
+    double token = 0.0;
+    allReduce(&token, 1);
+};
+
+AsyncCommunicator::AsyncCommunicator(Communicator& communicator) : communicator(communicator) {
+    worker = std::thread([this]() { run(); });
+};
+
+AsyncCommunicator::~AsyncCommunicator() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_one();
+    worker.join();
+};
+
+std::future<void> AsyncCommunicator::submit(std::function<void()> fn) {
+    std::packaged_task<void()> task(std::move(fn));
+    std::future<void> done = task.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    cv.notify_one();
+    return done;
+};
+
+std::future<void> AsyncCommunicator::allReduce(double* data, size_t n) {
+    return submit([this, data, n]() { communicator.allReduce(data, n); });
+};
+
+std::future<void> AsyncCommunicator::broadcast(double* data, size_t n, int root) {
+    return submit([this, data, n, root]() { communicator.broadcast(data, n, root); });
+};
+
+void AsyncCommunicator::run() {
+    while (true) {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+};
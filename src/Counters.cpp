@@ -0,0 +1,71 @@
+#include "Counters.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+thread_local ThreadCounters thread_counters;
+thread_local int thread_counters_state = 0;
+
+namespace {
+
+constexpr int NUM_COUNTERS = static_cast<int>(Counter::NumCounters);
+
+// Neither is ever destroyed, so threads that exit during static destruction can still retire their slots
+std::mutex& registryMutex() {
+    static std::mutex* mutex = new std::mutex();
+    return *mutex;
+}
+
+std::vector<ThreadCounters*>& liveThreads() {
+    static std::vector<ThreadCounters*>* threads = new std::vector<ThreadCounters*>();
+    return *threads;
+}
+
+std::atomic<int64_t> retired[NUM_COUNTERS];
+
+// Folds the thread's slots into the retired totals when the thread exits
+struct CounterRetirer {
+    ~CounterRetirer() {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            retired[c].fetch_add(thread_counters.values[c].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            thread_counters.values[c].store(0, std::memory_order_relaxed);
+        }
+
+        std::vector<ThreadCounters*>& threads = liveThreads();
+        threads.erase(std::remove(threads.begin(), threads.end(), &thread_counters), threads.end());
+        thread_counters_state = 2;
+    }
+};
+
+thread_local CounterRetirer counter_retirer;
+
+}
+
+void addCounterSlow(Counter counter, int64_t n) {
+    if (thread_counters_state == 2) {
+        retired[static_cast<int>(counter)].fetch_add(n, std::memory_order_relaxed);
+        return;
+    }
+
+    // Touch the retirer so its destructor runs at thread exit
+    (void)&counter_retirer;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        liveThreads().push_back(&thread_counters);
+    }
+    thread_counters_state = 1;
+    addCounter(counter, n);
+}
+
+int64_t readCounter(Counter counter) {
+    int c = static_cast<int>(counter);
+
+    std::lock_guard<std::mutex> lock(registryMutex());
+    int64_t total = retired[c].load(std::memory_order_relaxed);
+    for (ThreadCounters* thread : liveThreads()) {
+        total += thread->values[c].load(std::memory_order_relaxed);
+    }
+    return total;
+}
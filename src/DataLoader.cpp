@@ -0,0 +1,163 @@
+#include "DataLoader.hpp"
+#include "Random.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+DataLoader::DataLoader(std::shared_ptr<Dataset> data, int batchSize, bool shuffle, bool dropLast, bool prefetch) {
+    if (!data) {
+        throw std::runtime_error("DataLoader needs a dataset");
+    }
+    if (batchSize <= 0) {
+        throw std::runtime_error("Batch size must be positive");
+    }
+
+    dataset = std::move(data);
+    batch_size = batchSize;
+    this->shuffle = shuffle;
+    drop_last = dropLast;
+    this->prefetch = prefetch;
+};
+
+DataLoader::~DataLoader() {
+    stopProducer();
+};
+
+int64_t DataLoader::numBatches() const {
+    int64_t n = dataset->size();
+    return drop_last ? n / batch_size : (n + batch_size - 1) / batch_size;
+};
+
+void DataLoader::reset() {
+    startEpoch();
+};
+
+void DataLoader::stopProducer() {
+    if (producer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        producer.join();
+    }
+    stopping = false;
+};
+
+void DataLoader::startEpoch() {
+    stopProducer();
+
+    int64_t n = dataset->size();
+    if (shuffle) {
+        order = randomPermutation(n, nextStream());
+    } else {
+        order.resize(n);
+        for (int64_t i = 0; i < n; i++) {
+            order[i] = i;
+        }
+    }
+
+    next_batch = 0;
+    in_use_slot = -1;
+    epoch_started = true;
+    for (int s = 0; s < 2; s++) {
+        slot_states[s] = SlotState::Empty;
+        slot_batches[s] = -1;
+    }
+
+    if (prefetch) {
+        producer = std::thread([this]() { produce(); });
+    }
+};
+
+void DataLoader::fillBatch(int64_t batch, Batch& slot) const {
+    TRACE_SCOPE("DataLoader::fillBatch");
+    int64_t begin = batch * batch_size;
+    int rows = static_cast<int>(std::min<int64_t>(batch_size, dataset->size() - begin));
+    int feature_dim = dataset->featureDim();
+    int label_dim = dataset->labelDim();
+
+    // Same-shaped batches keep their Var nodes; only values (and stale graph state) are overwritten
+    slot.features.resize(rows, feature_dim);
+    slot.labels.resize(rows, label_dim);
+
+    std::vector<double> features(feature_dim);
+    std::vector<double> labels(label_dim);
+
+    for (int i = 0; i < rows; i++) {
+        dataset->getRow(order[begin + i], features.data(), labels.data());
+
+        for (int j = 0; j < feature_dim; j++) {
+            Var& x = slot.features.data[i][j];
+            x.resetGradAndParents();
+            x.setVal(features[j]);
+        }
+        for (int j = 0; j < label_dim; j++) {
+            Var& y = slot.labels.data[i][j];
+            y.resetGradAndParents();
+            y.setVal(labels[j]);
+        }
+    }
+};
+
+void DataLoader::produce() {
+    int64_t total = numBatches();
+
+    for (int64_t batch = 0; batch < total; batch++) {
+        int s = static_cast<int>(batch % 2);
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&]() { return stopping || slot_states[s] == SlotState::Empty; });
+            if (stopping) {
+                return;
+            }
+        }
+
+        // The slot is Empty, so the consumer will not touch it until it is marked Ready
+        fillBatch(batch, slots[s]);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            slot_states[s] = SlotState::Ready;
+            slot_batches[s] = batch;
+        }
+        cv.notify_all();
+    }
+};
+
+Batch* DataLoader::next() {
+    TRACE_SCOPE("DataLoader::next");
+    if (!epoch_started) {
+        startEpoch();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Hand the previous batch back so the producer can refill its slot
+    if (in_use_slot >= 0) {
+        slot_states[in_use_slot] = SlotState::Empty;
+        in_use_slot = -1;
+        cv.notify_all();
+    }
+
+    if (next_batch >= numBatches()) {
+        epoch_started = false;
+        return nullptr;
+    }
+
+    int s = static_cast<int>(next_batch % 2);
+
+    if (prefetch) {
+        cv.wait(lock, [&]() { return slot_states[s] == SlotState::Ready && slot_batches[s] == next_batch; });
+    } else {
+        fillBatch(next_batch, slots[s]);
+    }
+
+    slot_states[s] = SlotState::InUse;
+    in_use_slot = s;
+    next_batch += 1;
+
+    return &slots[s];
+};
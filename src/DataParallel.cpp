@@ -0,0 +1,137 @@
+#include "DataParallel.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+// Parameters per parallel chunk of the gradient reduction
+static const int64_t REDUCE_GRAIN = 1 << 14;
+
+DataParallelTrainer::DataParallelTrainer(NeuralNetwork* model, LossFunction loss, Optimizer* optimizer, int num_workers)
+    : Trainer(model, std::move(loss), optimizer) {
+    this->num_workers = num_workers > 0 ? num_workers : getNumThreads();
+
+    for (auto& layer : neural_network->layers) {
+        if (layer->stateBuffer() != nullptr) {
+            throw std::runtime_error(layer->name + " keeps state outside its parameters and cannot be replicated");
+        }
+    }
+
+    // Replicas are rebuilt from the layer configs, so each has its own nodes and parameter buffer
+    for (int w = 1; w < this->num_workers; w++) {
+        auto replica = std::make_unique<NeuralNetwork>(std::vector<std::shared_ptr<Layer>>{});
+        for (auto& layer : neural_network->layers) {
+            replica->addLayer(createLayer(layer->getConfig()));
+        }
+        replicas.push_back(std::move(replica));
+    }
+
+    shards.resize(this->num_workers);
+    broadcast();
+};
+
+NeuralNetwork& DataParallelTrainer::workerModel(int worker) {
+    return worker == 0 ? *neural_network : *replicas[worker - 1];
+};
+
+void DataParallelTrainer::broadcast() {
+    ParameterBuffer& master = neural_network->getParameterBuffer();
+    master.gather();
+
+    parallelFor(0, static_cast<int64_t>(replicas.size()), 1, [&](int64_t begin, int64_t end) {
+        SerialGuard serial;
+        for (int64_t r = begin; r < end; r++) {
+            ParameterBuffer& params = replicas[r]->getParameterBuffer();
+            params.values = master.values;
+            params.scatterValues();
+        }
+    });
+};
+
+void DataParallelTrainer::runShard(int worker, Matrix& features, Matrix& labels, int row_begin, int row_end) {
+    NeuralNetwork& model = workerModel(worker);
+    Shard& shard = shards[worker];
+    int rows = row_end - row_begin;
+
+    for (auto& layer : model.layers) {
+        if (layer->trainable) {
+            layer->resetGrad();
+        }
+    }
+
+    shard.features.resize(rows, features.cols);
+    shard.labels.resize(rows, labels.cols);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < features.cols; j++) {
+            Var& x = shard.features.data[i][j];
+            x.resetGradAndParents();
+            x.setVal(features.data[row_begin + i][j].getVal());
+        }
+        for (int j = 0; j < labels.cols; j++) {
+            Var& y = shard.labels.data[i][j];
+            y.resetGradAndParents();
+            y.setVal(labels.data[row_begin + i][j].getVal());
+        }
+    }
+
+    Matrix& preds = model.forwardBuffered(shard.features);
+    Var loss = loss_function(shard.labels, preds);
+
+    // Weighting by the shard's share of the batch makes the summed gradients those of the full-batch mean loss
+    double weight = static_cast<double>(rows) / static_cast<double>(features.rows);
+    loss.setGrad(weight);
+    loss.backward();
+
+    model.getParameterBuffer().gatherGrads();
+    shard.loss = weight * loss.getVal();
+};
+
+void DataParallelTrainer::allReduce(int active_workers) {
+    // Chunked reduction: every chunk of the flat buffer sums the shards in a fixed order, so the result
+    // does not depend on how the chunks are spread across threads
+    ParameterBuffer& master = neural_network->getParameterBuffer();
+    double* total = master.grads.data();
+
+    std::vector<const double*> partials;
+    for (int w = 1; w < active_workers; w++) {
+        partials.push_back(replicas[w - 1]->getParameterBuffer().grads.data());
+    }
+
+    parallelFor(0, static_cast<int64_t>(master.size()), REDUCE_GRAIN, [&](int64_t begin, int64_t end) {
+        for (const double* partial : partials) {
+            for (int64_t k = begin; k < end; k++) {
+                total[k] += partial[k];
+            }
+        }
+    });
+
+    master.scatterGrads();
+};
+
+double DataParallelTrainer::step(Matrix& features, Matrix& labels) {
+    if (features.rows != labels.rows) {
+        throw std::runtime_error("Features and labels have different numbers of rows");
+    }
+
+    int active_workers = std::max(1, std::min(num_workers, features.rows));
+
+    parallelFor(0, active_workers, 1, [&](int64_t begin, int64_t end) {
+        // Each task already owns a core, so kernels inside a shard run inline
+        SerialGuard serial;
+        for (int64_t w = begin; w < end; w++) {
+            int row_begin = static_cast<int>(static_cast<int64_t>(features.rows) * w / active_workers);
+            int row_end = static_cast<int>(static_cast<int64_t>(features.rows) * (w + 1) / active_workers);
+            runShard(static_cast<int>(w), features, labels, row_begin, row_end);
+        }
+    });
+
+    allReduce(active_workers);
+    optimizer->optimize();
+    broadcast();
+
+    double loss = 0.0;
+    for (int w = 0; w < active_workers; w++) {
+        loss += shards[w].loss;
+    }
+    return loss;
+};
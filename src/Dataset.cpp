@@ -0,0 +1,95 @@
+#include "Dataset.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+InMemoryDataset::InMemoryDataset(std::vector<double> features, std::vector<double> labels, int featureDim, int labelDim) {
+    this->features = std::move(features);
+    this->labels = std::move(labels);
+    feature_dim = featureDim;
+    label_dim = labelDim;
+
+    if (feature_dim <= 0 || label_dim < 0 || this->features.size() % feature_dim != 0) {
+        throw std::runtime_error("Feature buffer is not a whole number of rows");
+    }
+    if (this->labels.size() != static_cast<size_t>(size()) * label_dim) {
+        throw std::runtime_error("Label buffer does not match the number of feature rows");
+    }
+};
+
+int64_t InMemoryDataset::size() const {
+    return static_cast<int64_t>(features.size() / feature_dim);
+};
+
+int InMemoryDataset::featureDim() const {
+    return feature_dim;
+};
+
+int InMemoryDataset::labelDim() const {
+    return label_dim;
+};
+
+void InMemoryDataset::getRow(int64_t index, double* features, double* labels) const {
+    const double* feature_row = this->features.data() + index * feature_dim;
+    const double* label_row = this->labels.data() + index * label_dim;
+
+    for (int j = 0; j < feature_dim; j++) features[j] = feature_row[j];
+    for (int j = 0; j < label_dim; j++) labels[j] = label_row[j];
+};
+
+bool parseCSVRow(const std::string& line, std::vector<double>& row) {
+    row.clear();
+    if (line.empty() || line == "\r") {
+        return false;
+    }
+
+    std::stringstream stream(line);
+    std::string cell;
+    while (std::getline(stream, cell, ',')) {
+        row.push_back(std::stod(cell));
+    }
+    return true;
+};
+
+InMemoryDataset loadCSV(const std::string& path, int num_label_cols, bool has_header) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Could not open " + path);
+    }
+
+    std::vector<double> features;
+    std::vector<double> labels;
+    std::vector<double> row;
+    int num_cols = -1;
+
+    std::string line;
+    if (has_header) {
+        std::getline(file, line);
+    }
+
+    while (std::getline(file, line)) {
+        if (!parseCSVRow(line, row)) {
+            continue;
+        }
+
+        if (num_cols < 0) {
+            num_cols = static_cast<int>(row.size());
+            if (num_cols <= num_label_cols) {
+                throw std::runtime_error("CSV needs at least one feature column besides the labels");
+            }
+        } else if (static_cast<int>(row.size()) != num_cols) {
+            throw std::runtime_error("CSV rows have different numbers of columns");
+        }
+
+        int num_features = num_cols - num_label_cols;
+        features.insert(features.end(), row.begin(), row.begin() + num_features);
+        labels.insert(labels.end(), row.begin() + num_features, row.end());
+    }
+
+    if (num_cols < 0) {
+        throw std::runtime_error("CSV " + path + " has no data rows");
+    }
+
+    return InMemoryDataset(std::move(features), std::move(labels), num_cols - num_label_cols, num_label_cols);
+};
@@ -0,0 +1,111 @@
+#include "Distributed.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+
+// Parameters per parallel chunk when averaging the reduced gradients
+static const int64_t AVERAGE_GRAIN = 1 << 15;
+
+DistributedTrainer::DistributedTrainer(NeuralNetwork* model, LossFunction loss, Optimizer* optimizer, Communicator* communicator,
+    size_t bucket_size)
+    : Trainer(model, std::move(loss), optimizer) {
+    if (!communicator) {
+        throw std::runtime_error("DistributedTrainer needs a communicator");
+    }
+
+    for (auto& layer : neural_network->layers) {
+        if (layer->stateBuffer() != nullptr) {
+            throw std::runtime_error(layer->name + " keeps state outside its parameters and cannot be synchronized");
+        }
+    }
+
+    this->communicator = communicator;
+    this->bucket_size = std::max<size_t>(1, bucket_size);
+    async = std::make_unique<AsyncCommunicator>(*communicator);
+
+    broadcastParameters(0);
+};
+
+void DistributedTrainer::broadcastParameters(int root) {
+    ParameterBuffer& params = neural_network->getParameterBuffer();
+    params.gather();
+    async->broadcast(params.values.data(), params.size(), root).get();
+    params.scatterValues();
+};
+
+double DistributedTrainer::step(Matrix& features, Matrix& labels) {
+    optimizer->resetGrad();
+
+    Matrix& preds = neural_network->forwardBuffered(features);
+
+    Var loss = loss_function(labels, preds);
+    loss.setGrad(1.0);
+
+    // Buckets are cut from the end of the buffer, last layer first, as soon as backward has finalized a run of
+    // trailing slices, so their all-reduce overlaps the rest of backward. Every rank walks the slices in the
+    // same fixed order regardless of when each became ready, keeping the collectives matched across ranks.
+    ParameterBuffer& params = neural_network->getParameterBuffer();
+    std::vector<std::future<void>> pending;
+    std::vector<char> ready(params.slices.size(), 0);
+    size_t next_slice = params.slices.size();
+    size_t bucket_end = params.size();
+
+    auto submit = [&](size_t begin, size_t end) {
+        for (size_t chunk_end = end; chunk_end > begin;) {
+            size_t chunk_begin = chunk_end - begin > bucket_size ? chunk_end - bucket_size : begin;
+            pending.push_back(async->allReduce(params.grads.data() + chunk_begin, chunk_end - chunk_begin));
+            chunk_end = chunk_begin;
+        }
+    };
+
+    params.trackGradients([&](size_t slice) {
+        size_t begin = params.slices[slice].first;
+        params.gatherGrads(begin, begin + params.slices[slice].second);
+        ready[slice] = 1;
+
+        while (next_slice > 0 && ready[next_slice - 1]) {
+            next_slice -= 1;
+            size_t slice_begin = params.slices[next_slice].first;
+            if (bucket_end - slice_begin >= bucket_size) {
+                submit(slice_begin, bucket_end);
+                bucket_end = slice_begin;
+            }
+        }
+    });
+
+    loss.backward();
+    params.finishGradientTracking();
+    submit(0, bucket_end);
+
+    double total_loss = loss.getVal();
+    pending.push_back(async->allReduce(&total_loss, 1));
+
+    // Every request must finish before returning, since they point into this frame and the buffer
+    std::exception_ptr error;
+    for (auto& done : pending) {
+        try {
+            done.get();
+        } catch (...) {
+            if (!error) error = std::current_exception();
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    double scale = 1.0 / static_cast<double>(communicator->worldSize());
+    double* grads = params.grads.data();
+    parallelFor(0, static_cast<int64_t>(params.size()), AVERAGE_GRAIN, [&](int64_t begin, int64_t end) {
+        for (int64_t k = begin; k < end; k++) {
+            grads[k] *= scale;
+        }
+    });
+
+    params.scatterGrads();
+    optimizer->optimize();
+
+    return total_loss * scale;
+};
@@ -0,0 +1,181 @@
+#include "InferenceEngine.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+InferenceEngine::InferenceEngine(NeuralNetwork* model, int max_batch_size, double max_latency_ms) {
+    if (model == nullptr || max_batch_size < 1 || max_latency_ms < 0.0) {
+        throw std::runtime_error("InferenceEngine needs a model, a positive batch size and a non-negative latency");
+    }
+
+    neural_network = model;
+    this->max_batch_size = max_batch_size;
+    this->max_latency_ms = max_latency_ms;
+
+    latencies_ms.reserve(LATENCY_WINDOW);
+    stats_start = Clock::now();
+
+    worker = std::thread([this]() { run(); });
+};
+
+InferenceEngine::~InferenceEngine() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    worker.join();
+};
+
+std::future<std::vector<double>> InferenceEngine::submit(std::vector<double> input) {
+    Request request;
+    request.input = std::move(input);
+    request.arrival = Clock::now();
+    std::future<std::vector<double>> result = request.result.get_future();
+
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) {
+            throw std::runtime_error("InferenceEngine is shutting down");
+        }
+        queue.push_back(std::move(request));
+
+        // The batcher only needs waking for the first request of a batch and for a full batch
+        wake = queue.size() == 1 || queue.size() >= static_cast<size_t>(max_batch_size);
+    }
+    if (wake) {
+        cv.notify_all();
+    }
+
+    return result;
+};
+
+std::vector<double> InferenceEngine::infer(std::vector<double> input) {
+    return submit(std::move(input)).get();
+};
+
+void InferenceEngine::run() {
+    std::vector<Request> batch;
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        cv.wait(lock, [this]() { return stopping || !queue.empty(); });
+        if (queue.empty()) {
+            return;
+        }
+
+        // Wait for more rows until the batch is full or its oldest request has used up its latency budget
+        auto deadline = queue.front().arrival + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double, std::milli>(max_latency_ms));
+        cv.wait_until(lock, deadline, [this]() {
+            return stopping || queue.size() >= static_cast<size_t>(max_batch_size);
+        });
+
+        size_t rows = std::min(queue.size(), static_cast<size_t>(max_batch_size));
+        batch.clear();
+        for (size_t i = 0; i < rows; i++) {
+            batch.push_back(std::move(queue.front()));
+            queue.pop_front();
+        }
+
+        lock.unlock();
+        runBatch(batch);
+        lock.lock();
+    }
+};
+
+void InferenceEngine::runBatch(std::vector<Request>& batch) {
+    // Rows must share the width of the batch's first request; others fail on their own
+    size_t width = batch.front().input.size();
+    std::vector<Request*> rows;
+    for (Request& request : batch) {
+        if (request.input.size() == width && width > 0) {
+            rows.push_back(&request);
+        } else {
+            request.result.set_exception(std::make_exception_ptr(std::runtime_error(
+                "Input has " + std::to_string(request.input.size()) + " values, expected " + std::to_string(width))));
+        }
+    }
+    if (rows.empty()) {
+        return;
+    }
+
+    try {
+        Matrix input(static_cast<int>(rows.size()), static_cast<int>(width));
+        for (size_t i = 0; i < rows.size(); i++) {
+            for (size_t j = 0; j < width; j++) {
+                input.data[i][j].setVal(rows[i]->input[j]);
+            }
+        }
+
+        Matrix output = neural_network->predict(input);
+
+        std::vector<double> finished_ms;
+        finished_ms.reserve(rows.size());
+        for (size_t i = 0; i < rows.size(); i++) {
+            std::vector<double> values(output.cols);
+            for (int j = 0; j < output.cols; j++) {
+                values[j] = output.data[i][j].getVal();
+            }
+            rows[i]->result.set_value(std::move(values));
+            finished_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - rows[i]->arrival).count());
+        }
+
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        for (double ms : finished_ms) {
+            if (latencies_ms.size() < LATENCY_WINDOW) {
+                latencies_ms.push_back(ms);
+            } else {
+                latencies_ms[latency_next] = ms;
+            }
+            latency_next = (latency_next + 1) % LATENCY_WINDOW;
+        }
+        served_requests += static_cast<int64_t>(rows.size());
+        served_batches += 1;
+    } catch (...) {
+        std::exception_ptr error = std::current_exception();
+        for (Request* request : rows) {
+            try {
+                request->result.set_exception(error);
+            } catch (const std::future_error&) {
+                // Already fulfilled before the failure
+            }
+        }
+    }
+};
+
+// Nearest-rank percentile of an unsorted sample
+static double percentile(std::vector<double> samples, double p) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(p * static_cast<double>(samples.size() - 1) + 0.5);
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+}
+
+InferenceStats InferenceEngine::getStats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+
+    InferenceStats stats;
+    stats.requests = served_requests;
+    stats.batches = served_batches;
+    stats.mean_batch_size = served_batches > 0 ? static_cast<double>(served_requests) / static_cast<double>(served_batches) : 0.0;
+    stats.p50_latency_ms = percentile(latencies_ms, 0.50);
+    stats.p99_latency_ms = percentile(latencies_ms, 0.99);
+
+    double seconds = std::chrono::duration<double>(Clock::now() - stats_start).count();
+    stats.requests_per_second = seconds > 0.0 ? static_cast<double>(served_requests) / seconds : 0.0;
+
+    return stats;
+};
+
+void InferenceEngine::resetStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    latencies_ms.clear();
+    latency_next = 0;
+    served_requests = 0;
+    served_batches = 0;
+    stats_start = Clock::now();
+};
@@ -0,0 +1,344 @@
+#include "InferenceExport.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+static PlanOp planOp(const std::string& type) {
+    static const std::unordered_map<std::string, PlanOp> ops = {
+        { "Linear", PlanOp::Linear }, { "Conv2D", PlanOp::Conv2D }, { "MaxPool2D", PlanOp::MaxPool2D },
+        { "AvgPool2D", PlanOp::AvgPool2D }, { "Embedding", PlanOp::Embedding }, { "ReLU", PlanOp::ReLU },
+        { "LeakyReLU", PlanOp::LeakyReLU }, { "Sigmoid", PlanOp::Sigmoid }, { "Tanh", PlanOp::Tanh },
+        { "SiLU", PlanOp::SiLU }, { "ELU", PlanOp::ELU }, { "Softmax", PlanOp::Softmax }
+    };
+
+    auto it = ops.find(type);
+    if (it == ops.end()) {
+        throw std::runtime_error("Layer type " + type + " cannot be exported to an inference plan");
+    }
+    return it->second;
+}
+
+// One record per layer, with dense layers' weights packed in parameters() order (W then b) and Embedding's table
+static void buildPlan(NeuralNetwork& model, std::vector<PlanLayer>& records, std::vector<double>& weights) {
+    for (auto& layer : model.layers) {
+        LayerConfig config = layer->getConfig();
+
+        PlanLayer record;
+        std::memset(&record, 0, sizeof(PlanLayer));
+        record.op = static_cast<uint32_t>(planOp(config.type));
+
+        if (config.args.size() > 8) {
+            throw std::runtime_error("Too many arguments to export " + config.type);
+        }
+        if (record.op == static_cast<uint32_t>(PlanOp::LeakyReLU) || record.op == static_cast<uint32_t>(PlanOp::ELU)) {
+            record.alpha = config.args.at(0);
+        } else {
+            for (size_t k = 0; k < config.args.size(); k++) {
+                record.params[k] = static_cast<int32_t>(config.args[k]);
+            }
+        }
+        if (!config.options.empty() && config.options[0] == "nhwc") {
+            record.flags |= PLAN_CHANNELS_LAST;
+        }
+
+        record.weights = weights.size();
+        if (std::vector<double>* state = layer->stateBuffer()) {
+            weights.insert(weights.end(), state->begin(), state->end());
+        } else {
+            for (Matrix* param : layer->parameters()) {
+                for (int i = 0; i < param->rows; i++) {
+                    for (int j = 0; j < param->cols; j++) {
+                        weights.push_back(param->data[i][j].getVal());
+                    }
+                }
+            }
+        }
+        record.num_weights = weights.size() - record.weights;
+
+        if (!planLayerValid(record) || record.num_weights != planWeightCount(record)) {
+            throw std::runtime_error("Cannot export " + layer->name + ": unexpected shape or weights");
+        }
+        records.push_back(record);
+    }
+}
+
+// Resolves input_dim (0 takes it from the first layer) and checks it against every layer, returning the output width
+static int checkPlanWidths(const std::vector<PlanLayer>& records, int& input_dim) {
+    if (input_dim <= 0) {
+        input_dim = records.empty() ? 0 : planInputWidth(records.front());
+        if (input_dim <= 0) {
+            throw std::runtime_error("input_dim is required when the first layer does not fix the input width");
+        }
+    }
+
+    int width = input_dim;
+    for (size_t l = 0; l < records.size(); l++) {
+        int required = planInputWidth(records[l]);
+        if (required >= 0 && required != width) {
+            throw std::runtime_error("Layer " + std::to_string(l) + " expects " + std::to_string(required) +
+                " inputs but receives " + std::to_string(width));
+        }
+        width = planOutputWidth(records[l], width);
+    }
+    return width;
+}
+
+static void writePlan(const std::string& path, DataType dtype, int input_dim, int output_dim, const std::vector<PlanLayer>& records,
+    const std::vector<double>& weights, const std::vector<int8_t>& quantized) {
+    PlanHeader header;
+    std::memset(&header, 0, sizeof(PlanHeader));
+    std::memcpy(header.magic, PLAN_MAGIC, sizeof(PLAN_MAGIC));
+    header.version = PLAN_VERSION;
+    header.dtype = static_cast<uint32_t>(dtype);
+    header.num_layers = static_cast<uint32_t>(records.size());
+    header.input_dim = static_cast<uint32_t>(input_dim);
+    header.output_dim = static_cast<uint32_t>(output_dim);
+    header.num_weights = weights.size();
+    header.num_quantized = quantized.size();
+
+    // Weight blocks start on a cache line so the runtime can use them straight from the mapping
+    size_t element = dtype == DataType::Float32 ? sizeof(float) : sizeof(double);
+    size_t layers_end = sizeof(PlanHeader) + records.size() * sizeof(PlanLayer);
+    header.weights_offset = (layers_end + 63) / 64 * 64;
+    size_t weights_end = header.weights_offset + weights.size() * element;
+    header.quantized_offset = quantized.empty() ? 0 : (weights_end + 63) / 64 * 64;
+
+    // Write next to the target and rename, so readers never see a partial plan
+    std::string temp_path = path + ".tmp";
+    std::FILE* file = std::fopen(temp_path.c_str(), "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("Could not open " + temp_path + " for writing");
+    }
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> guard(file, &std::fclose);
+
+    std::vector<char> gap(header.weights_offset - layers_end, 0);
+    bool ok = std::fwrite(&header, sizeof(PlanHeader), 1, file) == 1;
+    ok = ok && (records.empty() || std::fwrite(records.data(), sizeof(PlanLayer), records.size(), file) == records.size());
+    ok = ok && (gap.empty() || std::fwrite(gap.data(), 1, gap.size(), file) == gap.size());
+
+    if (dtype == DataType::Float32) {
+        std::vector<float> packed(weights.begin(), weights.end());
+        ok = ok && (packed.empty() || std::fwrite(packed.data(), sizeof(float), packed.size(), file) == packed.size());
+    } else {
+        ok = ok && (weights.empty() || std::fwrite(weights.data(), sizeof(double), weights.size(), file) == weights.size());
+    }
+
+    if (!quantized.empty()) {
+        gap.assign(header.quantized_offset - weights_end, 0);
+        ok = ok && (gap.empty() || std::fwrite(gap.data(), 1, gap.size(), file) == gap.size());
+        ok = ok && std::fwrite(quantized.data(), 1, quantized.size(), file) == quantized.size();
+    }
+
+    ok = ok && std::fflush(file) == 0;
+    guard.reset();
+    if (!ok || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        throw std::runtime_error("Could not write inference plan " + path);
+    }
+}
+
+void exportInferencePlan(const std::string& path, NeuralNetwork& model, DataType dtype, int input_dim) {
+    std::vector<PlanLayer> records;
+    std::vector<double> weights;
+    buildPlan(model, records, weights);
+
+    int output_dim = checkPlanWidths(records, input_dim);
+    writePlan(path, dtype, input_dim, output_dim, records, weights, {});
+}
+
+// Up to max_rows dataset rows spread evenly over the whole dataset
+static Matrix sampleRows(const Dataset& dataset, int64_t max_rows) {
+    int64_t count = max_rows > 0 ? std::min(max_rows, dataset.size()) : dataset.size();
+    if (count <= 0) {
+        throw std::runtime_error("Dataset is empty");
+    }
+
+    Matrix X(static_cast<int>(count), dataset.featureDim());
+    std::vector<double> features(dataset.featureDim());
+    std::vector<double> labels(dataset.labelDim());
+    for (int64_t r = 0; r < count; r++) {
+        dataset.getRow(r * dataset.size() / count, features.data(), labels.data());
+        for (int j = 0; j < X.cols; j++) {
+            X.data[r][j].setVal(features[j]);
+        }
+    }
+    return X;
+}
+
+void exportQuantizedPlan(const std::string& path, NeuralNetwork& model, const Dataset& calibration, int64_t calibration_rows,
+    DataType dtype, int input_dim) {
+    std::vector<PlanLayer> records;
+    std::vector<double> weights;
+    buildPlan(model, records, weights);
+
+    if (input_dim <= 0) {
+        input_dim = calibration.featureDim();
+    }
+    int output_dim = checkPlanWidths(records, input_dim);
+    if (calibration.featureDim() != input_dim) {
+        throw std::runtime_error("Calibration rows have " + std::to_string(calibration.featureDim()) + " features, the plan expects " +
+            std::to_string(input_dim));
+    }
+
+    // Largest |input| each Linear layer sees over the calibration rows, run in chunks to bound graph-free memory
+    std::vector<double> ranges(records.size(), 0.0);
+    Matrix samples = sampleRows(calibration, calibration_rows);
+    const int chunk = 256;
+    NoGradGuard no_grad;
+    for (int r0 = 0; r0 < samples.rows; r0 += chunk) {
+        int rows = std::min(chunk, samples.rows - r0);
+        Matrix activations(rows, samples.cols);
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < samples.cols; j++) {
+                activations.data[i][j].setVal(samples.data[r0 + i][j].getVal());
+            }
+        }
+
+        for (size_t l = 0; l < records.size(); l++) {
+            if (static_cast<PlanOp>(records[l].op) == PlanOp::Linear) {
+                for (int i = 0; i < activations.rows; i++) {
+                    for (int j = 0; j < activations.cols; j++) {
+                        ranges[l] = std::max(ranges[l], std::abs(activations.data[i][j].getVal()));
+                    }
+                }
+            }
+            activations = model.layers[l]->forward(activations);
+        }
+    }
+
+    // Linear layers become QuantizedLinear: per-output-column weight scales, transposed int8 weights and
+    // a calibrated input scale. Every other layer keeps its floating-point weights.
+    std::vector<double> packed;
+    std::vector<int8_t> quantized;
+    for (size_t l = 0; l < records.size(); l++) {
+        PlanLayer& record = records[l];
+        const double* w = weights.data() + record.weights;
+        record.weights = packed.size();
+
+        if (static_cast<PlanOp>(record.op) != PlanOp::Linear) {
+            packed.insert(packed.end(), w, w + record.num_weights);
+            continue;
+        }
+
+        int in = record.params[0], out = record.params[1];
+        std::vector<double> scales(out);
+        for (int o = 0; o < out; o++) {
+            double largest = 0.0;
+            for (int i = 0; i < in; i++) {
+                largest = std::max(largest, std::abs(w[static_cast<size_t>(i) * out + o]));
+            }
+            scales[o] = largest > 0.0 ? largest / 127.0 : 1.0;
+
+            for (int i = 0; i < in; i++) {
+                quantized.push_back(planQuantize(w[static_cast<size_t>(i) * out + o], 1.0 / scales[o]));
+            }
+        }
+
+        record.op = static_cast<uint32_t>(PlanOp::QuantizedLinear);
+        record.alpha = ranges[l] > 0.0 ? ranges[l] / 127.0 : 1.0;
+        packed.insert(packed.end(), scales.begin(), scales.end());
+        packed.insert(packed.end(), w + static_cast<size_t>(in) * out, w + static_cast<size_t>(in) * out + out);
+        record.num_weights = planWeightCount(record);
+    }
+
+    writePlan(path, dtype, input_dim, output_dim, records, packed, quantized);
+}
+
+template <typename T>
+static PlanAccuracy measurePlan(const std::string& path, NeuralNetwork& model, const Dataset& dataset, int64_t max_rows) {
+    InferenceRuntime<T> runtime(path);
+    if (dataset.featureDim() != runtime.inputDim()) {
+        throw std::runtime_error("Dataset rows have " + std::to_string(dataset.featureDim()) + " features, the plan expects " +
+            std::to_string(runtime.inputDim()));
+    }
+
+    int64_t count = max_rows > 0 ? std::min(max_rows, dataset.size()) : dataset.size();
+    int out = runtime.outputDim();
+    int label_dim = dataset.labelDim();
+    bool classification = out > 1 && (label_dim == 1 || label_dim == out);
+
+    PlanAccuracy accuracy;
+    int64_t agree = 0, reference_correct = 0, plan_correct = 0;
+    double total_error = 0.0;
+
+    const int chunk = 256;
+    std::vector<double> features(dataset.featureDim());
+    std::vector<double> labels(label_dim);
+    for (int64_t r0 = 0; r0 < count; r0 += chunk) {
+        int rows = static_cast<int>(std::min<int64_t>(chunk, count - r0));
+        Matrix X(rows, dataset.featureDim());
+        std::vector<T> input(static_cast<size_t>(rows) * X.cols);
+        std::vector<int> targets(rows, -1);
+        for (int i = 0; i < rows; i++) {
+            dataset.getRow(r0 + i, features.data(), labels.data());
+            for (int j = 0; j < X.cols; j++) {
+                X.data[i][j].setVal(features[j]);
+                input[static_cast<size_t>(i) * X.cols + j] = static_cast<T>(features[j]);
+            }
+            if (classification) {
+                targets[i] = label_dim == 1 ? static_cast<int>(labels[0])
+                                            : static_cast<int>(std::max_element(labels.begin(), labels.end()) - labels.begin());
+            }
+        }
+
+        Matrix reference = model.predict(X);
+        if (reference.cols != out) {
+            throw std::runtime_error("Plan and model disagree on the output width");
+        }
+        std::vector<T> output = runtime.run(input, rows);
+
+        for (int i = 0; i < rows; i++) {
+            const T* row = output.data() + static_cast<size_t>(i) * out;
+            int reference_best = 0, plan_best = 0;
+            for (int j = 0; j < out; j++) {
+                double expected = reference.data[i][j].getVal();
+                double error = std::abs(static_cast<double>(row[j]) - expected);
+                accuracy.max_abs_error = std::max(accuracy.max_abs_error, error);
+                total_error += error;
+
+                reference_best = expected > reference.data[i][reference_best].getVal() ? j : reference_best;
+                plan_best = row[j] > row[plan_best] ? j : plan_best;
+            }
+
+            agree += reference_best == plan_best;
+            reference_correct += reference_best == targets[i];
+            plan_correct += plan_best == targets[i];
+        }
+    }
+
+    accuracy.rows = count;
+    accuracy.mean_abs_error = count > 0 ? total_error / static_cast<double>(count * out) : 0.0;
+    if (out > 1 && count > 0) {
+        accuracy.argmax_agreement = static_cast<double>(agree) / static_cast<double>(count);
+    }
+    if (classification && count > 0) {
+        accuracy.reference_accuracy = static_cast<double>(reference_correct) / static_cast<double>(count);
+        accuracy.plan_accuracy = static_cast<double>(plan_correct) / static_cast<double>(count);
+    }
+    return accuracy;
+}
+
+PlanAccuracy comparePlanAccuracy(const std::string& path, NeuralNetwork& model, const Dataset& dataset, int64_t max_rows) {
+    // Float32 plans are measured in float, the precision a server would run them in
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        throw std::runtime_error("Could not open " + path);
+    }
+    PlanHeader header;
+    bool read = std::fread(&header, sizeof(PlanHeader), 1, file) == 1;
+    std::fclose(file);
+    if (!read) {
+        throw std::runtime_error(path + " is too small to be an inference plan");
+    }
+
+    if (header.dtype == static_cast<uint32_t>(DataType::Float32)) {
+        return measurePlan<float>(path, model, dataset, max_rows);
+    }
+    return measurePlan<double>(path, model, dataset, max_rows);
+}
@@ -1,6 +1,8 @@
 #include "LossFunctions.hpp"
+#include "Trace.hpp"
 
 Var MSELoss(Matrix& labels, Matrix& preds) {
+    TRACE_SCOPE("MSELoss");
     if (labels.rows != preds.rows || labels.cols != preds.cols) {
         throw std::runtime_error("Dimension mismatch when attempting to compute loss");
     }
@@ -22,6 +24,7 @@ Var MSELoss(Matrix& labels, Matrix& preds) {
 };
 
 Var MAELoss(Matrix& labels, Matrix& preds) {
+    TRACE_SCOPE("MAELoss");
     if (labels.rows != preds.rows || labels.cols != preds.cols) {
         throw std::runtime_error("Dimension mismatch when attempting to compute loss");
     }
@@ -43,6 +46,7 @@ Var MAELoss(Matrix& labels, Matrix& preds) {
 };
 
 Var BCELoss(Matrix& labels, Matrix& preds, double eps) {
+    TRACE_SCOPE("BCELoss");
     if (labels.rows != preds.rows || labels.cols != preds.cols) {
         throw std::runtime_error("Dimension mismatch when attempting to compute loss");
     }
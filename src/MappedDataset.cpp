@@ -0,0 +1,272 @@
+#include "MappedDataset.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char DATASET_MAGIC[8] = { 'A', 'N', 'N', 'D', 'A', 'T', 'A', '\0' };
+static const uint32_t DATASET_VERSION = 1;
+
+size_t dataTypeSize(DataType dtype) {
+    switch (dtype) {
+        case DataType::Float32: return sizeof(float);
+        case DataType::Float64: return sizeof(double);
+    }
+    throw std::runtime_error("Unknown dataset dtype");
+};
+
+MappedDataset::MappedDataset(const std::string& path) {
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open " + path + ": " + std::strerror(errno));
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(DatasetFileHeader)) {
+        ::close(fd);
+        throw std::runtime_error(path + " is too small to be a dataset file");
+    }
+    mapping_size = static_cast<size_t>(info.st_size);
+
+    mapping = ::mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        ::close(fd);
+        throw std::runtime_error("Could not mmap " + path + ": " + std::strerror(errno));
+    }
+
+    std::memcpy(&header, mapping, sizeof(DatasetFileHeader));
+    payload = static_cast<const char*>(mapping) + sizeof(DatasetFileHeader);
+
+    std::string error;
+    if (std::memcmp(header.magic, DATASET_MAGIC, sizeof(DATASET_MAGIC)) != 0) {
+        error = path + " is not a dataset file";
+    } else if (header.version != DATASET_VERSION) {
+        error = path + " has unsupported dataset version " + std::to_string(header.version);
+    } else if (header.dtype > static_cast<uint32_t>(DataType::Float64)) {
+        error = path + " has an unknown dtype";
+    } else if (header.rows < 0 || header.feature_dim <= 0 || header.label_dim < 0
+        || header.label_dim > std::numeric_limits<int>::max() - header.feature_dim) {
+        error = path + " has an invalid shape";
+    } else if (static_cast<uint64_t>(header.rows) > (mapping_size - sizeof(DatasetFileHeader)) / rowBytes()) {
+        // Divides rather than multiplies, so a corrupt row count cannot wrap the size around
+        error = path + " is truncated";
+    }
+
+    if (!error.empty()) {
+        ::munmap(mapping, mapping_size);
+        ::close(fd);
+        throw std::runtime_error(error);
+    }
+};
+
+MappedDataset::~MappedDataset() {
+    if (mapping != nullptr) {
+        ::munmap(mapping, mapping_size);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+};
+
+int64_t MappedDataset::size() const {
+    return header.rows;
+};
+
+int MappedDataset::featureDim() const {
+    return header.feature_dim;
+};
+
+int MappedDataset::labelDim() const {
+    return header.label_dim;
+};
+
+DataType MappedDataset::dtype() const {
+    return static_cast<DataType>(header.dtype);
+};
+
+size_t MappedDataset::rowBytes() const {
+    return static_cast<size_t>(header.feature_dim + header.label_dim) * dataTypeSize(dtype());
+};
+
+const void* MappedDataset::rowData(int64_t index) const {
+    if (index < 0 || index >= header.rows) {
+        throw std::runtime_error("Row index out of range");
+    }
+    return payload + static_cast<size_t>(index) * rowBytes();
+};
+
+const void* MappedDataset::data() const {
+    return payload;
+};
+
+void MappedDataset::getRow(int64_t index, double* features, double* labels) const {
+    const void* row = rowData(index);
+    int feature_dim = header.feature_dim;
+    int label_dim = header.label_dim;
+
+    if (dtype() == DataType::Float64) {
+        const double* values = static_cast<const double*>(row);
+        std::memcpy(features, values, feature_dim * sizeof(double));
+        std::memcpy(labels, values + feature_dim, label_dim * sizeof(double));
+    } else {
+        const float* values = static_cast<const float*>(row);
+        for (int j = 0; j < feature_dim; j++) features[j] = values[j];
+        for (int j = 0; j < label_dim; j++) labels[j] = values[feature_dim + j];
+    }
+};
+
+DatasetWriter::DatasetWriter(const std::string& path, int featureDim, int labelDim, DataType dtype) {
+    if (featureDim <= 0 || labelDim < 0 || labelDim > std::numeric_limits<int>::max() - featureDim) {
+        throw std::runtime_error("Invalid dataset shape");
+    }
+
+    this->path = path;
+    std::memset(&header, 0, sizeof(DatasetFileHeader));
+    std::memcpy(header.magic, DATASET_MAGIC, sizeof(DATASET_MAGIC));
+    header.version = DATASET_VERSION;
+    header.dtype = static_cast<uint32_t>(dtype);
+    header.feature_dim = featureDim;
+    header.label_dim = labelDim;
+
+    row_buffer.resize(static_cast<size_t>(featureDim + labelDim) * dataTypeSize(dtype));
+
+    temp_path = path + ".tmp";
+    file = std::fopen(temp_path.c_str(), "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("Could not open " + temp_path + " for writing");
+    }
+
+    // Placeholder header; the row count is only known once all rows are in. The destructor does not run
+    // when the constructor throws, so drop the partial file here.
+    if (std::fwrite(&header, sizeof(DatasetFileHeader), 1, file) != 1) {
+        abandon();
+        throw std::runtime_error("Could not write to " + temp_path);
+    }
+};
+
+DatasetWriter::~DatasetWriter() {
+    if (file != nullptr) {
+        abandon();
+    }
+};
+
+void DatasetWriter::abandon() {
+    std::fclose(file);
+    file = nullptr;
+    std::remove(temp_path.c_str());
+};
+
+void DatasetWriter::writeRow(const double* features, const double* labels) {
+    if (file == nullptr) {
+        throw std::runtime_error("DatasetWriter is already closed");
+    }
+
+    int feature_dim = header.feature_dim;
+    int label_dim = header.label_dim;
+
+    if (static_cast<DataType>(header.dtype) == DataType::Float64) {
+        double* out = reinterpret_cast<double*>(row_buffer.data());
+        std::memcpy(out, features, feature_dim * sizeof(double));
+        std::memcpy(out + feature_dim, labels, label_dim * sizeof(double));
+    } else {
+        float* out = reinterpret_cast<float*>(row_buffer.data());
+        for (int j = 0; j < feature_dim; j++) out[j] = static_cast<float>(features[j]);
+        for (int j = 0; j < label_dim; j++) out[feature_dim + j] = static_cast<float>(labels[j]);
+    }
+
+    if (std::fwrite(row_buffer.data(), row_buffer.size(), 1, file) != 1) {
+        throw std::runtime_error("Could not write to " + temp_path);
+    }
+    header.rows += 1;
+};
+
+void DatasetWriter::writeRows(const double* features, const double* labels, int64_t rows) {
+    for (int64_t i = 0; i < rows; i++) {
+        writeRow(features + i * header.feature_dim, labels + i * header.label_dim);
+    }
+};
+
+void DatasetWriter::close() {
+    if (file == nullptr) {
+        return;
+    }
+
+    std::FILE* out = file;
+    file = nullptr;
+
+    bool ok = std::fseek(out, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(DatasetFileHeader), 1, out) == 1;
+    ok = std::fclose(out) == 0 && ok;
+    if (!ok || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        throw std::runtime_error("Could not finish writing " + path);
+    }
+};
+
+int64_t DatasetWriter::rowsWritten() const {
+    return header.rows;
+};
+
+void writeDataset(const std::string& path, const Dataset& dataset, DataType dtype) {
+    DatasetWriter writer(path, dataset.featureDim(), dataset.labelDim(), dtype);
+
+    std::vector<double> features(dataset.featureDim());
+    std::vector<double> labels(dataset.labelDim());
+    for (int64_t i = 0; i < dataset.size(); i++) {
+        dataset.getRow(i, features.data(), labels.data());
+        writer.writeRow(features.data(), labels.data());
+    }
+
+    writer.close();
+};
+
+int64_t convertCSV(const std::string& csv_path, const std::string& out_path, int num_label_cols, bool has_header, DataType dtype) {
+    std::ifstream file(csv_path);
+    if (!file) {
+        throw std::runtime_error("Could not open " + csv_path);
+    }
+
+    std::string line;
+    if (has_header) {
+        std::getline(file, line);
+    }
+
+    std::unique_ptr<DatasetWriter> writer;
+    std::vector<double> row;
+    int num_cols = -1;
+    int num_features = 0;
+
+    while (std::getline(file, line)) {
+        if (!parseCSVRow(line, row)) {
+            continue;
+        }
+
+        // The first data row fixes the shape
+        if (!writer) {
+            num_cols = static_cast<int>(row.size());
+            if (num_cols <= num_label_cols) {
+                throw std::runtime_error("CSV needs at least one feature column besides the labels");
+            }
+            num_features = num_cols - num_label_cols;
+            writer = std::make_unique<DatasetWriter>(out_path, num_features, num_label_cols, dtype);
+        } else if (static_cast<int>(row.size()) != num_cols) {
+            throw std::runtime_error("CSV rows have different numbers of columns");
+        }
+
+        writer->writeRow(row.data(), row.data() + num_features);
+    }
+
+    if (!writer) {
+        throw std::runtime_error("CSV " + csv_path + " has no data rows");
+    }
+
+    writer->close();
+    return writer->rowsWritten();
+};
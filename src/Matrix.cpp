@@ -1,4 +1,8 @@
 #include "Matrix.hpp"
+#include "Parallel.hpp"
+#include "Random.hpp"
+
+#include <algorithm>
 
 Matrix::Matrix() {
     rows = 0;
@@ -15,6 +19,20 @@ Matrix::Matrix(int r, int c) {
     }
 };
 
+void Matrix::resize(int r, int c) {
+    if (r == rows && c == cols) {
+        return;
+    }
+
+    rows = r;
+    cols = c;
+
+    data.resize(r);
+    for (int i = 0; i < r; ++i) {
+        data[i].resize(c);
+    }
+};
+
 void Matrix::resetGradAndParents() {
     for (int i = 0; i < rows; ++i) {
         for (int j = 0; j < cols; ++j) {
@@ -52,15 +70,42 @@ std::string Matrix::getGradsMatrix() const {
 };
 
 void Matrix::randomInit() {
-    for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < cols; j++) {
-            std::random_device rd;
-            std::mt19937 gen(rd());
-            std::uniform_real_distribution<double> unif(-0.01, 0.01);
+    std::vector<double> values(static_cast<size_t>(rows) * cols);
+    fillUniform(values.data(), static_cast<int64_t>(values.size()), -0.01, 0.01, nextStream());
+    setVals(values.data());
+};
 
-            data[i][j] = unif(gen);
+void Matrix::setVals(const double* values) {
+    parallelFor(0, rows, 64, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; i++) {
+            const double* row = values + i * cols;
+            for (int j = 0; j < cols; j++) {
+                data[i][j].setVal(row[j]);
+            }
         }
-    }
+    });
+};
+
+void Matrix::getVals(double* out) const {
+    parallelFor(0, rows, 64, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; i++) {
+            double* row = out + i * cols;
+            for (int j = 0; j < cols; j++) {
+                row[j] = data[i][j].getVal();
+            }
+        }
+    });
+};
+
+void Matrix::getGrads(double* out) const {
+    parallelFor(0, rows, 64, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; i++) {
+            double* row = out + i * cols;
+            for (int j = 0; j < cols; j++) {
+                row[j] = data[i][j].getGrad();
+            }
+        }
+    });
 };
 
 Matrix Matrix::add(Matrix& other) {
@@ -179,40 +224,117 @@ Matrix Matrix::multiply(double other) {
     return Y;
 };
 
-Matrix Matrix::matmul(Matrix& other) {
-    Matrix Y(rows, other.cols);
+// Cache blocking for the value product: rows of the output, columns of the output, and the inner dimension
+static const int MATMUL_BLOCK_ROWS = 32;
+static const int MATMUL_BLOCK_COLS = 32;
+static const int MATMUL_BLOCK_INNER = 256;
+
+// Computes the values with a blocked GEMM over contiguous copies of both operands, then builds a single
+// node per output: y = Σ_t a_t * b_t has parents a_t (∂y/∂a_t = b_t) and b_t (∂y/∂b_t = a_t), instead of
+// the 2 * inner multiply/add nodes a scalar chain would create. Y must already have the output shape.
+static void matmulKernel(Matrix& X0, Matrix& X1, Matrix& Y) {
+    const int n = X0.rows;
+    const int inner = X0.cols;
+    const int m = X1.cols;
+
+    // a is X0 row-major, bt is X1 transposed so both inner loops walk contiguous memory.
+    // Scratch comes from the pool so repeated products of the same shape don't hit the heap.
+    std::vector<double, PoolAllocator<double>> a(static_cast<size_t>(n) * inner);
+    std::vector<double, PoolAllocator<double>> bt(static_cast<size_t>(m) * inner);
+    std::vector<double, PoolAllocator<double>> c(static_cast<size_t>(n) * m, 0.0);
+
+    for (int i = 0; i < n; i++) {
+        for (int t = 0; t < inner; t++) {
+            a[static_cast<size_t>(i) * inner + t] = X0.data[i][t].getVal();
+        }
+    }
+    for (int t = 0; t < inner; t++) {
+        for (int j = 0; j < m; j++) {
+            bt[static_cast<size_t>(j) * inner + t] = X1.data[t][j].getVal();
+        }
+    }
 
-    for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < other.cols; j++) {
-            Var sum(0.0);
+    parallelFor(0, n, MATMUL_BLOCK_ROWS, [&](int64_t row_begin, int64_t row_end) {
+        for (int64_t i0 = row_begin; i0 < row_end; i0 += MATMUL_BLOCK_ROWS) {
+            int64_t i1 = std::min<int64_t>(i0 + MATMUL_BLOCK_ROWS, row_end);
+
+            for (int j0 = 0; j0 < m; j0 += MATMUL_BLOCK_COLS) {
+                int j1 = std::min(j0 + MATMUL_BLOCK_COLS, m);
+
+                for (int t0 = 0; t0 < inner; t0 += MATMUL_BLOCK_INNER) {
+                    int t1 = std::min(t0 + MATMUL_BLOCK_INNER, inner);
+
+                    for (int64_t i = i0; i < i1; i++) {
+                        const double* a_row = a.data() + i * inner;
+                        for (int j = j0; j < j1; j++) {
+                            const double* b_col = bt.data() + static_cast<size_t>(j) * inner;
+
+                            double sum = 0.0;
+                            for (int t = t0; t < t1; t++) {
+                                sum += a_row[t] * b_col[t];
+                            }
+                            c[i * m + j] += sum;
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    if (!isGradEnabled()) {
+        // Without edges the outputs are independent leaves, so they can be built in parallel
+        parallelFor(0, n, MATMUL_BLOCK_ROWS, [&](int64_t row_begin, int64_t row_end) {
+            for (int64_t i = row_begin; i < row_end; i++) {
+                for (int j = 0; j < m; j++) {
+                    Y.data[i][j] = Var(c[i * m + j]);
+                }
+            }
+        });
+        return;
+    }
 
-            for (int t = 0; t < cols; t++) {
-                Var current(data[i][t] * other.data[t][j]);
-                sum = sum + current;
+    // Node construction stays serial because it bumps pending_children on shared input nodes
+    for (int i = 0; i < n; i++) {
+        const double* a_row = a.data() + static_cast<size_t>(i) * inner;
+        for (int j = 0; j < m; j++) {
+            const double* b_col = bt.data() + static_cast<size_t>(j) * inner;
+
+            Var y(c[static_cast<size_t>(i) * m + j]);
+            y.reserveParents(2 * static_cast<size_t>(inner));
+            for (int t = 0; t < inner; t++) {
+                y.addParent(b_col[t], X0.data[i][t]);
+                y.addParent(a_row[t], X1.data[t][j]);
             }
-            Y.data[i][j] = sum;
+            Y.data[i][j] = y;
         }
     }
+}
 
-    return Y;
+Matrix Matrix::matmul(Matrix& other) {
+    return ::matmul(*this, other);
 };
 
 Matrix matmul(Matrix& X0, Matrix& X1) {
-    Matrix Y(X0.rows, X1.cols);
+    Matrix Y;
+    matmul(X0, X1, Y);
+    return Y;
+};
 
-    for (int i = 0; i < X0.rows; i++) {
-        for (int j = 0; j < X1.cols; j++) {
-            Var sum(0.0);
+void matmul(Matrix& X0, Matrix& X1, Matrix& Y) {
+    if (X0.cols != X1.rows) {
+        throw std::runtime_error("Dimension mismatch when attempting to multiply matrices");
+    }
 
-            for (int t = 0; t < X0.cols; t++) {
-                Var current(X0.data[i][t] * X1.data[t][j]);
-                sum = sum + current;
-            }
-            Y.data[i][j] = sum;
-        }
+    // The kernel reads its operands' nodes while it writes Y, so an aliased output is built separately
+    if (&Y == &X0 || &Y == &X1) {
+        Matrix product(X0.rows, X1.cols);
+        matmulKernel(X0, X1, product);
+        Y = std::move(product);
+        return;
     }
 
-    return Y;
+    Y.resize(X0.rows, X1.cols);
+    matmulKernel(X0, X1, Y);
 };
 
 Matrix Matrix::divide(double other) {
@@ -328,3 +450,159 @@ Matrix Matrix::softmax() {
 
     return Y;
 };
+
+
+Matrix& Matrix::add_(Matrix& other) {
+    if (rows == other.rows && cols == other.cols) {
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < cols; j++) {
+                data[i][j] = data[i][j] + other.data[i][j];
+            }
+        }
+    } else if (other.rows == 1 && other.cols == 1) {
+        // Broadcast the scalar when the other has shape (1, 1)
+        Var& val = other.data[0][0];
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < cols; j++) {
+                data[i][j] = data[i][j] + val;
+            }
+        }
+    } else if (other.rows == 1 && other.cols == cols) {
+        // Broadcast a row vector across rows
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < cols; j++) {
+                data[i][j] = data[i][j] + other.data[0][j];
+            }
+        }
+    } else if (other.cols == 1 && other.rows == rows) {
+        // Broadcast a column vector across columns
+        for (int i = 0; i < rows; i++) {
+            Var& val = other.data[i][0];
+            for (int j = 0; j < cols; j++) {
+                data[i][j] = data[i][j] + val;
+            }
+        }
+    } else {
+        throw std::runtime_error("Dimension mismatch when attempting to add matrices");
+    }
+
+    return *this;
+};
+
+Matrix& Matrix::add_(double other) {
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            data[i][j] = data[i][j] + other;
+        }
+    }
+
+    return *this;
+};
+
+Matrix& Matrix::mul_(Matrix& other) {
+    if (rows == other.rows && cols == other.cols) {
+        // Element-wise product for matrices with the same shape
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < cols; j++) {
+                data[i][j] = data[i][j] * other.data[i][j];
+            }
+        }
+    } else if (other.rows == 1 && other.cols == 1) {
+        // Broadcast the scalar when the other has shape (1, 1)
+        Var& val = other.data[0][0];
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < cols; j++) {
+                data[i][j] = data[i][j] * val;
+            }
+        }
+    } else if (other.rows == 1 && other.cols == cols) {
+        // Broadcast a row vector across rows
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < cols; j++) {
+                data[i][j] = data[i][j] * other.data[0][j];
+            }
+        }
+    } else if (other.cols == 1 && other.rows == rows) {
+        // Broadcast a column vector across columns
+        for (int i = 0; i < rows; i++) {
+            Var& val = other.data[i][0];
+            for (int j = 0; j < cols; j++) {
+                data[i][j] = data[i][j] * val;
+            }
+        }
+    } else {
+        throw std::runtime_error("Dimension mismatch when attempting to multiply matrices");
+    }
+
+    return *this;
+};
+
+Matrix& Matrix::mul_(double other) {
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            data[i][j] = data[i][j] * other;
+        }
+    }
+
+    return *this;
+};
+
+Matrix& Matrix::relu_() {
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            data[i][j] = data[i][j].relu();
+        }
+    }
+
+    return *this;
+};
+
+Matrix& Matrix::leakyRelu_(double alpha) {
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            data[i][j] = data[i][j].leakyRelu(alpha);
+        }
+    }
+
+    return *this;
+};
+
+Matrix& Matrix::sigmoid_() {
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            data[i][j] = data[i][j].sigmoid();
+        }
+    }
+
+    return *this;
+};
+
+Matrix& Matrix::tanh_() {
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            data[i][j] = data[i][j].tanh();
+        }
+    }
+
+    return *this;
+};
+
+Matrix& Matrix::silu_() {
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            data[i][j] = data[i][j].silu();
+        }
+    }
+
+    return *this;
+};
+
+Matrix& Matrix::elu_(double alpha) {
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            data[i][j] = data[i][j].elu(alpha);
+        }
+    }
+
+    return *this;
+};
\ No newline at end of file
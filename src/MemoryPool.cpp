@@ -0,0 +1,117 @@
+#include "MemoryPool.hpp"
+#include "Counters.hpp"
+
+#include <atomic>
+#include <new>
+
+namespace {
+
+// Power-of-two size classes from 16 bytes to 64 KB; anything larger goes straight to the heap
+constexpr std::size_t MIN_BLOCK_BYTES = 16;
+constexpr int NUM_SIZE_CLASSES = 13;
+
+// Upper bound on cached blocks per size class and thread, so memory freed on a different thread
+// than it was allocated on cannot pile up forever
+constexpr std::size_t MAX_CACHED_BLOCKS = 1 << 20;
+
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+struct FreeList {
+    FreeBlock* head = nullptr;
+    std::size_t count = 0;
+};
+
+std::atomic<long long> heap_allocations{0};
+
+// Trivially destructible, so it stays usable while other thread_local/static objects are torn down
+thread_local FreeList free_lists[NUM_SIZE_CLASSES];
+thread_local bool pool_released = false;
+
+struct PoolReleaser {
+    ~PoolReleaser() {
+        for (int c = 0; c < NUM_SIZE_CLASSES; c++) {
+            FreeBlock* block = free_lists[c].head;
+            while (block) {
+                FreeBlock* next = block->next;
+                ::operator delete(block);
+                block = next;
+            }
+            free_lists[c].head = nullptr;
+            free_lists[c].count = 0;
+        }
+        pool_released = true;
+    }
+};
+
+thread_local PoolReleaser pool_releaser;
+
+int sizeClass(std::size_t bytes) {
+    std::size_t block = MIN_BLOCK_BYTES;
+    int c = 0;
+    while (block < bytes) {
+        block <<= 1;
+        c++;
+    }
+    return c;
+}
+
+}
+
+void* poolAllocate(std::size_t bytes) {
+    int c = sizeClass(bytes);
+
+    addCounter(Counter::PoolBlocks, 1);
+    addCounter(Counter::PoolBytes, static_cast<int64_t>(poolBlockSize(bytes)));
+
+    if (c >= NUM_SIZE_CLASSES || pool_released) {
+        heap_allocations.fetch_add(1, std::memory_order_relaxed);
+        return ::operator new(bytes);
+    }
+
+    FreeList& list = free_lists[c];
+    if (list.head) {
+        FreeBlock* block = list.head;
+        list.head = block->next;
+        list.count -= 1;
+        return block;
+    }
+
+    // Touch the releaser so the thread's cached blocks are returned to the heap when it exits
+    (void)&pool_releaser;
+
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    return ::operator new(MIN_BLOCK_BYTES << c);
+}
+
+void poolDeallocate(void* ptr, std::size_t bytes) {
+    if (!ptr) {
+        return;
+    }
+
+    int c = sizeClass(bytes);
+    if (c >= NUM_SIZE_CLASSES || pool_released || free_lists[c].count >= MAX_CACHED_BLOCKS) {
+        ::operator delete(ptr);
+        return;
+    }
+
+    FreeList& list = free_lists[c];
+    FreeBlock* block = static_cast<FreeBlock*>(ptr);
+    block->next = list.head;
+    list.head = block;
+    list.count += 1;
+}
+
+std::size_t poolBlockSize(std::size_t bytes) {
+    int c = sizeClass(bytes);
+    return c < NUM_SIZE_CLASSES ? MIN_BLOCK_BYTES << c : bytes;
+}
+
+long long getAllocationCount() {
+    return heap_allocations.load(std::memory_order_relaxed);
+}
+
+void resetAllocationCount() {
+    heap_allocations.store(0, std::memory_order_relaxed);
+}
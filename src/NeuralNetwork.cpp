@@ -1,8 +1,10 @@
 #include "NeuralNetwork.hpp"
+#include "Profiler.hpp"
+#include "Random.hpp"
+#include "Trace.hpp"
 
 #include <cctype>
 #include <cmath>
-#include <random>
 
 void initWeights(Matrix& W, int fan_in, int fan_out, const std::string& init) {
     double stddev = 0.0;
@@ -13,17 +15,49 @@ void initWeights(Matrix& W, int fan_in, int fan_out, const std::string& init) {
         stddev = std::sqrt(2.0 / static_cast<double>(fan_in));
     }
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::normal_distribution<double> dist(0.0, stddev);
+    std::vector<double> values(static_cast<size_t>(W.rows) * W.cols);
+    fillNormal(values.data(), static_cast<int64_t>(values.size()), 0.0, stddev, nextStream());
+    W.setVals(values.data());
+}
 
-    for (int i = 0; i < W.rows; i++) {
-        for (int j = 0; j < W.cols; j++) {
-            W.data[i][j] = dist(gen);
-        }
+void Layer::forwardInto(Matrix& input, Matrix& output) {
+    output = forward(input);
+}
+
+std::vector<Matrix*> Layer::parameters() {
+    return {};
+}
+
+LayerConfig Layer::getConfig() const {
+    throw std::runtime_error(name + " does not provide a config, so it cannot be serialized");
+}
+
+std::vector<double>* Layer::stateBuffer() {
+    return nullptr;
+}
+
+const char* Layer::traceName() {
+    const char* cached = trace_name.load(std::memory_order_acquire);
+    if (cached == nullptr || name != cached) {
+        cached = internTraceName(name);
+        trace_name.store(cached, std::memory_order_release);
     }
+    return cached;
+}
+
+uint64_t Layer::nextParameterGeneration() {
+    // Drawn from one counter, so a layer freed and another allocated at the same address never share a stamp
+    static std::atomic<uint64_t> counter{ 0 };
+    return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+uint64_t Layer::parameterGeneration() const {
+    return parameter_generation;
 }
 
+void Layer::parametersChanged() {
+    parameter_generation = nextParameterGeneration();
+}
 
 Linear::Linear(int inDim, int outDim, const std::string& init) {
     name = "Linear(" + std::to_string(inDim) + ", " + std::to_string(outDim) + ")";
@@ -40,6 +74,17 @@ Matrix Linear::forward(Matrix& input) {
     return output;
 };
 
+void Linear::forwardInto(Matrix& input, Matrix& output) {
+    matmul(input, W, output);
+    output.add_(b);
+};
+
+Matrix Linear::forward(SparseMatrix& input) {
+    Matrix output = matmul(input, W);
+    output.add_(b);
+    return output;
+};
+
 void Linear::optimizeWeights(double learning_rate) {
     // Backpropagation and Gradient Descent for each parameter
 
@@ -71,6 +116,431 @@ void Linear::resetGrad() {
     b.resetGradAndParents();
 };
 
+LayerConfig Linear::getConfig() const {
+    return { "Linear", { static_cast<double>(W.rows), static_cast<double>(W.cols) }, {} };
+};
+
+std::vector<Matrix*> Linear::parameters() {
+    return { &W, &b };
+};
+
+// Output extent of a sliding window along one spatial dimension
+static int slidingOutputSize(int in, int kernel, int stride, int padding, int dilation) {
+    int span = in + 2 * padding - dilation * (kernel - 1) - 1;
+    if (span < 0 || stride <= 0) {
+        throw std::runtime_error("Window does not fit the input with the given kernel, stride, padding and dilation");
+    }
+    return span / stride + 1;
+}
+
+static bool isChannelsLast(const std::string& layout) {
+    if (layout == "nchw") return false;
+    if (layout == "nhwc") return true;
+    throw std::runtime_error("Unknown layout '" + layout + "', expected \"nchw\" or \"nhwc\"");
+}
+
+// Column of (c, y, x) within a flattened image row
+static int imageIndex(bool channels_last, int c, int y, int x, int channels, int height, int width) {
+    return channels_last ? (y * width + x) * channels + c : (c * height + y) * width + x;
+}
+
+Conv2D::Conv2D(int inChannels, int outChannels, int kernelSize, int inHeight, int inWidth,
+    int stride, int padding, int dilation, const std::string& layout, const std::string& init) {
+    in_channels = inChannels;
+    out_channels = outChannels;
+    kernel_size = kernelSize;
+    this->stride = stride;
+    this->padding = padding;
+    this->dilation = dilation;
+    in_height = inHeight;
+    in_width = inWidth;
+    this->layout = layout;
+
+    isChannelsLast(layout);
+    out_height = slidingOutputSize(in_height, kernel_size, stride, padding, dilation);
+    out_width = slidingOutputSize(in_width, kernel_size, stride, padding, dilation);
+
+    name = "Conv2D(" + std::to_string(in_channels) + ", " + std::to_string(out_channels) +
+        ", kernel=" + std::to_string(kernel_size) + ", stride=" + std::to_string(stride) +
+        ", padding=" + std::to_string(padding) + ", dilation=" + std::to_string(dilation) + ", " + layout + ")";
+    trainable = true;
+
+    int patch = in_channels * kernel_size * kernel_size;
+    W = Matrix(patch, out_channels);
+    initWeights(W, patch, out_channels * kernel_size * kernel_size, init);
+
+    b = Matrix(1, out_channels);
+}
+
+Matrix Conv2D::forward(Matrix& input) {
+    if (input.cols != in_channels * in_height * in_width) {
+        throw std::runtime_error("Dimension mismatch when attempting to apply Conv2D");
+    }
+
+    bool channels_last = isChannelsLast(layout);
+    int positions = out_height * out_width;
+    int patch = in_channels * kernel_size * kernel_size;
+
+    // im2col: one row per output position holding the Var handles under the kernel. The handles are shared
+    // with the input, so backward accumulating into them is the col2im scatter-add of overlapping patches.
+    Matrix columns(input.rows * positions, patch);
+    Var zero = Var::constant(0.0);
+
+    for (int n = 0; n < input.rows; n++) {
+        for (int oy = 0; oy < out_height; oy++) {
+            for (int ox = 0; ox < out_width; ox++) {
+                Matrix::Row& column = columns.data[n * positions + oy * out_width + ox];
+
+                for (int c = 0; c < in_channels; c++) {
+                    for (int ky = 0; ky < kernel_size; ky++) {
+                        int iy = oy * stride - padding + ky * dilation;
+
+                        for (int kx = 0; kx < kernel_size; kx++) {
+                            int ix = ox * stride - padding + kx * dilation;
+                            int col = (c * kernel_size + ky) * kernel_size + kx;
+
+                            if (iy < 0 || iy >= in_height || ix < 0 || ix >= in_width) {
+                                column[col] = zero;
+                            } else {
+                                column[col] = input.data[n][imageIndex(channels_last, c, iy, ix, in_channels, in_height, in_width)];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // (N * positions, patch) @ (patch, out_channels) through the blocked matmul path
+    Matrix products = matmul(columns, W);
+    products.add_(b);
+
+    Matrix output(input.rows, out_channels * positions);
+    for (int n = 0; n < input.rows; n++) {
+        for (int pos = 0; pos < positions; pos++) {
+            Matrix::Row& product = products.data[n * positions + pos];
+            int oy = pos / out_width;
+            int ox = pos % out_width;
+
+            for (int oc = 0; oc < out_channels; oc++) {
+                output.data[n][imageIndex(channels_last, oc, oy, ox, out_channels, out_height, out_width)] = product[oc];
+            }
+        }
+    }
+
+    return output;
+};
+
+void Conv2D::optimizeWeights(double learning_rate) {
+    for (Matrix* param : { &W, &b }) {
+        for (int i = 0; i < param->rows; i++) {
+            for (int j = 0; j < param->cols; j++) {
+                Var& p = param->data[i][j];
+                p.setVal(p.getVal() - learning_rate * p.getGrad());
+            }
+        }
+    }
+};
+
+void Conv2D::resetGrad() {
+    W.resetGradAndParents();
+    b.resetGradAndParents();
+};
+
+LayerConfig Conv2D::getConfig() const {
+    return { "Conv2D", {
+        static_cast<double>(in_channels), static_cast<double>(out_channels), static_cast<double>(kernel_size),
+        static_cast<double>(in_height), static_cast<double>(in_width),
+        static_cast<double>(stride), static_cast<double>(padding), static_cast<double>(dilation)
+    }, { layout } };
+};
+
+std::vector<Matrix*> Conv2D::parameters() {
+    return { &W, &b };
+};
+
+MaxPool2D::MaxPool2D(int numChannels, int kernelSize, int inHeight, int inWidth, int stride, int padding, const std::string& layout) {
+    channels = numChannels;
+    kernel_size = kernelSize;
+    this->stride = stride > 0 ? stride : kernelSize;
+    this->padding = padding;
+    in_height = inHeight;
+    in_width = inWidth;
+    this->layout = layout;
+
+    if (2 * padding > kernel_size) {
+        throw std::runtime_error("Pooling padding must be at most half the kernel size");
+    }
+
+    isChannelsLast(layout);
+    out_height = slidingOutputSize(in_height, kernel_size, this->stride, padding, 1);
+    out_width = slidingOutputSize(in_width, kernel_size, this->stride, padding, 1);
+
+    name = "MaxPool2D(kernel=" + std::to_string(kernel_size) + ", stride=" + std::to_string(this->stride) +
+        ", padding=" + std::to_string(padding) + ", " + layout + ")";
+    trainable = false;
+}
+
+Matrix MaxPool2D::forward(Matrix& input) {
+    if (input.cols != channels * in_height * in_width) {
+        throw std::runtime_error("Dimension mismatch when attempting to apply MaxPool2D");
+    }
+
+    bool channels_last = isChannelsLast(layout);
+    Matrix output(input.rows, channels * out_height * out_width);
+
+    for (int n = 0; n < input.rows; n++) {
+        for (int c = 0; c < channels; c++) {
+            for (int oy = 0; oy < out_height; oy++) {
+                for (int ox = 0; ox < out_width; ox++) {
+                    Var* best = nullptr;
+
+                    for (int ky = 0; ky < kernel_size; ky++) {
+                        int iy = oy * stride - padding + ky;
+                        if (iy < 0 || iy >= in_height) continue;
+
+                        for (int kx = 0; kx < kernel_size; kx++) {
+                            int ix = ox * stride - padding + kx;
+                            if (ix < 0 || ix >= in_width) continue;
+
+                            Var& candidate = input.data[n][imageIndex(channels_last, c, iy, ix, channels, in_height, in_width)];
+                            if (!best || candidate.getVal() > best->getVal()) {
+                                best = &candidate;
+                            }
+                        }
+                    }
+
+                    // ∂max/∂input is 1 for the arg max, so the output simply shares its node
+                    output.data[n][imageIndex(channels_last, c, oy, ox, channels, out_height, out_width)] = *best;
+                }
+            }
+        }
+    }
+
+    return output;
+};
+
+void MaxPool2D::optimizeWeights(double learning_rate) {
+    (void)learning_rate;
+}
+
+void MaxPool2D::resetGrad() {}
+
+LayerConfig MaxPool2D::getConfig() const {
+    return { "MaxPool2D", {
+        static_cast<double>(channels), static_cast<double>(kernel_size), static_cast<double>(in_height),
+        static_cast<double>(in_width), static_cast<double>(stride), static_cast<double>(padding)
+    }, { layout } };
+};
+
+AvgPool2D::AvgPool2D(int numChannels, int kernelSize, int inHeight, int inWidth, int stride, int padding, const std::string& layout) {
+    channels = numChannels;
+    kernel_size = kernelSize;
+    this->stride = stride > 0 ? stride : kernelSize;
+    this->padding = padding;
+    in_height = inHeight;
+    in_width = inWidth;
+    this->layout = layout;
+
+    if (2 * padding > kernel_size) {
+        throw std::runtime_error("Pooling padding must be at most half the kernel size");
+    }
+
+    isChannelsLast(layout);
+    out_height = slidingOutputSize(in_height, kernel_size, this->stride, padding, 1);
+    out_width = slidingOutputSize(in_width, kernel_size, this->stride, padding, 1);
+
+    name = "AvgPool2D(kernel=" + std::to_string(kernel_size) + ", stride=" + std::to_string(this->stride) +
+        ", padding=" + std::to_string(padding) + ", " + layout + ")";
+    trainable = false;
+}
+
+Matrix AvgPool2D::forward(Matrix& input) {
+    if (input.cols != channels * in_height * in_width) {
+        throw std::runtime_error("Dimension mismatch when attempting to apply AvgPool2D");
+    }
+
+    bool channels_last = isChannelsLast(layout);
+    double scale = 1.0 / (kernel_size * kernel_size);
+    Matrix output(input.rows, channels * out_height * out_width);
+
+    for (int n = 0; n < input.rows; n++) {
+        for (int c = 0; c < channels; c++) {
+            for (int oy = 0; oy < out_height; oy++) {
+                for (int ox = 0; ox < out_width; ox++) {
+                    double sum = 0.0;
+                    Var y;
+                    y.reserveParents(kernel_size * kernel_size);
+
+                    // One node per window with ∂y/∂input = 1 / kernel_size^2 for every element inside it
+                    for (int ky = 0; ky < kernel_size; ky++) {
+                        int iy = oy * stride - padding + ky;
+                        if (iy < 0 || iy >= in_height) continue;
+
+                        for (int kx = 0; kx < kernel_size; kx++) {
+                            int ix = ox * stride - padding + kx;
+                            if (ix < 0 || ix >= in_width) continue;
+
+                            Var& element = input.data[n][imageIndex(channels_last, c, iy, ix, channels, in_height, in_width)];
+                            sum += element.getVal();
+                            y.addParent(scale, element);
+                        }
+                    }
+
+                    y.setVal(sum * scale);
+                    output.data[n][imageIndex(channels_last, c, oy, ox, channels, out_height, out_width)] = y;
+                }
+            }
+        }
+    }
+
+    return output;
+};
+
+void AvgPool2D::optimizeWeights(double learning_rate) {
+    (void)learning_rate;
+}
+
+void AvgPool2D::resetGrad() {}
+
+LayerConfig AvgPool2D::getConfig() const {
+    return { "AvgPool2D", {
+        static_cast<double>(channels), static_cast<double>(kernel_size), static_cast<double>(in_height),
+        static_cast<double>(in_width), static_cast<double>(stride), static_cast<double>(padding)
+    }, { layout } };
+};
+
+Embedding::Embedding(int num, int dim) {
+    name = "Embedding(" + std::to_string(num) + ", " + std::to_string(dim) + ")";
+    trainable = true;
+
+    num_embeddings = num;
+    embedding_dim = dim;
+
+    weight.resize(static_cast<size_t>(num) * dim);
+    fillNormal(weight.data(), static_cast<int64_t>(weight.size()), 0.0, 1.0, nextStream());
+}
+
+Matrix::Row& Embedding::lookup(int id) {
+    if (id < 0 || id >= num_embeddings) {
+        throw std::out_of_range("Embedding index out of range");
+    }
+
+    auto it = active_slots.find(id);
+    if (it != active_slots.end()) {
+        return active_rows[it->second];
+    }
+
+    // First use of this id since resetGrad, so materialize its row as leaf Vars
+    Matrix::Row row(embedding_dim);
+    const double* values = weight.data() + static_cast<size_t>(id) * embedding_dim;
+    for (int j = 0; j < embedding_dim; j++) {
+        row[j] = Var(values[j]);
+    }
+
+    active_slots[id] = active_rows.size();
+    active_ids.push_back(id);
+    active_rows.push_back(std::move(row));
+
+    return active_rows.back();
+}
+
+// Ids arrive as doubles; a fractional id is an error rather than being truncated to its neighbour
+static int embeddingId(double value, int num_embeddings) {
+    if (value != std::floor(value)) {
+        throw std::runtime_error("Embedding ids must be integers, got " + std::to_string(value));
+    }
+    if (value < 0.0 || value >= num_embeddings) {
+        throw std::out_of_range("Embedding index out of range");
+    }
+    return static_cast<int>(value);
+}
+
+Matrix Embedding::forward(Matrix& input) {
+    Matrix output(input.rows, input.cols * embedding_dim);
+
+    if (!isGradEnabled()) {
+        // Inference reads the table directly and leaves the active rows alone, so it is safe to run concurrently
+        for (int i = 0; i < input.rows; i++) {
+            for (int k = 0; k < input.cols; k++) {
+                int id = embeddingId(input.data[i][k].getVal(), num_embeddings);
+                const double* values = weight.data() + static_cast<size_t>(id) * embedding_dim;
+                for (int j = 0; j < embedding_dim; j++) {
+                    output.data[i][k * embedding_dim + j] = Var(values[j]);
+                }
+            }
+        }
+        return output;
+    }
+
+    for (int i = 0; i < input.rows; i++) {
+        for (int k = 0; k < input.cols; k++) {
+            Matrix::Row& row = lookup(embeddingId(input.data[i][k].getVal(), num_embeddings));
+
+            // The output shares the row's nodes, so backward accumulates straight into them
+            for (int j = 0; j < embedding_dim; j++) {
+                output.data[i][k * embedding_dim + j] = row[j];
+            }
+        }
+    }
+
+    return output;
+};
+
+void Embedding::optimizeWeights(double learning_rate) {
+    for (size_t r = 0; r < active_ids.size(); r++) {
+        double* values = weight.data() + static_cast<size_t>(active_ids[r]) * embedding_dim;
+
+        for (int j = 0; j < embedding_dim; j++) {
+            Var& param = active_rows[r][j];
+
+            double updated = param.getVal() - learning_rate * param.getGrad();
+            param.setVal(updated);
+            values[j] = updated;
+        }
+    }
+};
+
+void Embedding::resetGrad() {
+    active_ids.clear();
+    active_rows.clear();
+    active_slots.clear();
+};
+
+LayerConfig Embedding::getConfig() const {
+    return { "Embedding", { static_cast<double>(num_embeddings), static_cast<double>(embedding_dim) }, {} };
+};
+
+std::vector<double>* Embedding::stateBuffer() {
+    return &weight;
+};
+
+std::vector<int> Embedding::getGradRows() const {
+    return active_ids;
+};
+
+std::vector<double> Embedding::getGradValues() const {
+    std::vector<double> grads;
+    grads.reserve(active_rows.size() * embedding_dim);
+
+    for (const Matrix::Row& row : active_rows) {
+        for (const Var& param : row) {
+            grads.push_back(param.getGrad());
+        }
+    }
+
+    return grads;
+};
+
+std::vector<double> Embedding::getEmbedding(int id) const {
+    if (id < 0 || id >= num_embeddings) {
+        throw std::out_of_range("Embedding index out of range");
+    }
+
+    auto begin = weight.begin() + static_cast<size_t>(id) * embedding_dim;
+    return std::vector<double>(begin, begin + embedding_dim);
+};
+
 ReLU::ReLU() {
     name = "ReLU()";
     trainable = false;
@@ -81,12 +551,22 @@ Matrix ReLU::forward(Matrix& input) {
     return output;
 };
 
+void ReLU::forwardInto(Matrix& input, Matrix& output) {
+    // Copying the Var handles reuses output's storage when the shape is unchanged
+    output = input;
+    output.relu_();
+};
+
 void ReLU::optimizeWeights(double learning_rate) {
     (void)learning_rate;
 }
 
 void ReLU::resetGrad() {}
 
+LayerConfig ReLU::getConfig() const {
+    return { "ReLU", {}, {} };
+};
+
 LeakyReLU::LeakyReLU(double a) {
     alpha = a;
     name = "LeakyReLU(alpha=" + std::to_string(alpha) + ")";
@@ -98,12 +578,21 @@ Matrix LeakyReLU::forward(Matrix& input) {
     return output;
 };
 
+void LeakyReLU::forwardInto(Matrix& input, Matrix& output) {
+    output = input;
+    output.leakyRelu_(alpha);
+};
+
 void LeakyReLU::optimizeWeights(double learning_rate) {
     (void)learning_rate;
 }
 
 void LeakyReLU::resetGrad() {}
 
+LayerConfig LeakyReLU::getConfig() const {
+    return { "LeakyReLU", { alpha }, {} };
+};
+
 Sigmoid::Sigmoid() {
     name = "Sigmoid()";
     trainable = false;
@@ -114,12 +603,21 @@ Matrix Sigmoid::forward(Matrix& input) {
     return output;
 };
 
+void Sigmoid::forwardInto(Matrix& input, Matrix& output) {
+    output = input;
+    output.sigmoid_();
+};
+
 void Sigmoid::optimizeWeights(double learning_rate) {
     (void)learning_rate;
 }
 
 void Sigmoid::resetGrad() {}
 
+LayerConfig Sigmoid::getConfig() const {
+    return { "Sigmoid", {}, {} };
+};
+
 Tanh::Tanh() {
     name = "Tanh()";
     trainable = false;
@@ -130,12 +628,21 @@ Matrix Tanh::forward(Matrix& input) {
     return output;
 };
 
+void Tanh::forwardInto(Matrix& input, Matrix& output) {
+    output = input;
+    output.tanh_();
+};
+
 void Tanh::optimizeWeights(double learning_rate) {
     (void)learning_rate;
 }
 
 void Tanh::resetGrad() {}
 
+LayerConfig Tanh::getConfig() const {
+    return { "Tanh", {}, {} };
+};
+
 SiLU::SiLU() {
     name = "SiLU()";
     trainable = false;
@@ -146,12 +653,21 @@ Matrix SiLU::forward(Matrix& input) {
     return output;
 };
 
+void SiLU::forwardInto(Matrix& input, Matrix& output) {
+    output = input;
+    output.silu_();
+};
+
 void SiLU::optimizeWeights(double learning_rate) {
     (void)learning_rate;
 }
 
 void SiLU::resetGrad() {}
 
+LayerConfig SiLU::getConfig() const {
+    return { "SiLU", {}, {} };
+};
+
 ELU::ELU(double a) {
     alpha = a;
     name = "ELU(alpha=" + std::to_string(alpha) + ")";
@@ -163,12 +679,21 @@ Matrix ELU::forward(Matrix& input) {
     return output;
 };
 
+void ELU::forwardInto(Matrix& input, Matrix& output) {
+    output = input;
+    output.elu_(alpha);
+};
+
 void ELU::optimizeWeights(double learning_rate) {
     (void)learning_rate;
 }
 
 void ELU::resetGrad() {}
 
+LayerConfig ELU::getConfig() const {
+    return { "ELU", { alpha }, {} };
+};
+
 Softmax::Softmax() {
     name = "Softmax()";
     trainable = false;
@@ -185,6 +710,60 @@ void Softmax::optimizeWeights(double learning_rate) {
 
 void Softmax::resetGrad() {}
 
+LayerConfig Softmax::getConfig() const {
+    return { "Softmax", {}, {} };
+};
+
+std::shared_ptr<Layer> createLayer(const LayerConfig& config) {
+    const std::vector<double>& a = config.args;
+    auto arg = [&](size_t k) { return static_cast<int>(a[k]); };
+    auto expect = [&](size_t num_args, size_t num_options) {
+        if (a.size() != num_args || config.options.size() != num_options) {
+            throw std::runtime_error("Wrong number of arguments for " + config.type);
+        }
+    };
+
+    if (config.type == "Linear") {
+        expect(2, 0);
+        return std::make_shared<Linear>(arg(0), arg(1));
+    } else if (config.type == "Conv2D") {
+        expect(8, 1);
+        return std::make_shared<Conv2D>(arg(0), arg(1), arg(2), arg(3), arg(4), arg(5), arg(6), arg(7), config.options[0]);
+    } else if (config.type == "MaxPool2D") {
+        expect(6, 1);
+        return std::make_shared<MaxPool2D>(arg(0), arg(1), arg(2), arg(3), arg(4), arg(5), config.options[0]);
+    } else if (config.type == "AvgPool2D") {
+        expect(6, 1);
+        return std::make_shared<AvgPool2D>(arg(0), arg(1), arg(2), arg(3), arg(4), arg(5), config.options[0]);
+    } else if (config.type == "Embedding") {
+        expect(2, 0);
+        return std::make_shared<Embedding>(arg(0), arg(1));
+    } else if (config.type == "ReLU") {
+        expect(0, 0);
+        return std::make_shared<ReLU>();
+    } else if (config.type == "LeakyReLU") {
+        expect(1, 0);
+        return std::make_shared<LeakyReLU>(a[0]);
+    } else if (config.type == "Sigmoid") {
+        expect(0, 0);
+        return std::make_shared<Sigmoid>();
+    } else if (config.type == "Tanh") {
+        expect(0, 0);
+        return std::make_shared<Tanh>();
+    } else if (config.type == "SiLU") {
+        expect(0, 0);
+        return std::make_shared<SiLU>();
+    } else if (config.type == "ELU") {
+        expect(1, 0);
+        return std::make_shared<ELU>(a[0]);
+    } else if (config.type == "Softmax") {
+        expect(0, 0);
+        return std::make_shared<Softmax>();
+    }
+
+    throw std::runtime_error("Unknown layer type " + config.type);
+}
+
 NeuralNetwork::NeuralNetwork(std::vector<std::shared_ptr<Layer>> network) {
     layers = std::move(network);
 };
@@ -201,11 +780,85 @@ void NeuralNetwork::addLayer(std::shared_ptr<Layer> layer) {
     layers.push_back(std::move(layer));
 }
 
-Matrix NeuralNetwork::forward(Matrix input) {
-    for (auto& layer : layers) {
-        input = layer->forward(input);
+Matrix NeuralNetwork::forward(Matrix& input) {
+    TRACE_SCOPE("NeuralNetwork::forward");
+    if (layers.empty()) {
+        return input;
     }
-    return input;
+
+    bool profiled = profiler != nullptr && profiler->beginForward();
+
+    Matrix output;
+    for (size_t i = 0; i < layers.size(); i++) {
+        TRACE_SCOPE(isTracingEnabled() ? layers[i]->traceName() : nullptr);
+        Matrix& layer_input = i == 0 ? input : output;
+        if (profiled) {
+            profiler->timeLayer(i, [&]() { output = layers[i]->forward(layer_input); });
+        } else {
+            output = layers[i]->forward(layer_input);
+        }
+    }
+    return output;
+};
+
+Matrix NeuralNetwork::predict(Matrix& input) {
+    NoGradGuard no_grad;
+    return forward(input);
+};
+
+Matrix NeuralNetwork::forward(SparseMatrix& input) {
+    TRACE_SCOPE("NeuralNetwork::forward");
+    if (layers.empty()) {
+        throw std::runtime_error("Cannot run a sparse input through an empty network");
+    }
+
+    auto first = std::dynamic_pointer_cast<Linear>(layers[0]);
+    if (!first) {
+        throw std::runtime_error("Sparse inputs require a Linear first layer");
+    }
+
+    bool profiled = profiler != nullptr && profiler->beginForward();
+
+    Matrix output;
+    {
+        TRACE_SCOPE(isTracingEnabled() ? first->traceName() : nullptr);
+        if (profiled) {
+            profiler->timeLayer(0, [&]() { output = first->forward(input); });
+        } else {
+            output = first->forward(input);
+        }
+    }
+
+    for (size_t i = 1; i < layers.size(); i++) {
+        TRACE_SCOPE(isTracingEnabled() ? layers[i]->traceName() : nullptr);
+        if (profiled) {
+            profiler->timeLayer(i, [&]() { output = layers[i]->forward(output); });
+        } else {
+            output = layers[i]->forward(output);
+        }
+    }
+    return output;
+};
+
+Matrix& NeuralNetwork::forwardBuffered(Matrix& input) {
+    TRACE_SCOPE("NeuralNetwork::forwardBuffered");
+    if (layers.empty()) {
+        return input;
+    }
+
+    activation_buffers.resize(layers.size());
+    bool profiled = profiler != nullptr && profiler->beginForward();
+
+    for (size_t i = 0; i < layers.size(); i++) {
+        TRACE_SCOPE(isTracingEnabled() ? layers[i]->traceName() : nullptr);
+        Matrix& layer_input = i == 0 ? input : activation_buffers[i - 1];
+        if (profiled) {
+            profiler->timeLayer(i, [&]() { layers[i]->forwardInto(layer_input, activation_buffers[i]); });
+        } else {
+            layers[i]->forwardInto(layer_input, activation_buffers[i]);
+        }
+    }
+    return activation_buffers.back();
 };
 
 std::string NeuralNetwork::getNetworkArchitecture() const {
@@ -221,3 +874,50 @@ std::string NeuralNetwork::getNetworkArchitecture() const {
 
     return architecture;
 };
+
+std::vector<Matrix*> NeuralNetwork::parameters() {
+    std::vector<Matrix*> params;
+    for (auto& layer : layers) {
+        for (Matrix* param : layer->parameters()) {
+            params.push_back(param);
+        }
+    }
+    return params;
+};
+
+size_t NeuralNetwork::numParameters() {
+    return getParameterBuffer().size();
+};
+
+void NeuralNetwork::buildParameterBuffer() {
+    parameter_buffer = ParameterBuffer(parameters());
+
+    sparse_layers.clear();
+    buffered_layers.clear();
+    buffered_generations.clear();
+    for (auto& layer : layers) {
+        if (layer->trainable && layer->parameters().empty()) {
+            sparse_layers.push_back(layer.get());
+        }
+        buffered_layers.push_back(layer.get());
+        buffered_generations.push_back(layer->parameterGeneration());
+    }
+};
+
+ParameterBuffer& NeuralNetwork::getParameterBuffer() {
+    // The layer list is public, so compare it and each layer's storage stamp with what the buffer was built from
+    bool stale = buffered_layers.size() != layers.size();
+    for (size_t i = 0; !stale && i < layers.size(); i++) {
+        stale = buffered_layers[i] != layers[i].get() || buffered_generations[i] != layers[i]->parameterGeneration();
+    }
+
+    if (stale) {
+        buildParameterBuffer();
+    }
+    return parameter_buffer;
+};
+
+const std::vector<Layer*>& NeuralNetwork::getSparseLayers() {
+    getParameterBuffer();
+    return sparse_layers;
+};
@@ -1,24 +1,424 @@
 #include "Optimizers.hpp"
+#include "Parallel.hpp"
+#include "Trace.hpp"
 
-GradientDescentOptimizer::GradientDescentOptimizer(double lr, NeuralNetwork* model) {
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// Parameters per parallel chunk in the update loops
+static const int64_t OPTIMIZER_GRAIN = 1 << 15;
+
+Optimizer::Optimizer(double lr, NeuralNetwork* model) {
     learning_rate = lr;
     neural_network = model;
 };
 
-void GradientDescentOptimizer::optimize() {
-    // Backpropagation and Gradient Descent for each parameter
+void Optimizer::optimize() {
+    TRACE_SCOPE("Optimizer::optimize");
+    checkSparseLayers();
+    ParameterBuffer& params = neural_network->getParameterBuffer();
+    params.gather();
+
+    prepareUpdate(params.size());
+    updateRange(params.values.data(), params.grads.data(), 0, params.size());
+
+    params.scatterValues();
+    finishStep();
+};
+
+void Optimizer::beginStep() {
+    checkSparseLayers();
+    prepareUpdate(neural_network->getParameterBuffer().size());
+};
+
+void Optimizer::optimizeSlice(size_t slice) {
+    TRACE_SCOPE("Optimizer::optimizeSlice");
+    ParameterBuffer& params = neural_network->getParameterBuffer();
+    size_t begin = params.slices[slice].first;
+    size_t end = begin + params.slices[slice].second;
+
+    params.gather(begin, end);
+    updateRange(params.values.data(), params.grads.data(), begin, end);
+    params.scatterValues(begin, end);
+};
+
+void Optimizer::finishStep() {
+    TRACE_SCOPE("Optimizer::finishStep");
+    // Layers without dense parameters apply their own (row-sparse) update
+    for (Layer* layer : neural_network->getSparseLayers()) {
+        layer->optimizeWeights(learning_rate);
+    }
+};
+
+void Optimizer::prepareUpdate(size_t) {};
+
+bool Optimizer::updatesSparseLayers() const {
+    return false;
+};
+
+// Checked before any parameter moves, so a rejected step leaves the model untouched
+void Optimizer::checkSparseLayers() {
+    const std::vector<Layer*>& sparse = neural_network->getSparseLayers();
+    if (!sparse.empty() && !updatesSparseLayers()) {
+        throw std::runtime_error(sparse[0]->name + " updates itself with plain SGD, so train this model with "
+            "GradientDescentOptimizer");
+    }
+};
+
+void Optimizer::resetGrad() {
+    // Reset gradients and the old graph on everything
     for (auto& layer : neural_network->layers) {
         if (layer->trainable) {
-            layer->optimizeWeights(learning_rate);
+            layer->resetGrad();
         }
     }
+}
+
+std::vector<double> Optimizer::getState() const {
+    return {};
 };
 
-void GradientDescentOptimizer::resetGrad() {
-    // Reset gradients and the old graph on everything
+void Optimizer::setState(const std::vector<double>& state) {
+    if (!state.empty()) {
+        throw std::runtime_error("This optimizer keeps no state");
+    }
+};
+
+GradientDescentOptimizer::GradientDescentOptimizer(double lr, NeuralNetwork* model) : Optimizer(lr, model) {};
+
+void GradientDescentOptimizer::updateRange(double* values, const double* grads, size_t first, size_t last) {
+    parallelFor(static_cast<int64_t>(first), static_cast<int64_t>(last), OPTIMIZER_GRAIN, [&](int64_t begin, int64_t end) {
+        for (int64_t k = begin; k < end; k++) {
+            values[k] -= learning_rate * grads[k];
+        }
+    });
+};
+
+bool GradientDescentOptimizer::updatesSparseLayers() const {
+    return true;
+};
+
+std::string GradientDescentOptimizer::getType() const {
+    return "SGD";
+};
+
+MomentumOptimizer::MomentumOptimizer(double lr, NeuralNetwork* model, double momentum) : Optimizer(lr, model) {
+    this->momentum = momentum;
+};
+
+std::string MomentumOptimizer::getType() const {
+    return "Momentum";
+};
+
+std::vector<double> MomentumOptimizer::getState() const {
+    return velocity;
+};
+
+void MomentumOptimizer::setState(const std::vector<double>& state) {
+    // Empty is the state of an optimizer that has not stepped yet
+    size_t n = neural_network->getParameterBuffer().size();
+    if (!state.empty() && state.size() != n) {
+        throw std::runtime_error("Momentum state holds " + std::to_string(state.size()) + " velocities, the model has "
+            + std::to_string(n) + " parameters");
+    }
+    velocity = state;
+};
+
+void MomentumOptimizer::prepareUpdate(size_t n) {
+    if (velocity.size() != n) {
+        velocity.assign(n, 0.0);
+    }
+};
+
+void MomentumOptimizer::updateRange(double* values, const double* grads, size_t first, size_t last) {
+    double* v = velocity.data();
+    parallelFor(static_cast<int64_t>(first), static_cast<int64_t>(last), OPTIMIZER_GRAIN, [&](int64_t begin, int64_t end) {
+        for (int64_t k = begin; k < end; k++) {
+            v[k] = momentum * v[k] + grads[k];
+            values[k] -= learning_rate * v[k];
+        }
+    });
+};
+
+AdamOptimizer::AdamOptimizer(double lr, NeuralNetwork* model, double beta1, double beta2, double eps, double weight_decay) : Optimizer(lr, model) {
+    this->beta1 = beta1;
+    this->beta2 = beta2;
+    this->eps = eps;
+    this->weight_decay = weight_decay;
+};
+
+std::string AdamOptimizer::getType() const {
+    return "Adam";
+};
+
+std::vector<double> AdamOptimizer::getState() const {
+    std::vector<double> state;
+    state.reserve(1 + first_moment.size() + second_moment.size());
+
+    state.push_back(static_cast<double>(step_count));
+    state.insert(state.end(), first_moment.begin(), first_moment.end());
+    state.insert(state.end(), second_moment.begin(), second_moment.end());
+    return state;
+};
+
+void AdamOptimizer::setState(const std::vector<double>& state) {
+    if (state.empty() || state.size() % 2 != 1) {
+        throw std::runtime_error("Adam state must hold a step count and two equally sized moments");
+    }
+
+    size_t n = (state.size() - 1) / 2;
+    size_t parameters = neural_network->getParameterBuffer().size();
+    if (n != 0 && n != parameters) {
+        throw std::runtime_error("Adam state holds moments for " + std::to_string(n) + " parameters, the model has "
+            + std::to_string(parameters));
+    }
+
+    step_count = static_cast<long long>(state[0]);
+    first_moment.assign(state.begin() + 1, state.begin() + 1 + n);
+    second_moment.assign(state.begin() + 1 + n, state.end());
+};
+
+void AdamOptimizer::prepareUpdate(size_t n) {
+    if (first_moment.size() != n) {
+        first_moment.assign(n, 0.0);
+        second_moment.assign(n, 0.0);
+        step_count = 0;
+    }
+
+    step_count += 1;
+
+    // Bias corrections folded into the step size and epsilon, so the loop body is one fused update
+    double correction1 = 1.0 - std::pow(beta1, static_cast<double>(step_count));
+    double correction2 = 1.0 - std::pow(beta2, static_cast<double>(step_count));
+    step_size = learning_rate * std::sqrt(correction2) / correction1;
+    eps_hat = eps * std::sqrt(correction2);
+
+    coupled_decay = decoupled_weight_decay ? 0.0 : weight_decay;
+    parameter_decay = decoupled_weight_decay ? 1.0 - learning_rate * weight_decay : 1.0;
+};
+
+void AdamOptimizer::updateRange(double* values, const double* grads, size_t first, size_t last) {
+    double* m = first_moment.data();
+    double* v = second_moment.data();
+    parallelFor(static_cast<int64_t>(first), static_cast<int64_t>(last), OPTIMIZER_GRAIN, [&](int64_t begin, int64_t end) {
+        for (int64_t k = begin; k < end; k++) {
+            double g = grads[k] + coupled_decay * values[k];
+
+            m[k] = beta1 * m[k] + (1.0 - beta1) * g;
+            v[k] = beta2 * v[k] + (1.0 - beta2) * g * g;
+
+            values[k] = parameter_decay * values[k] - step_size * m[k] / (std::sqrt(v[k]) + eps_hat);
+        }
+    });
+};
+
+AdamWOptimizer::AdamWOptimizer(double lr, NeuralNetwork* model, double beta1, double beta2, double eps, double weight_decay)
+    : AdamOptimizer(lr, model, beta1, beta2, eps, weight_decay) {
+    decoupled_weight_decay = true;
+};
+
+std::string AdamWOptimizer::getType() const {
+    return "AdamW";
+};
+
+static double dot(const std::vector<double>& a, const std::vector<double>& b) {
+    double sum = 0.0;
+    for (size_t k = 0; k < a.size(); k++) {
+        sum += a[k] * b[k];
+    }
+    return sum;
+}
+
+static double maxAbs(const std::vector<double>& a) {
+    double largest = 0.0;
+    for (double x : a) {
+        largest = std::max(largest, std::abs(x));
+    }
+    return largest;
+}
+
+LBFGSOptimizer::LBFGSOptimizer(NeuralNetwork* model, double lr, int history_size, int max_iterations,
+    double tolerance_grad, double tolerance_change, int max_line_search) {
+    neural_network = model;
+    learning_rate = lr;
+    this->history_size = history_size;
+    this->max_iterations = max_iterations;
+    this->tolerance_grad = tolerance_grad;
+    this->tolerance_change = tolerance_change;
+    this->max_line_search = max_line_search;
+};
+
+void LBFGSOptimizer::resetGrad() {
     for (auto& layer : neural_network->layers) {
         if (layer->trainable) {
             layer->resetGrad();
         }
     }
-}
+};
+
+int LBFGSOptimizer::getEvaluationCount() const {
+    return evaluations;
+};
+
+double LBFGSOptimizer::evaluate(const std::function<Var()>& closure, const std::vector<double>& x, std::vector<double>& grad) {
+    ParameterBuffer& params = neural_network->getParameterBuffer();
+    params.values = x;
+    params.scatterValues();
+
+    resetGrad();
+    Var loss = closure();
+    loss.setGrad(1.0);
+    loss.backward();
+
+    params.gatherGrads();
+    grad = params.grads;
+    evaluations += 1;
+
+    return loss.getVal();
+};
+
+void LBFGSOptimizer::direction(const std::vector<double>& grad, std::vector<double>& d) const {
+    // Two-loop recursion: d = -H * grad with H the inverse Hessian approximation from the history
+    size_t n = grad.size();
+    size_t m = s_history.size();
+
+    d.resize(n);
+    for (size_t k = 0; k < n; k++) {
+        d[k] = -grad[k];
+    }
+
+    std::vector<double> alpha(m);
+    for (size_t i = m; i-- > 0;) {
+        alpha[i] = rho_history[i] * dot(s_history[i], d);
+        const std::vector<double>& y = y_history[i];
+        for (size_t k = 0; k < n; k++) {
+            d[k] -= alpha[i] * y[k];
+        }
+    }
+
+    if (m > 0) {
+        // Scale by s^T y / y^T y of the newest pair as the initial Hessian guess
+        double gamma = 1.0 / (rho_history[m - 1] * dot(y_history[m - 1], y_history[m - 1]));
+        for (size_t k = 0; k < n; k++) {
+            d[k] *= gamma;
+        }
+    }
+
+    for (size_t i = 0; i < m; i++) {
+        double beta = rho_history[i] * dot(y_history[i], d);
+        const std::vector<double>& s = s_history[i];
+        for (size_t k = 0; k < n; k++) {
+            d[k] += (alpha[i] - beta) * s[k];
+        }
+    }
+};
+
+double LBFGSOptimizer::step(const std::function<Var()>& closure) {
+    TRACE_SCOPE("LBFGSOptimizer::step");
+    // Armijo sufficient decrease constant
+    const double c1 = 1e-4;
+
+    evaluations = 0;
+
+    const std::vector<Layer*>& sparse = neural_network->getSparseLayers();
+    if (!sparse.empty()) {
+        throw std::runtime_error(sparse[0]->name + " has no dense parameters, which L-BFGS cannot optimize");
+    }
+
+    ParameterBuffer& params = neural_network->getParameterBuffer();
+    params.gather();
+
+    std::vector<double> x = params.values;
+    std::vector<double> grad;
+    double loss = evaluate(closure, x, grad);
+
+    if (maxAbs(grad) <= tolerance_grad) {
+        return loss;
+    }
+
+    std::vector<double> d, x_new, grad_new;
+    size_t n = x.size();
+
+    for (int iteration = 0; iteration < max_iterations; iteration++) {
+        direction(grad, d);
+
+        double slope = dot(grad, d);
+        if (slope > -tolerance_change) {
+            // Not a descent direction, so drop the history and fall back to steepest descent
+            s_history.clear();
+            y_history.clear();
+            rho_history.clear();
+            direction(grad, d);
+            slope = dot(grad, d);
+        }
+
+        // Without curvature information, keep the first step on the order of the parameters
+        double t = learning_rate;
+        if (s_history.empty()) {
+            double grad_l1 = 0.0;
+            for (double g : grad) {
+                grad_l1 += std::abs(g);
+            }
+            t = std::min(1.0, 1.0 / grad_l1) * learning_rate;
+        }
+
+        double loss_new = 0.0;
+        bool decreased = false;
+        for (int search = 0; search < max_line_search; search++) {
+            x_new.resize(n);
+            for (size_t k = 0; k < n; k++) {
+                x_new[k] = x[k] + t * d[k];
+            }
+            loss_new = evaluate(closure, x_new, grad_new);
+
+            if (loss_new <= loss + c1 * t * slope) {
+                decreased = true;
+                break;
+            }
+            t *= 0.5;
+        }
+
+        if (!decreased) {
+            // No trial step decreased the loss enough, so put x and its gradients back and stop
+            params.values = x;
+            params.scatterValues();
+            params.grads = grad;
+            params.scatterGrads();
+            break;
+        }
+
+        // Curvature pair s = x_new - x, y = grad_new - grad, kept only when y^T s > 0
+        std::vector<double> s(n), y(n);
+        for (size_t k = 0; k < n; k++) {
+            s[k] = x_new[k] - x[k];
+            y[k] = grad_new[k] - grad[k];
+        }
+
+        double ys = dot(y, s);
+        if (ys > 1e-10) {
+            if (static_cast<int>(s_history.size()) >= history_size) {
+                s_history.pop_front();
+                y_history.pop_front();
+                rho_history.pop_front();
+            }
+            s_history.push_back(std::move(s));
+            y_history.push_back(std::move(y));
+            rho_history.push_back(1.0 / ys);
+        }
+
+        double loss_change = std::abs(loss_new - loss);
+        double step_size = t * maxAbs(d);
+
+        std::swap(x, x_new);
+        std::swap(grad, grad_new);
+        loss = loss_new;
+
+        if (maxAbs(grad) <= tolerance_grad || loss_change < tolerance_change || step_size <= tolerance_change) {
+            break;
+        }
+    }
+
+    // The network holds x and its gradients, from the last accepted evaluation or restored above
+    return loss;
+};
@@ -0,0 +1,224 @@
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+thread_local bool in_worker = false;
+
+class ThreadPool {
+public:
+    explicit ThreadPool(int num_workers) {
+        for (int i = 0; i < num_workers; i++) {
+            workers.emplace_back([this]() { run(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        cv.notify_one();
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+
+    void run() {
+        in_worker = true;
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+std::mutex pool_mutex;
+int num_threads = std::max(1u, std::thread::hardware_concurrency());
+std::shared_ptr<ThreadPool> pool;
+
+std::shared_ptr<ThreadPool> getPool() {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    if (!pool && num_threads > 1) {
+        pool = std::make_shared<ThreadPool>(num_threads - 1);
+    }
+    return pool;
+}
+
+// Completion state shared between the caller and the chunks it handed to the pool
+struct ChunkGroup {
+    std::mutex mutex;
+    std::condition_variable cv;
+    int remaining = 0;
+    std::exception_ptr error;
+};
+
+}
+
+SerialGuard::SerialGuard() {
+    previous = in_worker;
+    in_worker = true;
+}
+
+SerialGuard::~SerialGuard() {
+    in_worker = previous;
+}
+
+void setNumThreads(int n) {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    num_threads = std::max(1, n);
+    pool.reset();
+}
+
+int getNumThreads() {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    return num_threads;
+}
+
+void parallelFor(int64_t begin, int64_t end, int64_t grain, const std::function<void(int64_t, int64_t)>& fn) {
+    int64_t n = end - begin;
+    if (n <= 0) {
+        return;
+    }
+
+    grain = std::max<int64_t>(1, grain);
+    int64_t max_chunks = (n + grain - 1) / grain;
+    int64_t chunks = std::min<int64_t>(getNumThreads(), max_chunks);
+
+    std::shared_ptr<ThreadPool> workers = (chunks > 1 && !in_worker) ? getPool() : nullptr;
+    if (!workers) {
+        fn(begin, end);
+        return;
+    }
+
+    auto group = std::make_shared<ChunkGroup>();
+    group->remaining = static_cast<int>(chunks - 1);
+
+    int64_t chunk_size = n / chunks;
+    int64_t extra = n % chunks;
+
+    // Chunk 0 runs on the calling thread, the rest go to the pool
+    int64_t chunk_begin = begin + chunk_size + (extra > 0 ? 1 : 0);
+    for (int64_t c = 1; c < chunks; c++) {
+        int64_t chunk_end = chunk_begin + chunk_size + (c < extra ? 1 : 0);
+
+        workers->submit([group, &fn, chunk_begin, chunk_end]() {
+            try {
+                fn(chunk_begin, chunk_end);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(group->mutex);
+                if (!group->error) group->error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(group->mutex);
+            group->remaining -= 1;
+            if (group->remaining == 0) group->cv.notify_one();
+        });
+
+        chunk_begin = chunk_end;
+    }
+
+    std::exception_ptr caller_error;
+    try {
+        fn(begin, begin + chunk_size + (extra > 0 ? 1 : 0));
+    } catch (...) {
+        caller_error = std::current_exception();
+    }
+
+    std::unique_lock<std::mutex> lock(group->mutex);
+    group->cv.wait(lock, [&group]() { return group->remaining == 0; });
+
+    if (caller_error) std::rethrow_exception(caller_error);
+    if (group->error) std::rethrow_exception(group->error);
+}
+
+BackgroundWorker::BackgroundWorker() {
+    worker = std::thread([this]() { run(); });
+}
+
+BackgroundWorker::~BackgroundWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    worker.join();
+}
+
+void BackgroundWorker::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    cv.notify_all();
+}
+
+void BackgroundWorker::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this]() { return tasks.empty() && running == 0; });
+
+    if (error) {
+        std::exception_ptr first = error;
+        error = nullptr;
+        std::rethrow_exception(first);
+    }
+}
+
+void BackgroundWorker::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait(lock, [this]() { return stopping || !tasks.empty(); });
+        if (tasks.empty()) {
+            return;
+        }
+
+        std::function<void()> task = std::move(tasks.front());
+        tasks.pop_front();
+        running = 1;
+        lock.unlock();
+
+        try {
+            task();
+        } catch (...) {
+            lock.lock();
+            if (!error) error = std::current_exception();
+            lock.unlock();
+        }
+
+        lock.lock();
+        running = 0;
+        cv.notify_all();
+    }
+}
@@ -0,0 +1,170 @@
+#include "ParameterBuffer.hpp"
+#include "Parallel.hpp"
+
+#include <cmath>
+
+// Elements per parallel chunk when syncing with the Var nodes or sweeping the flat buffers
+static const int64_t PARAMETER_GRAIN = 1 << 15;
+
+ParameterBuffer::ParameterBuffer(const std::vector<Matrix*>& params) {
+    for (Matrix* param : params) {
+        size_t offset = vars.size();
+
+        for (int i = 0; i < param->rows; i++) {
+            for (int j = 0; j < param->cols; j++) {
+                vars.push_back(&param->data[i][j]);
+            }
+        }
+
+        slices.emplace_back(offset, vars.size() - offset);
+    }
+
+    values.resize(vars.size());
+    grads.resize(vars.size());
+    gather();
+}
+
+ParameterBuffer::~ParameterBuffer() {
+    clearGradientHooks();
+}
+
+// Tracking state belongs to the buffer's own step, so copies start untracked
+ParameterBuffer::ParameterBuffer(const ParameterBuffer& other)
+    : values(other.values), grads(other.grads), slices(other.slices), vars(other.vars) {}
+
+ParameterBuffer& ParameterBuffer::operator=(const ParameterBuffer& other) {
+    if (this != &other) {
+        clearGradientHooks();
+        ready_callback = nullptr;
+        values = other.values;
+        grads = other.grads;
+        slices = other.slices;
+        vars = other.vars;
+    }
+    return *this;
+}
+
+size_t ParameterBuffer::size() const {
+    return vars.size();
+}
+
+void ParameterBuffer::gather() {
+    gather(0, vars.size());
+}
+
+void ParameterBuffer::gather(size_t begin, size_t end) {
+    parallelFor(static_cast<int64_t>(begin), static_cast<int64_t>(end), PARAMETER_GRAIN, [&](int64_t first, int64_t last) {
+        for (int64_t k = first; k < last; k++) {
+            values[k] = vars[k]->getVal();
+            grads[k] = vars[k]->getGrad();
+        }
+    });
+}
+
+void ParameterBuffer::gatherGrads() {
+    gatherGrads(0, vars.size());
+}
+
+void ParameterBuffer::gatherGrads(size_t begin, size_t end) {
+    parallelFor(static_cast<int64_t>(begin), static_cast<int64_t>(end), PARAMETER_GRAIN, [&](int64_t first, int64_t last) {
+        for (int64_t k = first; k < last; k++) {
+            grads[k] = vars[k]->getGrad();
+        }
+    });
+}
+
+void ParameterBuffer::scatterValues() {
+    scatterValues(0, vars.size());
+}
+
+void ParameterBuffer::scatterValues(size_t begin, size_t end) {
+    parallelFor(static_cast<int64_t>(begin), static_cast<int64_t>(end), PARAMETER_GRAIN, [&](int64_t first, int64_t last) {
+        for (int64_t k = first; k < last; k++) {
+            vars[k]->setVal(values[k]);
+        }
+    });
+}
+
+void ParameterBuffer::scatterGrads() {
+    parallelFor(0, static_cast<int64_t>(vars.size()), PARAMETER_GRAIN, [&](int64_t begin, int64_t end) {
+        for (int64_t k = begin; k < end; k++) {
+            vars[k]->setGrad(grads[k]);
+        }
+    });
+}
+
+void ParameterBuffer::trackGradients(std::function<void(size_t slice)> ready) {
+    clearGradientHooks();
+    ready_callback = std::move(ready);
+
+    // One hook per slice counts down the slice's parameters as backward finalizes them
+    pending_grads.resize(slices.size());
+    for (size_t s = 0; s < slices.size(); s++) {
+        pending_grads[s] = slices[s].second;
+
+        int id = registerGradientHook([this, s]() {
+            pending_grads[s] -= 1;
+            if (pending_grads[s] == 0) {
+                ready_callback(s);
+            }
+        });
+        hook_ids.push_back(id);
+
+        for (size_t k = slices[s].first; k < slices[s].first + slices[s].second; k++) {
+            vars[k]->setGradientHook(id);
+        }
+    }
+}
+
+void ParameterBuffer::clearGradientHooks() {
+    if (hook_ids.empty()) {
+        return;
+    }
+
+    for (Var* var : vars) {
+        var->setGradientHook(-1);
+    }
+    for (int id : hook_ids) {
+        unregisterGradientHook(id);
+    }
+    hook_ids.clear();
+}
+
+void ParameterBuffer::finishGradientTracking() {
+    if (hook_ids.empty()) {
+        return;
+    }
+
+    // Unhooked before reporting, so a throwing callback leaves nothing registered
+    clearGradientHooks();
+    std::function<void(size_t)> ready = std::move(ready_callback);
+    ready_callback = nullptr;
+
+    for (size_t s = 0; s < slices.size(); s++) {
+        if (pending_grads[s] > 0 || slices[s].second == 0) {
+            pending_grads[s] = 0;
+            ready(s);
+        }
+    }
+}
+
+double ParameterBuffer::gradNorm() const {
+    double squared = 0.0;
+    for (double g : grads) {
+        squared += g * g;
+    }
+    return std::sqrt(squared);
+}
+
+double ParameterBuffer::clipGradNorm(double max_norm) {
+    double norm = gradNorm();
+
+    if (norm > max_norm && norm > 0.0) {
+        double scale = max_norm / norm;
+        for (double& g : grads) {
+            g *= scale;
+        }
+    }
+
+    return norm;
+}
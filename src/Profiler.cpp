@@ -0,0 +1,172 @@
+#include "Profiler.hpp"
+
+#include <cstdio>
+#include <stdexcept>
+
+LayerProfiler::LayerProfiler(NeuralNetwork* model, int sample_every) {
+    if (model == nullptr || sample_every < 1) {
+        throw std::runtime_error("LayerProfiler needs a model and a sampling interval of at least 1");
+    }
+    if (model->profiler != nullptr) {
+        throw std::runtime_error("The network already has a profiler attached");
+    }
+
+    neural_network = model;
+    this->sample_every = sample_every;
+    model->profiler = this;
+};
+
+LayerProfiler::~LayerProfiler() {
+    if (neural_network->profiler == this) {
+        neural_network->profiler = nullptr;
+    }
+};
+
+bool LayerProfiler::beginForward() {
+    // Passes without gradient recording (predict, serving threads) belong to no training step
+    if (!isGradEnabled()) {
+        return false;
+    }
+
+    int64_t call = forward_calls.fetch_add(1, std::memory_order_relaxed);
+    if (call % sample_every != 0) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t num_layers = neural_network->layers.size();
+    if (totals.size() != num_layers) {
+        totals.assign(num_layers, LayerTotals());
+    }
+    step_counts.assign(num_layers, GraphCounts());
+    forward_end = GraphCounts::read();
+    sampled_steps += 1;
+    awaiting_optimizer = false;
+    awaiting_backward.store(true, std::memory_order_relaxed);
+
+    return true;
+};
+
+void LayerProfiler::recordLayer(size_t layer, double ms, GraphCounts counts) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (layer >= totals.size()) {
+        return;
+    }
+
+    LayerTotals& total = totals[layer];
+    total.forward_ms += ms;
+    total.counts.nodes += counts.nodes;
+    total.counts.edges += counts.edges;
+    total.counts.bytes += counts.bytes;
+    step_counts[layer] = counts;
+    forward_end = GraphCounts::read();
+};
+
+bool LayerProfiler::stepSampled() const {
+    return awaiting_backward.load(std::memory_order_relaxed);
+};
+
+void LayerProfiler::recordBackward(double ms) {
+    if (!awaiting_backward.exchange(false, std::memory_order_relaxed)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Whatever was built between the end of forward and now (normally the loss) backpropagates too
+    GraphCounts loss = GraphCounts::read() - forward_end;
+    loss_totals.counts.nodes += loss.nodes;
+    loss_totals.counts.edges += loss.edges;
+    loss_totals.counts.bytes += loss.bytes;
+
+    int64_t step_work = loss.work();
+    for (const GraphCounts& counts : step_counts) {
+        step_work += counts.work();
+    }
+    if (step_work > 0) {
+        for (size_t l = 0; l < step_counts.size() && l < totals.size(); l++) {
+            totals[l].backward_ms += ms * static_cast<double>(step_counts[l].work()) / static_cast<double>(step_work);
+        }
+        loss_totals.backward_ms += ms * static_cast<double>(loss.work()) / static_cast<double>(step_work);
+    }
+    awaiting_optimizer = true;
+};
+
+void LayerProfiler::recordOptimizer(double ms) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (awaiting_optimizer) {
+        optimizer_ms += ms;
+        awaiting_optimizer = false;
+    }
+};
+
+ProfileReport LayerProfiler::getReport() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    ProfileReport report;
+    report.steps = forward_calls.load(std::memory_order_relaxed);
+    report.sampled_steps = sampled_steps;
+
+    double scale = sampled_steps > 0 ? 1.0 / static_cast<double>(sampled_steps) : 0.0;
+    auto average = [scale](const std::string& name, const LayerTotals& total) {
+        LayerProfile profile;
+        profile.name = name;
+        profile.forward_ms = total.forward_ms * scale;
+        profile.backward_ms = total.backward_ms * scale;
+        profile.nodes = static_cast<double>(total.counts.nodes) * scale;
+        profile.edges = static_cast<double>(total.counts.edges) * scale;
+        profile.bytes = static_cast<double>(total.counts.bytes) * scale;
+        return profile;
+    };
+
+    for (size_t l = 0; l < totals.size(); l++) {
+        std::string name = l < neural_network->layers.size() ? neural_network->layers[l]->name : "?";
+        report.layers.push_back(average(name, totals[l]));
+    }
+    report.layers.push_back(average("loss", loss_totals));
+    report.optimizer_ms = optimizer_ms * scale;
+
+    return report;
+};
+
+void LayerProfiler::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    forward_calls.store(0, std::memory_order_relaxed);
+    totals.assign(totals.size(), LayerTotals());
+    loss_totals = LayerTotals();
+    optimizer_ms = 0.0;
+    sampled_steps = 0;
+    awaiting_backward.store(false, std::memory_order_relaxed);
+    awaiting_optimizer = false;
+};
+
+std::string ProfileReport::table() const {
+    char line[256];
+    std::string out;
+
+    double step_ms = optimizer_ms;
+    for (const LayerProfile& layer : layers) {
+        step_ms += layer.forward_ms + layer.backward_ms;
+    }
+
+    std::snprintf(line, sizeof(line), "%-32s %11s %12s %11s %11s %11s %7s\n", "layer", "forward ms", "backward ms*", "nodes",
+        "edges", "MB", "share");
+    out += line;
+
+    for (const LayerProfile& layer : layers) {
+        std::string label = layer.name.size() > 32 ? layer.name.substr(0, 29) + "..." : layer.name;
+        double share = step_ms > 0.0 ? 100.0 * (layer.forward_ms + layer.backward_ms) / step_ms : 0.0;
+        std::snprintf(line, sizeof(line), "%-32s %11.3f %12.3f %11.0f %11.0f %11.2f %6.1f%%\n", label.c_str(), layer.forward_ms,
+            layer.backward_ms, layer.nodes, layer.edges, layer.bytes / (1 << 20), share);
+        out += line;
+    }
+    std::snprintf(line, sizeof(line), "%-32s %11.3f %60.1f%%\n", "optimizer", optimizer_ms, step_ms > 0.0 ? 100.0 * optimizer_ms / step_ms : 0.0);
+    out += line;
+
+    std::snprintf(line, sizeof(line), "%-32s %11.3f ms per step, averaged over %lld sampled of %lld steps\n", "total", step_ms,
+        static_cast<long long>(sampled_steps), static_cast<long long>(steps));
+    out += line;
+    out += "* backward time split across layers by their share of the step's graph nodes and edges\n";
+
+    return out;
+};
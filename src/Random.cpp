@@ -0,0 +1,137 @@
+#include "Random.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace {
+
+constexpr uint64_t DEFAULT_SEED = 0x5DEECE66DULL;
+
+// Each parallel chunk covers at least this many Philox blocks
+constexpr int64_t FILL_GRAIN = 1 << 14;
+
+std::atomic<uint64_t> global_seed{DEFAULT_SEED};
+std::atomic<uint64_t> stream_counter{0};
+
+inline void mulhilo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo) {
+    uint64_t product = static_cast<uint64_t>(a) * b;
+    hi = static_cast<uint32_t>(product >> 32);
+    lo = static_cast<uint32_t>(product);
+}
+
+// Block `block` of stream `stream`: 4 random words
+inline void philoxBlock(uint64_t seed, uint64_t stream, uint64_t block, uint32_t out[4]) {
+    uint32_t counter[4] = {
+        static_cast<uint32_t>(block), static_cast<uint32_t>(block >> 32),
+        static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32)
+    };
+    uint32_t key[2] = { static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32) };
+    philox4x32(counter, key, out);
+}
+
+// 53 random bits from two words mapped to [0, 1)
+inline double toUnit(uint32_t a, uint32_t b) {
+    uint64_t bits = ((static_cast<uint64_t>(a) << 32) | b) >> 11;
+    return static_cast<double>(bits) * (1.0 / 9007199254740992.0);
+}
+
+}
+
+void setSeed(uint64_t seed) {
+    global_seed.store(seed);
+    stream_counter.store(0);
+}
+
+uint64_t getSeed() {
+    return global_seed.load();
+}
+
+uint64_t nextStream() {
+    return stream_counter.fetch_add(1);
+}
+
+void philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]) {
+    const uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+    const uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    uint32_t k0 = key[0], k1 = key[1];
+
+    for (int round = 0; round < 10; round++) {
+        uint32_t hi0, lo0, hi1, lo1;
+        mulhilo(M0, c0, hi0, lo0);
+        mulhilo(M1, c2, hi1, lo1);
+
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+
+        k0 += W0;
+        k1 += W1;
+    }
+
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+void fillUniform(double* out, int64_t n, double low, double high, uint64_t stream) {
+    uint64_t seed = getSeed();
+    double scale = high - low;
+
+    // Each block yields two doubles, so element k only depends on block k / 2
+    int64_t blocks = (n + 1) / 2;
+    parallelFor(0, blocks, FILL_GRAIN, [&](int64_t begin, int64_t end) {
+        for (int64_t b = begin; b < end; b++) {
+            uint32_t words[4];
+            philoxBlock(seed, stream, static_cast<uint64_t>(b), words);
+
+            out[2 * b] = low + scale * toUnit(words[0], words[1]);
+            if (2 * b + 1 < n) out[2 * b + 1] = low + scale * toUnit(words[2], words[3]);
+        }
+    });
+}
+
+void fillNormal(double* out, int64_t n, double mean, double stddev, uint64_t stream) {
+    uint64_t seed = getSeed();
+    const double two_pi = 6.283185307179586;
+
+    // Box-Muller turns the two uniforms of a block into two independent normals
+    int64_t blocks = (n + 1) / 2;
+    parallelFor(0, blocks, FILL_GRAIN, [&](int64_t begin, int64_t end) {
+        for (int64_t b = begin; b < end; b++) {
+            uint32_t words[4];
+            philoxBlock(seed, stream, static_cast<uint64_t>(b), words);
+
+            double u1 = 1.0 - toUnit(words[0], words[1]); // (0, 1] so log is finite
+            double u2 = toUnit(words[2], words[3]);
+            double radius = std::sqrt(-2.0 * std::log(u1));
+
+            out[2 * b] = mean + stddev * radius * std::cos(two_pi * u2);
+            if (2 * b + 1 < n) out[2 * b + 1] = mean + stddev * radius * std::sin(two_pi * u2);
+        }
+    });
+}
+
+std::vector<int64_t> randomPermutation(int64_t n, uint64_t stream) {
+    uint64_t seed = getSeed();
+
+    std::vector<int64_t> permutation(n);
+    for (int64_t i = 0; i < n; i++) {
+        permutation[i] = i;
+    }
+
+    for (int64_t i = n - 1; i > 0; i--) {
+        uint32_t words[4];
+        philoxBlock(seed, stream, static_cast<uint64_t>(i), words);
+
+        int64_t j = static_cast<int64_t>(toUnit(words[0], words[1]) * static_cast<double>(i + 1));
+        std::swap(permutation[i], permutation[std::min(j, i)]);
+    }
+
+    return permutation;
+}
@@ -0,0 +1,107 @@
+#include "SparseMatrix.hpp"
+
+SparseMatrix::SparseMatrix() {
+    rows = 0;
+    cols = 0;
+    indptr.push_back(0);
+};
+
+SparseMatrix::SparseMatrix(int r, int c, std::vector<int> row_ptr, std::vector<int> col_indices, std::vector<double> vals) {
+    rows = r;
+    cols = c;
+    indptr = std::move(row_ptr);
+    indices = std::move(col_indices);
+    values = std::move(vals);
+
+    if (rows < 0 || cols < 0) {
+        throw std::runtime_error("CSR shape must not be negative");
+    }
+    if (indptr.empty() || indptr.size() != static_cast<size_t>(rows) + 1 || indptr[0] != 0) {
+        throw std::runtime_error("CSR indptr must have rows + 1 entries starting at 0");
+    }
+    if (indices.size() != values.size() || static_cast<size_t>(indptr[rows]) != values.size()) {
+        throw std::runtime_error("CSR indices and values must both have indptr[rows] entries");
+    }
+
+    for (int i = 0; i < rows; i++) {
+        if (indptr[i + 1] < indptr[i]) {
+            throw std::runtime_error("CSR indptr must be non-decreasing");
+        }
+    }
+    for (int col : indices) {
+        if (col < 0 || col >= cols) {
+            throw std::runtime_error("CSR column index out of range");
+        }
+    }
+};
+
+SparseMatrix SparseMatrix::fromDense(const Matrix& dense) {
+    std::vector<int> row_ptr(1, 0);
+    std::vector<int> col_indices;
+    std::vector<double> vals;
+
+    for (int i = 0; i < dense.rows; i++) {
+        for (int j = 0; j < dense.cols; j++) {
+            double v = dense.data[i][j].getVal();
+            if (v != 0.0) {
+                col_indices.push_back(j);
+                vals.push_back(v);
+            }
+        }
+        row_ptr.push_back(static_cast<int>(vals.size()));
+    }
+
+    return SparseMatrix(dense.rows, dense.cols, std::move(row_ptr), std::move(col_indices), std::move(vals));
+};
+
+Matrix SparseMatrix::toDense() const {
+    Matrix Y(rows, cols);
+
+    for (int i = 0; i < rows; i++) {
+        for (int k = indptr[i]; k < indptr[i + 1]; k++) {
+            Y.data[i][indices[k]].setVal(values[k]);
+        }
+    }
+
+    return Y;
+};
+
+int SparseMatrix::nnz() const {
+    return static_cast<int>(values.size());
+};
+
+Matrix matmul(SparseMatrix& X0, Matrix& X1) {
+    if (X0.cols != X1.rows) {
+        throw std::runtime_error("Dimension mismatch when attempting to multiply matrices");
+    }
+
+    Matrix Y(X0.rows, X1.cols);
+
+    for (int i = 0; i < X0.rows; i++) {
+        int row_begin = X0.indptr[i];
+        int row_end = X0.indptr[i + 1];
+
+        if (row_begin == row_end) {
+            continue; // empty rows stay constant zeros
+        }
+
+        for (int j = 0; j < X1.cols; j++) {
+            double sum = 0.0;
+            for (int k = row_begin; k < row_end; k++) {
+                sum += X0.values[k] * X1.data[X0.indices[k]][j].getVal();
+            }
+
+            Var y(sum);
+            y.reserveParents(row_end - row_begin);
+
+            // ∂y/∂X1[col, j] = X0[i, col]
+            for (int k = row_begin; k < row_end; k++) {
+                y.addParent(X0.values[k], X1.data[X0.indices[k]][j]);
+            }
+
+            Y.data[i][j] = y;
+        }
+    }
+
+    return Y;
+};
@@ -0,0 +1,162 @@
+#include "Trace.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+#include <unistd.h>
+
+std::atomic<bool> tracing_enabled{ false };
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    int64_t start_ns;
+    int64_t end_ns;
+};
+
+// Written only by its thread. head counts every span ever recorded; the slot is head % TRACE_BUFFER_EVENTS.
+struct TraceBuffer {
+    std::vector<TraceEvent> events;
+    std::atomic<uint64_t> head{ 0 };
+    int thread_index = 0;
+};
+
+struct TraceRegistry {
+    std::mutex mutex;
+
+    // Buffers outlive their threads so spans from finished threads can still be exported
+    std::vector<std::shared_ptr<TraceBuffer>> buffers;
+    std::unordered_set<std::string> names;
+};
+
+// Never destroyed, so threads that record during static destruction still find it
+TraceRegistry& registry() {
+    static TraceRegistry* instance = new TraceRegistry();
+    return *instance;
+}
+
+thread_local std::shared_ptr<TraceBuffer> thread_buffer;
+
+TraceBuffer& threadBuffer() {
+    if (!thread_buffer) {
+        auto buffer = std::make_shared<TraceBuffer>();
+        buffer->events.resize(TRACE_BUFFER_EVENTS);
+
+        TraceRegistry& traces = registry();
+        std::lock_guard<std::mutex> lock(traces.mutex);
+        buffer->thread_index = static_cast<int>(traces.buffers.size());
+        traces.buffers.push_back(buffer);
+        thread_buffer = std::move(buffer);
+    }
+    return *thread_buffer;
+}
+
+void writeEscaped(std::FILE* file, const char* text) {
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            std::fputc('\\', file);
+            std::fputc(*c, file);
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            std::fprintf(file, "\\u%04x", static_cast<unsigned char>(*c));
+        } else {
+            std::fputc(*c, file);
+        }
+    }
+}
+
+}
+
+void setTracingEnabled(bool enabled) {
+    tracing_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void clearTrace() {
+    TraceRegistry& traces = registry();
+    std::lock_guard<std::mutex> lock(traces.mutex);
+    for (auto& buffer : traces.buffers) {
+        buffer->head.store(0, std::memory_order_release);
+    }
+}
+
+const char* internTraceName(const std::string& name) {
+    TraceRegistry& traces = registry();
+    std::lock_guard<std::mutex> lock(traces.mutex);
+    return traces.names.insert(name).first->c_str();
+}
+
+int64_t traceClockNanoseconds() {
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void recordTraceSpan(const char* name, int64_t start_ns, int64_t end_ns) {
+    TraceBuffer& buffer = threadBuffer();
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    buffer.events[head % TRACE_BUFFER_EVENTS] = { name, start_ns, end_ns };
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void writeChromeTrace(const std::string& path) {
+    // Snapshot the buffers' spans under the lock, then write without holding it
+    struct ThreadSpans {
+        int thread_index;
+        std::vector<TraceEvent> events;
+    };
+    std::vector<ThreadSpans> threads;
+    {
+        TraceRegistry& traces = registry();
+        std::lock_guard<std::mutex> lock(traces.mutex);
+        for (auto& buffer : traces.buffers) {
+            uint64_t head = buffer->head.load(std::memory_order_acquire);
+            uint64_t count = head < TRACE_BUFFER_EVENTS ? head : TRACE_BUFFER_EVENTS;
+
+            ThreadSpans spans;
+            spans.thread_index = buffer->thread_index;
+            spans.events.reserve(count);
+            for (uint64_t k = head - count; k < head; k++) {
+                spans.events.push_back(buffer->events[k % TRACE_BUFFER_EVENTS]);
+            }
+            threads.push_back(std::move(spans));
+        }
+    }
+
+    std::string temp_path = path + ".tmp";
+    std::FILE* file = std::fopen(temp_path.c_str(), "w");
+    if (file == nullptr) {
+        throw std::runtime_error("Could not open " + temp_path + " for writing");
+    }
+
+    int pid = static_cast<int>(getpid());
+    bool first = true;
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (const ThreadSpans& spans : threads) {
+        if (spans.events.empty()) {
+            continue;
+        }
+
+        std::fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+            first ? "" : ",\n", pid, spans.thread_index, spans.thread_index);
+        first = false;
+
+        // Complete ("X") events with microsecond timestamps
+        for (const TraceEvent& event : spans.events) {
+            std::fprintf(file, ",\n{\"ph\":\"X\",\"name\":\"");
+            writeEscaped(file, event.name);
+            std::fprintf(file, "\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", pid, spans.thread_index,
+                static_cast<double>(event.start_ns) / 1000.0, static_cast<double>(event.end_ns - event.start_ns) / 1000.0);
+        }
+    }
+    std::fprintf(file, "\n]}\n");
+
+    bool ok = std::ferror(file) == 0;
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        throw std::runtime_error("Could not write trace " + path);
+    }
+}
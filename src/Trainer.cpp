@@ -0,0 +1,174 @@
+#include "Trainer.hpp"
+#include "LossFunctions.hpp"
+#include "Profiler.hpp"
+#include "Trace.hpp"
+
+#include <chrono>
+#include <stdexcept>
+
+LossFunction getLossFunction(const std::string& name) {
+    if (name == "mse") {
+        return [](Matrix& labels, Matrix& preds) { return MSELoss(labels, preds); };
+    } else if (name == "mae") {
+        return [](Matrix& labels, Matrix& preds) { return MAELoss(labels, preds); };
+    } else if (name == "bce") {
+        return [](Matrix& labels, Matrix& preds) { return BCELoss(labels, preds); };
+    }
+
+    throw std::runtime_error("Unknown loss function " + name);
+};
+
+Trainer::Trainer(NeuralNetwork* model, LossFunction loss, Optimizer* optimizer) {
+    if (model == nullptr || optimizer == nullptr || !loss) {
+        throw std::runtime_error("Trainer needs a model, a loss function and an optimizer");
+    }
+
+    neural_network = model;
+    loss_function = std::move(loss);
+    this->optimizer = optimizer;
+};
+
+double Trainer::step(Matrix& features, Matrix& labels) {
+    TRACE_SCOPE("Trainer::step");
+    optimizer->resetGrad();
+
+    // Activation buffers keep their storage between steps of the same batch shape
+    Matrix& preds = neural_network->forwardBuffered(features);
+
+    Var loss = loss_function(labels, preds);
+    loss.setGrad(1.0);
+
+    // Backward and optimizer time only go to the profiler when this step's forward pass was sampled
+    LayerProfiler* profiler = neural_network->profiler;
+    bool profiled = profiler != nullptr && profiler->stepSampled();
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+    auto lap = [&start]() {
+        Clock::time_point now = Clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - start).count();
+        start = now;
+        return ms;
+    };
+
+    if (!overlap_optimizer) {
+        loss.backward();
+        if (profiled) {
+            profiler->recordBackward(lap());
+        }
+
+        optimizer->optimize();
+        if (profiled) {
+            profiler->recordOptimizer(lap());
+        }
+        return loss.getVal();
+    }
+
+    if (!optimizer_worker) {
+        optimizer_worker = std::make_unique<BackgroundWorker>();
+    }
+
+    // Slices are handed to the worker from inside backward, typically last layer first
+    ParameterBuffer& params = neural_network->getParameterBuffer();
+    optimizer->beginStep();
+    params.trackGradients([this](size_t slice) {
+        optimizer_worker->submit([this, slice]() { optimizer->optimizeSlice(slice); });
+    });
+
+    loss.backward();
+    params.finishGradientTracking();
+    if (profiled) {
+        profiler->recordBackward(lap());
+    }
+
+    // Only the part of the optimizer work that did not overlap backward
+    optimizer_worker->wait();
+    optimizer->finishStep();
+    if (profiled) {
+        profiler->recordOptimizer(lap());
+    }
+
+    return loss.getVal();
+};
+
+std::vector<double> Trainer::fit(DataLoader& data, int epochs, TrainingCallback callback, int callback_every) {
+    std::vector<double> epoch_losses;
+    epoch_losses.reserve(epochs);
+
+    using Clock = std::chrono::steady_clock;
+
+    int64_t steps = 0;
+    double window_loss = 0.0;
+    int64_t window_steps = 0;
+    int64_t window_samples = 0;
+    Clock::time_point window_start = Clock::now();
+
+    auto report = [&](int epoch) {
+        if (!callback || window_steps == 0) {
+            return;
+        }
+
+        double seconds = std::chrono::duration<double>(Clock::now() - window_start).count();
+
+        TrainingStats stats;
+        stats.epoch = epoch;
+        stats.step = steps;
+        stats.loss = window_loss / static_cast<double>(window_steps);
+        stats.samples_per_second = seconds > 0.0 ? static_cast<double>(window_samples) / seconds : 0.0;
+        callback(stats);
+
+        window_loss = 0.0;
+        window_steps = 0;
+        window_samples = 0;
+        window_start = Clock::now();
+    };
+
+    for (int epoch = 0; epoch < epochs; epoch++) {
+        data.reset();
+
+        double total_loss = 0.0;
+        int64_t batches = 0;
+
+        while (Batch* batch = data.next()) {
+            double loss = step(batch->features, batch->labels);
+
+            total_loss += loss;
+            batches += 1;
+            steps += 1;
+
+            window_loss += loss;
+            window_steps += 1;
+            window_samples += batch->features.rows;
+
+            if (callback_every > 0 && steps % callback_every == 0) {
+                report(epoch);
+            }
+        }
+
+        epoch_losses.push_back(batches > 0 ? total_loss / static_cast<double>(batches) : 0.0);
+        report(epoch);
+    }
+
+    return epoch_losses;
+};
+
+std::vector<double> Trainer::fit(std::shared_ptr<Dataset> data, int epochs, int batch_size, bool shuffle,
+    TrainingCallback callback, int callback_every) {
+    DataLoader loader(std::move(data), batch_size, shuffle);
+    return fit(loader, epochs, std::move(callback), callback_every);
+};
+
+double Trainer::evaluate(DataLoader& data) {
+    NoGradGuard no_grad;
+    data.reset();
+
+    double total_loss = 0.0;
+    int64_t batches = 0;
+
+    while (Batch* batch = data.next()) {
+        Matrix preds = neural_network->forward(batch->features);
+        total_loss += loss_function(batch->labels, preds).getVal();
+        batches += 1;
+    }
+
+    return batches > 0 ? total_loss / static_cast<double>(batches) : 0.0;
+};
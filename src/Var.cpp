@@ -1,11 +1,80 @@
 #include "Var.hpp"
+#include "Counters.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+static thread_local bool grad_enabled = true;
+
+// Registered hooks by id. backward copies a slot's shared_ptr atomically before running the hook, so a hook
+// unregistered while a backward on another thread is inside it stays alive until that call returns.
+static const int MAX_GRADIENT_HOOKS = 1 << 16;
+static std::shared_ptr<GradientHook> gradient_hooks[MAX_GRADIENT_HOOKS];
+static std::mutex gradient_hooks_mutex;
+static int next_gradient_hook = 0;
+
+int registerGradientHook(GradientHook hook) {
+    std::lock_guard<std::mutex> lock(gradient_hooks_mutex);
+
+    // Ids are handed out round-robin, so a freed id is reused as late as possible
+    for (int attempt = 0; attempt < MAX_GRADIENT_HOOKS; attempt++) {
+        int id = next_gradient_hook;
+        next_gradient_hook = (next_gradient_hook + 1) % MAX_GRADIENT_HOOKS;
+
+        if (!std::atomic_load(&gradient_hooks[id])) {
+            std::atomic_store(&gradient_hooks[id], std::make_shared<GradientHook>(std::move(hook)));
+            return id;
+        }
+    }
+
+    throw std::runtime_error("Too many gradient hooks registered");
+}
+
+void unregisterGradientHook(int id) {
+    if (id < 0 || id >= MAX_GRADIENT_HOOKS) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(gradient_hooks_mutex);
+    std::atomic_store(&gradient_hooks[id], std::shared_ptr<GradientHook>());
+}
+
+static void runGradientHook(int id) {
+    std::shared_ptr<GradientHook> hook = std::atomic_load(&gradient_hooks[id]);
+    if (hook) {
+        (*hook)();
+    }
+}
+
+bool isGradEnabled() {
+    return grad_enabled;
+}
+
+void setGradEnabled(bool enabled) {
+    grad_enabled = enabled;
+}
+
+NoGradGuard::NoGradGuard() {
+    previous = grad_enabled;
+    grad_enabled = false;
+}
+
+NoGradGuard::~NoGradGuard() {
+    grad_enabled = previous;
+}
 
 Var::Var() {
-    node = std::make_shared<Node>();
+    node = std::allocate_shared<Node>(PoolAllocator<Node>());
+    addCounter(Counter::NodesCreated, 1);
 }
 
 Var::Var(double initial) {
-    node = std::make_shared<Node>();
+    node = std::allocate_shared<Node>(PoolAllocator<Node>());
+    addCounter(Counter::NodesCreated, 1);
     node->val = initial;
     node->grad = 0.0;
 }
@@ -32,16 +101,40 @@ void Var::resetGradAndParents() {
     node->parents.clear();
 }
 
+Var Var::constant(double value) {
+    Var c(value);
+    c.node->hook = CONSTANT_NODE;
+    return c;
+}
+
+void Var::addParent(double local_grad, Var& parent) {
+    if (!grad_enabled || parent.node->hook == CONSTANT_NODE) {
+        return;
+    }
+
+    node->parents.emplace_back(local_grad, parent.node);
+    parent.node->pending_children += 1;
+    addCounter(Counter::EdgesCreated, 1);
+}
+
+void Var::setGradientHook(int id) {
+    node->hook = id;
+}
+
+void Var::reserveParents(size_t n) {
+    if (grad_enabled) {
+        node->parents.reserve(n);
+    }
+}
+
 Var Var::add(Var& other) {
     Var y(node->val + other.node->val);
 
     // ∂y/∂this = 1.0
-    y.node->parents.emplace_back(1.0, node);
-    node->pending_children += 1;
+    y.addParent(1.0, *this);
 
     // ∂y/other = 1.0
-    y.node->parents.emplace_back(1.0, other.node);
-    other.node->pending_children += 1;
+    y.addParent(1.0, other);
 
     return y;
 }
@@ -50,8 +143,7 @@ Var Var::add(double other) {
     Var y(node->val + other);
 
     // ∂y/∂this = 1.0
-    y.node->parents.emplace_back(1.0, node);
-    node->pending_children += 1;
+    y.addParent(1.0, *this);
 
     return y;
 }
@@ -60,12 +152,10 @@ Var Var::subtract(Var& other) {
     Var y(node->val - other.node->val);
 
     // ∂y/∂this = 1.0
-    y.node->parents.emplace_back(1.0, node);
-    node->pending_children += 1;
+    y.addParent(1.0, *this);
 
     // ∂y/∂other = -1.0
-    y.node->parents.emplace_back(-1.0, other.node);
-    other.node->pending_children += 1;
+    y.addParent(-1.0, other);
 
     return y;
 }
@@ -74,8 +164,7 @@ Var Var::subtract(double other) {
     Var y(node->val - other);
 
     // ∂y/∂this = 1.0
-    y.node->parents.emplace_back(1.0, node);
-    node->pending_children += 1;
+    y.addParent(1.0, *this);
 
     return y;
 }
@@ -84,12 +173,10 @@ Var Var::multiply(Var& other) {
     Var y(node->val * other.node->val);
 
     // ∂y/∂this = other.val
-    y.node->parents.emplace_back(other.node->val, node);
-    node->pending_children += 1;
+    y.addParent(other.node->val, *this);
 
     // ∂y/other = val
-    y.node->parents.emplace_back(node->val, other.node);
-    other.node->pending_children += 1;
+    y.addParent(node->val, other);
 
     return y;
 }
@@ -98,8 +185,7 @@ Var Var::multiply(double other) {
     Var y(node->val * other);
 
     // ∂y/∂this = other.val
-    y.node->parents.emplace_back(other, node);
-    node->pending_children += 1;
+    y.addParent(other, *this);
 
     return y;
 }
@@ -108,12 +194,10 @@ Var Var::divide(Var& other) {
     Var y(node->val / other.node->val);
 
     // ∂y/∂this = 1 / other.val
-    y.node->parents.emplace_back(1.0 / other.node->val, node);
-    node->pending_children += 1;
+    y.addParent(1.0 / other.node->val, *this);
 
     // ∂y/other = -value / other.val^2
-    y.node->parents.emplace_back(-node->val / std::pow(other.node->val, 2), other.node);
-    other.node->pending_children += 1;
+    y.addParent(-node->val / std::pow(other.node->val, 2), other);
 
     return y;
 }
@@ -122,8 +206,7 @@ Var Var::divide(double other) {
     Var y(node->val / other);
 
     // ∂y/∂this = 1 / other.val
-    y.node->parents.emplace_back(1.0 / other, node);
-    node->pending_children += 1;
+    y.addParent(1.0 / other, *this);
 
     return y;
 }
@@ -132,8 +215,7 @@ Var Var::pow(int power) {
     Var y(std::pow(node->val, power));
 
     // ∂y/∂this = power * val ** (power - 1)
-    y.node->parents.emplace_back(power * std::pow(node->val, power - 1), node);
-    node->pending_children += 1;
+    y.addParent(power * std::pow(node->val, power - 1), *this);
 
     return y;
 }
@@ -142,8 +224,7 @@ Var Var::sin() {
     Var y(std::sin(node->val));
 
     // ∂y/∂this = cos(val)
-    y.node->parents.emplace_back(std::cos(node->val), node);
-    node->pending_children += 1;
+    y.addParent(std::cos(node->val), *this);
 
     return y;
 }
@@ -152,8 +233,7 @@ Var Var::cos() {
     Var y(std::cos(node->val));
 
     // ∂y/∂this = -sin(val)
-    y.node->parents.emplace_back(-std::sin(node->val), node);
-    node->pending_children += 1;
+    y.addParent(-std::sin(node->val), *this);
 
     return y;
 }
@@ -162,8 +242,7 @@ Var Var::tan() {
     Var y(std::tan(node->val));
 
     // ∂y/∂this = sec^2(val)
-    y.node->parents.emplace_back(std::pow(1 / std::cos(node->val), 2), node);
-    node->pending_children += 1;
+    y.addParent(std::pow(1 / std::cos(node->val), 2), *this);
 
     return y;
 }
@@ -173,8 +252,7 @@ Var Var::sec() {
     Var y(secant_val);
 
     // ∂y/∂this = sec(val) * tan(val)
-    y.node->parents.emplace_back(secant_val * std::tan(node->val), node);
-    node->pending_children += 1;
+    y.addParent(secant_val * std::tan(node->val), *this);
 
     return y;
 }
@@ -184,8 +262,7 @@ Var Var::csc() {
     Var y(cosecant_val);
 
     // ∂y/∂this = - csc(val) * cot(val)
-    y.node->parents.emplace_back(-cosecant_val * (1 / std::tan(node->val)), node);
-    node->pending_children += 1;
+    y.addParent(-cosecant_val * (1 / std::tan(node->val)), *this);
 
     return y;
 }
@@ -194,8 +271,7 @@ Var Var::cot() {
     Var y(1 / std::tan(node->val));
 
     // ∂y/∂this = -csc^2(val)
-    y.node->parents.emplace_back(-std::pow(1 / std::sin(node->val), 2), node);
-    node->pending_children += 1;
+    y.addParent(-std::pow(1 / std::sin(node->val), 2), *this);
 
     return y;
 }
@@ -205,8 +281,7 @@ Var Var::log() {
     Var y(std::log(node->val));
 
     // ∂y/∂this = 1/val
-    y.node->parents.emplace_back(1 / node->val, node);
-    node->pending_children += 1;
+    y.addParent(1 / node->val, *this);
 
     return y;
 }
@@ -215,8 +290,7 @@ Var Var::exp() {
     Var y(std::exp(node->val));
 
     // ∂y/∂this = e^x
-    y.node->parents.emplace_back(std::exp(node->val), node);
-    node->pending_children += 1;
+    y.addParent(std::exp(node->val), *this);
 
     return y;
 }
@@ -229,8 +303,7 @@ Var Var::abs() {
     else if (node->val < 0.0) abs_derivative = -1.0;
 
     // ∂y/∂this = abs_derivative
-    y.node->parents.emplace_back(abs_derivative, node);
-    node->pending_children += 1;
+    y.addParent(abs_derivative, *this);
 
     return y;
 }
@@ -239,8 +312,7 @@ Var Var::relu() {
     Var y(node->val > 0.0 ? node->val : 0.0);
 
     // ∂y/∂this = 1 if val > 0 else 0
-    y.node->parents.emplace_back(node->val > 0.0 ? 1.0 : 0.0, node);
-    node->pending_children += 1;
+    y.addParent(node->val > 0.0 ? 1.0 : 0.0, *this);
 
     return y;
 }
@@ -249,8 +321,7 @@ Var Var::leakyRelu(double alpha) {
     Var y(node->val > 0.0 ? node->val : alpha * node->val);
 
     // ∂y/∂this = 1 if val > 0 else alpha
-    y.node->parents.emplace_back(node->val > 0.0 ? 1.0 : alpha, node);
-    node->pending_children += 1;
+    y.addParent(node->val > 0.0 ? 1.0 : alpha, *this);
 
     return y;
 }
@@ -260,8 +331,7 @@ Var Var::sigmoid() {
     Var y(simoid_val);
 
     // ∂y/∂this = s * (1 - s)
-    y.node->parents.emplace_back(simoid_val * (1.0 - simoid_val), node);
-    node->pending_children += 1;
+    y.addParent(simoid_val * (1.0 - simoid_val), *this);
 
     return y;
 }
@@ -271,8 +341,7 @@ Var Var::tanh() {
     Var y(tanh_val);
 
     // ∂y/∂this = 1 - tanh^2(val)
-    y.node->parents.emplace_back(1.0 - tanh_val * tanh_val, node);
-    node->pending_children += 1;
+    y.addParent(1.0 - tanh_val * tanh_val, *this);
 
     return y;
 }
@@ -283,8 +352,7 @@ Var Var::silu() {
 
     // ∂y/∂this = silu_val + x * silu_val * (1 - silu_val)
     double grad = silu_val + node->val * silu_val * (1.0 - silu_val);
-    y.node->parents.emplace_back(grad, node);
-    node->pending_children += 1;
+    y.addParent(grad, *this);
 
     return y;
 }
@@ -294,18 +362,118 @@ Var Var::elu(double alpha) {
 
     // ∂y/∂this = 1 if val > 0 else alpha * exp(val)
     double grad = (node->val > 0.0) ? 1.0 : alpha * std::exp(node->val);
-    y.node->parents.emplace_back(grad, node);
-    node->pending_children += 1;
+    y.addParent(grad, *this);
 
     return y;
 }
 
+Var::Node::~Node() {
+    addCounter(Counter::NodesDestroyed, 1);
+}
+
+int64_t getLiveNodeCount() {
+    // Destroyed first, so a node created between the two reads can only raise the result
+    int64_t destroyed = readCounter(Counter::NodesDestroyed);
+    return readCounter(Counter::NodesCreated) - destroyed;
+}
+
+int64_t getCreatedNodeCount() {
+    return readCounter(Counter::NodesCreated);
+}
+
+// Histogram bucket for a fan-in/fan-out value: 0 stays 0, otherwise 1 + floor(log2(n))
+static size_t fanBucket(size_t n) {
+    size_t bucket = 0;
+    while (n > 0) {
+        n >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+GraphStats Var::getGraphStats() const {
+    GraphStats stats;
+    if (!node) {
+        return stats;
+    }
+
+    // Iterative DFS numbering every reachable node and recording a post-order
+    std::unordered_map<const Node*, size_t> index;
+    std::vector<const Node*> nodes;
+    std::vector<size_t> post_order;
+    std::vector<std::pair<const Node*, size_t>> stack;
+
+    index.emplace(node.get(), 0);
+    nodes.push_back(node.get());
+    stack.emplace_back(node.get(), 0);
+
+    while (!stack.empty()) {
+        const Node* current = stack.back().first;
+        size_t next = stack.back().second;
+        if (next == current->parents.size()) {
+            post_order.push_back(index[current]);
+            stack.pop_back();
+            continue;
+        }
+
+        stack.back().second += 1;
+        const Node* parent = current->parents[next].second.get();
+        if (index.emplace(parent, nodes.size()).second) {
+            nodes.push_back(parent);
+            stack.emplace_back(parent, 0);
+        }
+    }
+
+    std::vector<size_t> fan_out(nodes.size(), 0);
+    std::vector<int64_t> depth(nodes.size(), 0);
+    size_t node_bytes = poolBlockSize(sizeof(Node) + 2 * sizeof(void*));
+
+    // Reverse post-order visits every node before its parents, so depths only ever grow downwards
+    for (auto it = post_order.rbegin(); it != post_order.rend(); ++it) {
+        const Node* current = nodes[*it];
+        stats.edges += static_cast<int64_t>(current->parents.size());
+        stats.bytes += static_cast<int64_t>(node_bytes);
+        if (current->parents.capacity() > 0) {
+            stats.bytes += static_cast<int64_t>(poolBlockSize(current->parents.capacity() * sizeof(current->parents[0])));
+        }
+
+        size_t fan_in = fanBucket(current->parents.size());
+        if (stats.fan_in_histogram.size() <= fan_in) {
+            stats.fan_in_histogram.resize(fan_in + 1, 0);
+        }
+        stats.fan_in_histogram[fan_in] += 1;
+
+        for (auto& p : current->parents) {
+            size_t parent = index[p.second.get()];
+            fan_out[parent] += 1;
+            depth[parent] = std::max(depth[parent], depth[*it] + 1);
+        }
+        stats.max_depth = std::max(stats.max_depth, depth[*it]);
+    }
+
+    for (size_t count : fan_out) {
+        size_t bucket = fanBucket(count);
+        if (stats.fan_out_histogram.size() <= bucket) {
+            stats.fan_out_histogram.resize(bucket + 1, 0);
+        }
+        stats.fan_out_histogram[bucket] += 1;
+    }
+
+    stats.nodes = static_cast<int64_t>(nodes.size());
+    return stats;
+}
+
 void Var::backward() {
+    TRACE_SCOPE("Var::backward");
     if (!node) {
         return;
     }
 
+    // The stack's capacity is kept per thread between calls, so same-shaped graphs don't regrow it every step.
+    // Taken rather than borrowed, so a hook that runs another backward just starts with an empty one.
+    static thread_local std::vector<std::shared_ptr<Node>> stack_cache;
     std::vector<std::shared_ptr<Node>> nodes;
+    nodes.swap(stack_cache);
     nodes.push_back(node);
 
     while (!nodes.empty()) {
@@ -320,8 +488,13 @@ void Var::backward() {
             parent->pending_children -= 1;
 
             if (parent->pending_children == 0) {
+                if (parent->hook >= 0) {
+                    runGradientHook(parent->hook);
+                }
                 nodes.push_back(parent);
             }
         }
     }
+
+    stack_cache.swap(nodes);
 }